@@ -15,6 +15,14 @@ namespace Phys {
 		BodyList bodies;
 		FixtureList fixtures;
 		ParticleList particles;
+
+		///empties the result, keeping its memory
+		void clear() {
+			empty = true;
+			bodies.clear();
+			fixtures.clear();
+			particles.clear();
+		}
 	};
 }
 
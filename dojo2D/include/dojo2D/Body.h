@@ -4,6 +4,8 @@
 
 #include "BodyPartType.h"
 #include "Material.h"
+#include "BodySnapshot.h"
+#include "BodyCommand.h"
 
 namespace Phys {
 
@@ -78,6 +80,7 @@ namespace Phys {
 		Vector getLocalDirection(const Vector& worldDirection) const;
 		Vector getWorldPoint(const Vector& localPosition) const;
 
+		///the getters of the body state read the last snapshot on the main thread, and the body itself on the physics thread
 		Vector getVelocity() const;
 		Vector getVelocityAtLocalPoint(const Vector& localPoint) const;
 		float getAngularVelocity() const;
@@ -113,7 +116,8 @@ namespace Phys {
 
 		void onSimulationPaused();
 
-		void updateObject();
+		///moves the object to the state of the body, called by the World on the main thread
+		void updateObject(const Vector& position, Radians angle, const Vector& velocity, bool fixedRotation);
 
 		World& getWorld() const {
 			return mWorld.unwrap();
@@ -140,6 +144,28 @@ namespace Phys {
 		void _registerJoint(Joint& joint);
 		void _removeJoint(Joint& joint);
 
+		void _setSnapshotSlot(uint32_t slot, uint32_t id) {
+			mSnapshotSlot = slot;
+			mSnapshotId = id;
+		}
+
+		uint32_t _getSnapshotSlot() const {
+			return mSnapshotSlot;
+		}
+
+		uint32_t _getSnapshotId() const {
+			return mSnapshotId;
+		}
+
+		///runs a typed command on the physics thread
+		void _execute(const BodyCommand& command);
+
+		///keeps the rotation of a fixed rotation body in sync with its object, on the physics thread
+		void _updateFixedRotation();
+
+		///destroys the parts and the Box2D body, on the physics thread
+		void _destroyB2Body();
+
 	private:
 		optional_ref<World> mWorld;
 		bool mPushable = true;
@@ -149,12 +175,20 @@ namespace Phys {
 		bool mStaticShape = false;
 		bool mAutoActivate;
 
+		uint32_t mSnapshotSlot = 0, mSnapshotId = 0;
+		///only changed by setDamping, so they don't need to be read from the body
+		float mLinearDamping = 0, mAngularDamping = 0;
+
 		Dojo::SmallSet<std::shared_ptr<BodyPart>> mParts;
 		Dojo::SmallSet<Joint*> mJoints;
 
 		BodyPart& _addShape(std::shared_ptr<b2Shape> shape, const Material& material, Group group, BodyPartType type);
 
 		b2Body& _waitForBody() const;
+
+		///returns the last snapshot if the caller is on the main thread and the body is in it
+		optional_ref<const BodySnapshot> _getSnapshot() const;
+		b2Transform _getTransform() const;
 	private:
 		bool mParticleCollisionModel = false;
 	};
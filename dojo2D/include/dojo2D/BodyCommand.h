@@ -0,0 +1,30 @@
+#pragma once
+
+#include "common_header.h"
+
+namespace Phys {
+	class Body;
+
+	///a POD record of a common change to a Body, that World can queue without allocating a std::function
+	struct BodyCommand {
+		enum class Op : uint8_t {
+			ApplyForce,
+			ApplyForceAtWorldPoint,
+			ApplyForceAtLocalPoint,
+			ApplyTorque,
+			ForcePosition,
+			ForceRotation,
+			ForceVelocity,
+			SetTransform,
+			SetActive
+		};
+
+		Op op;
+		Body* body;
+		///the meaning of the payload depends on op
+		b2Vec2 vector, point;
+		float scalar;
+	};
+
+	typedef std::vector<BodyCommand> BodyCommandBuffer;
+}
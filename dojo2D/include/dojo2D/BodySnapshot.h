@@ -0,0 +1,77 @@
+#pragma once
+
+#include "common_header.h"
+
+namespace Phys {
+	///the state of all the bodies of a World after a step, laid out by field and indexed by the snapshot slot of each Body
+	struct BodySnapshot {
+		enum Flags : uint8_t {
+			///the body is awake and active, so it could have moved in the last step
+			Moving = 1 << 0,
+			Active = 1 << 1,
+			FixedRotation = 1 << 2
+		};
+
+		///when the snapshot was published, in seconds
+		double time = 0;
+
+		///the id of the body in each slot, 0 for empty slots
+		std::vector<uint32_t> ids;
+		std::vector<b2Vec2> positions, velocities;
+		std::vector<float> angles, angularVelocities, masses;
+		std::vector<uint8_t> flags;
+
+		size_t size() const {
+			return ids.size();
+		}
+
+		///resizes the snapshot and empties all the slots
+		void reset(size_t size);
+
+		///returns true if the slot contains the body with this id
+		bool contains(uint32_t slot, uint32_t id) const {
+			return slot < size() and ids[slot] == id;
+		}
+	};
+
+	///BodySnapshotBuffer passes BodySnapshots from the physics thread to the main thread without locks or waits
+	/**
+	There are 4 buffers: one written by the physics thread, one published and ready to be acquired, and the last two
+	acquired by the main thread, which can interpolate between them. Publishing and acquiring just exchange buffers. */
+	class BodySnapshotBuffer {
+	public:
+		///returns the snapshot that the physics thread can fill
+		BodySnapshot& getWriteBuffer() {
+			return mBuffers[mWriteIndex];
+		}
+
+		///makes the write buffer available to the main thread, and gets a new write buffer
+		void publish();
+
+		///takes the last published snapshot if there's a new one, making the current snapshot the previous one
+		/**
+		\returns true if a new snapshot was acquired */
+		bool acquire();
+
+		///the last acquired snapshot
+		const BodySnapshot& getCurrent() const {
+			return mBuffers[mCurrentIndex];
+		}
+
+		///the snapshot acquired before the current one
+		const BodySnapshot& getPrevious() const {
+			return mBuffers[mPreviousIndex];
+		}
+
+	private:
+		static constexpr uint32_t IndexMask = 3;
+		///set in mReady when the ready buffer was published and not acquired yet
+		static constexpr uint32_t NewFlag = 4;
+
+		BodySnapshot mBuffers[4];
+
+		std::atomic<uint32_t> mReady = { 2 };
+		uint32_t mWriteIndex = 3;
+		uint32_t mCurrentIndex = 0, mPreviousIndex = 1;
+	};
+}
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cstdint>
+
 namespace Phys {
-	enum class ContactMode {
-		None,
-		Normal,
-		Ghost
+	enum class ContactMode : uint8_t {
+		None = 0,
+		Normal = 1,
+		Ghost = 2
 	};
 }
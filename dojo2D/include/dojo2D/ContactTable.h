@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common_header.h"
+
+#include "ContactMode.h"
+
+namespace Phys {
+	///ContactTable stores the ContactMode between each pair of Groups
+	/**
+	Most pairs collide normally, so each group just has a row of bits marking the groups it doesn't collide normally with,
+	and a second row marking which of those are ghost contacts. The whole table takes 16 KB and is read without branches. */
+	class ContactTable {
+	public:
+		static const int GROUP_COUNT = 256;
+
+		void set(Group A, Group B, ContactMode mode) {
+			DEBUG_ASSERT(A < GROUP_COUNT and B < GROUP_COUNT, "Group out of range");
+
+			_set(mFiltered, A, B, mode != ContactMode::Normal);
+			_set(mFiltered, B, A, mode != ContactMode::Normal);
+			_set(mGhost, A, B, mode == ContactMode::Ghost);
+			_set(mGhost, B, A, mode == ContactMode::Ghost);
+		}
+
+		ContactMode get(Group A, Group B) const {
+			//Normal - filtered + 2 * ghost maps the bits back to the modes
+			return (ContactMode)(Dojo::enum_cast(ContactMode::Normal) - _get(mFiltered, A, B) + 2 * _get(mGhost, A, B));
+		}
+
+		///true if the groups collide normally
+		bool collides(Group A, Group B) const {
+			return _get(mFiltered, A, B) == 0;
+		}
+
+	private:
+		static const int WORD_BITS = 64;
+		typedef uint64_t Row[GROUP_COUNT / WORD_BITS];
+
+		Row mFiltered[GROUP_COUNT] = {};
+		Row mGhost[GROUP_COUNT] = {};
+
+		static uint32_t _get(const Row* rows, Group A, Group B) {
+			return (uint32_t)(rows[A][B / WORD_BITS] >> (B % WORD_BITS)) & 1;
+		}
+
+		static void _set(Row* rows, Group A, Group B, bool value) {
+			auto& word = rows[A][B / WORD_BITS];
+			auto bit = uint64_t(1) << (B % WORD_BITS);
+			word = value ? (word | bit) : (word & ~bit);
+		}
+	};
+}
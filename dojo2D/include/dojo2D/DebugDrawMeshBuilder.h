@@ -3,12 +3,24 @@
 #include "common_header.h"
 
 namespace Phys {
+	///DebugDrawMeshBuilder draws the contents of a b2World as lines in two meshes, and renders them in a viewport
+	/**
+	The static bodies are drawn in getStaticMesh(), that is only drawn and uploaded again when the static bodies change or
+	when the viewport leaves the area around it that was drawn, while the rest is drawn in getMesh() each update.
+	Only the lines visible in the viewport are drawn. What is drawn is chosen with the b2Draw flags: e_shapeBit,
+	e_aabbBit, e_jointBit, e_pairBit for the contact points and e_particleBit. */
 	class DebugDrawMeshBuilder : public b2Draw {
 	public:
 
-		DebugDrawMeshBuilder();
+		///creates the meshes, and the Renderables that show them in layer with the transform of parent
+		DebugDrawMeshBuilder(Dojo::Object& parent, Dojo::RenderLayer::ID layer, Dojo::Shader& shader, const Dojo::Viewport& viewport);
 
-		void update(b2World& world);
+		~DebugDrawMeshBuilder();
+
+		///draws the world again
+		/**
+		\param staticChanged the static bodies were created, destroyed, moved or (de)activated since the last update */
+		void update(b2World& world, bool staticChanged);
 
 		void DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) override;
 		void DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) override;
@@ -18,22 +30,52 @@ namespace Phys {
 		void DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color) override;
 		void DrawTransform(const b2Transform& xf) override;
 
+		///the mesh of everything but the static bodies
 		Dojo::Mesh& getMesh() {
 			return *mMesh;
 		}
 
-		void setEnabled(bool enable) {
-			mEnabled = enable;
+		Dojo::Mesh& getStaticMesh() {
+			return *mStaticMesh;
 		}
 
+		void setEnabled(bool enable);
+
 	protected:
+		///a vertex in the format of the meshes, Position2D + Color
+		struct Vertex {
+			float x, y;
+			Dojo::Color::RGBAPixel color;
+		};
 
 		bool mEnabled = true;
-		std::unique_ptr<Dojo::Mesh> mMesh;
+		std::unique_ptr<Dojo::Mesh> mMesh, mStaticMesh;
+		std::unique_ptr<Dojo::Renderable> mRenderable, mStaticRenderable;
+
+		const Dojo::Viewport& mViewport;
+		b2AABB mViewRect;
+
+		///the area drawn in the static mesh, larger than the view so that the camera can move before drawing it again
+		b2AABB mStaticRect;
+		///the flags used to draw the static mesh, none before it's drawn the first time
+		uint32 mStaticFlags = UINT_MAX;
+
+		///the vertices drawn so far, that are uploaded to a mesh at once
+		std::vector<Vertex> mVertices;
+		Dojo::AABB mBounds;
 
 		std::vector<b2Vec2> mCircleBuffer;
 
 		void _updateCircleBuffer(const b2Vec2& center, float32 radius);
+
+		bool _isVisible(const b2AABB& aabb) const;
+
+		void _drawBody(const b2Body& body);
+		void _drawFixture(const b2Fixture& fixture, const b2Transform& xf, const b2Color& color);
+
+		void _drawStatic(b2World& world);
+
+		void _upload(Dojo::Mesh& mesh);
 	};
 }
 
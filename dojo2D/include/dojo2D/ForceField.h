@@ -25,6 +25,11 @@ namespace Phys {
 			mContacts.erase(&part);
 		}
 
+		///forgets all the contacts, when they are restored from a saved state
+		void clearContacts() {
+			mContacts.clear();
+		}
+
 		bool isActive() const {
 			return mContacts.size() > 0;
 		}
@@ -35,6 +35,14 @@ namespace Phys {
 			return mJoint;
 		}
 
+		Body& getBodyA() const {
+			return mBodyA;
+		}
+
+		Body& getBodyB() const {
+			return mBodyB;
+		}
+
 		float getDistanceJointLength() const;
 		void setDistanceJointLength(float l);
 
@@ -43,6 +51,11 @@ namespace Phys {
 		void _init(World& world);
 		void _deinit(World& world);
 
+		///destroys the Box2D joint but keeps the joint registered in its bodies, for a lockstep rollback
+		void _suspend(World& world);
+		///creates the Box2D joint again from a saved definition
+		void _resume(World& world, const b2JointDef& def);
+
 	private:
 		//revolute
 		union Desc {
@@ -21,6 +21,22 @@ namespace Phys {
 
 		typedef std::vector<Particle> ParticleList;
 
+		///many water particles laid out by field, that are created together as a single particle group
+		struct ParticleBatch {
+			std::vector<b2Vec2> positions, velocities;
+			std::vector<b2ParticleColor> colors;
+			///the lifetime of all the particles in the batch
+			float lifetime = FLT_MAX;
+
+			void add(const Vector& pos, const Vector& velocity, const Dojo::Color& color);
+
+			void reserve(size_t count);
+
+			size_t size() const {
+				return positions.size();
+			}
+		};
+
 		const Group group;
 		bool autoDeactivate = true;
 
@@ -31,7 +47,10 @@ namespace Phys {
 
 		void addParticles(const ParticleList& particles);
 		void addParticles(ParticleList&& particles);
+		///creates all the particles in the batch at once, prefer this for big amounts of particles
+		void addParticles(ParticleBatch&& batch);
 
+		///applies the same force to every particle
 		void applyForceField(const Dojo::Vector& force);
 		
 		b2ParticleSystem& getParticleSystem() {
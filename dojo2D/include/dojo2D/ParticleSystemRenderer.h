@@ -18,11 +18,24 @@ namespace Phys {
 		virtual void update(float dt) override;
 
 	private:
+		///a vertex in the format of the particle meshes, Position2D + Color + UV0
+		struct ParticleVertex {
+			float x, y;
+			b2ParticleColor color;
+			uint32_t uv;
+		};
+
 		std::unique_ptr<Dojo::Mesh> mesh[2];
 
         std::atomic<bool> rebuilding = {false};
 		ParticleSystem& mParticleSystem;
+
+		///scratch buffers reused by every rebuild on the physics thread
+		std::vector<ParticleVertex> mVertices;
+		std::vector<uint32_t> mQuadIndices;
 	private:
+		///writes the quads of the particles in the view rect into the mesh, on the physics thread
+		void _buildMesh(Dojo::Mesh& mesh, const b2ParticleSystem& particles, const Dojo::AABB& viewRect);
 	};
 
 }
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "common_header.h"
+
+#include "RayResult.h"
+#include "AABBQueryResult.h"
+
+namespace Phys {
+	struct RayQuery {
+		Vector start, end;
+		Group group;
+	};
+
+	struct AreaQuery {
+		Dojo::AABB area;
+		Group group;
+		uint8_t flags;
+	};
+
+	///a list of queries that World runs together in a single command, with a result for each query
+	/**
+	The batch owns the results and keeps their memory when it's cleared, so a batch that is refilled every frame stops
+	allocating once it's warmed up. The batch must stay alive and must not be changed while isPending() is true. */
+	template<typename Query, typename Result>
+	class QueryBatch {
+	public:
+		///removes all the queries, keeping the memory for the next ones
+		void clear() {
+			DEBUG_ASSERT(not isPending(), "The batch is still running");
+			mQueries.clear();
+		}
+
+		void add(const Query& query) {
+			DEBUG_ASSERT(not isPending(), "The batch is still running");
+			mQueries.push_back(query);
+		}
+
+		size_t size() const {
+			return mQueries.size();
+		}
+
+		bool empty() const {
+			return mQueries.empty();
+		}
+
+		///true from when the batch is submitted to when all of its results are ready
+		bool isPending() const {
+			return mPending;
+		}
+
+		const Query& getQuery(size_t i) const {
+			return mQueries[i];
+		}
+
+		///returns the result of the ith query
+		const Result& getResult(size_t i) const {
+			DEBUG_ASSERT(not isPending(), "The results are not ready yet");
+			return mResults[i];
+		}
+
+		void _begin() {
+			DEBUG_ASSERT(not isPending(), "The batch is already running");
+			mResults.resize(mQueries.size());
+			mPending = true;
+		}
+
+		Result& _getResult(size_t i) {
+			return mResults[i];
+		}
+
+		void _end() {
+			mPending = false;
+		}
+
+	private:
+		std::vector<Query> mQueries;
+		std::vector<Result> mResults;
+		std::atomic<bool> mPending = { false };
+	};
+
+	typedef QueryBatch<RayQuery, RayResult> RaycastBatch;
+	typedef QueryBatch<AreaQuery, AABBQueryResult> AABBQueryBatch;
+}
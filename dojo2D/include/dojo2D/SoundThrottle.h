@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common_header.h"
+
+namespace Phys {
+	class Material;
+
+	///SoundThrottle limits how many collision sounds play close to each other, and how many play for each Material
+	/**
+	The recently played sounds are kept in a spatial hash with cells as big as the minimum distance, so checking a new
+	sound only looks at the 9 cells around it. Sounds expire in buckets: there are two generations of the hash, and the
+	older one is dropped every lifetime seconds, so each sound blocks others for one to two lifetimes. */
+	class SoundThrottle {
+	public:
+		explicit SoundThrottle(float minDistance = 0.2f, float lifetime = 0.5f, uint32_t maxVoicesPerMaterial = 8);
+
+		void update(float dt);
+
+		///returns true if a sound of this material can play at pos, and records it as played
+		bool tryPlay(const Vector& pos, const Material& material);
+
+		///forgets all the played sounds
+		void clear();
+
+	private:
+		struct Generation {
+			std::unordered_map<uint64_t, std::vector<Vector>> cells;
+			std::unordered_map<const Material*, uint32_t> voices;
+		};
+
+		const float mMinDistance, mLifetime;
+		const uint32_t mMaxVoicesPerMaterial;
+
+		float mAge = 0;
+		///the current generation and the previous one
+		Generation mGenerations[2];
+
+		uint64_t _getCell(int32_t x, int32_t y) const {
+			return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+		}
+	};
+}
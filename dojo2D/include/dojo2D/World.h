@@ -3,10 +3,15 @@
 #include "common_header.h"
 
 #include "RayResult.h"
-#include "ContactMode.h"
+#include "ContactTable.h"
 #include "WorldListener.h"
 #include "AABBQueryResult.h"
+#include "QueryBatch.h"
+#include "BodySnapshot.h"
+#include "WorldState.h"
+#include "BodyCommand.h"
 #include "ForceField.h"
+#include "SoundThrottle.h"
 
 namespace Phys {
 	class Body;
@@ -21,6 +26,7 @@ namespace Phys {
 	public:
 		typedef std::function<void()> Command;
 		typedef std::function<float()> Controller;
+		typedef std::function<void(uint32_t tick, uint64_t checksum)> ChecksumCallback;
 
 	private:
 		struct DeferredCollision {
@@ -98,10 +104,26 @@ namespace Phys {
 		std::future<RayResult> raycast(const Vector& start, const Vector& end, Phys::Group rayBelongsToGroup = Group::None) const;
 		std::future<AABBQueryResult> AABBQuery(const Dojo::AABB& area, Group group, uint8_t flags = 0) const;
 
+		///runs all the rays in the batch in a single command, then calls callback on the main thread
+		/**
+		Big batches are split between query workers while the physics thread waits, so the world can't change under them.
+		Prefer this to many calls to raycast(), which allocate and go through the command queue once each. */
+		void raycast(RaycastBatch& batch, Command callback = {}) const;
+
+		///runs all the area queries in the batch in a single command, then calls callback on the main thread
+		void AABBQuery(AABBQueryBatch& batch, Command callback = {}) const;
+
 		void applyForceField(const Dojo::AABB& area, Group group, const Vector& force, FieldType type);
 
 		void update(float dt);
 
+		///runs the callbacks in the time left at the end of each frame with the Platform's MainThreadScheduler, instead of all of them in update()
+		void setScheduledCallbacks(bool enable);
+
+		bool hasScheduledCallbacks() const {
+			return mScheduledCallbacks;
+		}
+
 		virtual void BeginContact(b2Contact* contact) override;
 		virtual void EndContact(b2Contact* contact) override;
 		virtual bool ShouldCollide(b2Fixture* fixtureA, b2Fixture* fixtureB) override;
@@ -109,10 +131,26 @@ namespace Phys {
 
 		void sync() const;
 
+		///returns the last state of the bodies published by the physics thread; only the main thread can use it
+		const BodySnapshot& getSnapshot() const {
+			return mSnapshots.getCurrent();
+		}
+
 		void asyncCommand(Command command, Command callback = {}) const;
+
+		///queues a typed command without allocating
+		/**
+		The main thread records the commands in a pooled buffer, that is sent to the physics thread as a single job
+		once per frame, or before the next asyncCommand so that all the commands keep their order. */
+		void bodyCommand(const BodyCommand& command) const;
 		void asyncCallback(Command callback) const;
 		bool isWorkerThread() const;
 
+		///true on the thread that created the world, which reads the snapshots
+		bool isMainThread() const {
+			return std::this_thread::get_id() == mMainThreadID;
+		}
+
 		b2World& getBox2D() {
 			return *mBox2D;
 		}
@@ -124,6 +162,20 @@ namespace Phys {
 		void addBody(Body& body);
 		void removeBody(Body& body);
 
+		///takes the ownership of a destroyed body, that lives until the world doesn't need it anymore
+		void _releaseBody(std::shared_ptr<Dojo::Component> owner);
+
+		///lets the debug drawing know that a static body was created, destroyed, moved or (de)activated, on the physics thread
+		void _onBodyChanged(const b2Body& body) {
+			if (body.GetType() == b2_staticBody) {
+				mStaticBodiesChanged = true;
+			}
+		}
+
+		///gives the body a slot in the snapshots, from the main thread
+		void _addToSnapshots(Body& body);
+		void _removeFromSnapshots(Body& body);
+
 		Joint& addJoint(std::unique_ptr<Joint> joint);
 		void removeJoint(Joint& joint);
 
@@ -144,8 +196,67 @@ namespace Phys {
 
 		void deactivateAllBodies();
 
+		///switches the physics thread to a deterministic lockstep, where each tick is a step of exactly timeStep
+		/**
+		The world only simulates up to the tick allowed by advanceTo(), running the inputs scheduled for each tick right
+		before stepping it. The WorldState is saved before each tick, so an input that arrives late for one of the last
+		rollbackWindow ticks restores the world to that tick and simulates it again up to the current one, without
+		reporting collisions, calling the listeners or showing the ticks in between. The bodies and joints removed in the
+		window are kept inactive until they leave it, so that a rollback can bring them back.
+		Bodies don't fall asleep in lockstep, because Box2D doesn't let their sleep timers be saved. Box2D's broadphase is
+		not saved either, so after a rollback new contacts can be found in a different order than the first time; compare
+		the checksums to detect the desyncs that this can cause.
+		\param onTick called on the main thread with the checksum of each simulated tick, again for the ticks that a
+		rollback simulates again */
+		void startLockstep(uint32_t rollbackWindow, ChecksumCallback onTick = {});
+
+		///lets the lockstep simulation run until the given tick
+		void advanceTo(uint32_t tick);
+
+		///runs input on the physics thread right before the given tick is simulated, also when it's simulated again
+		void scheduleInput(uint32_t tick, Command input);
+
+		///the next tick that the lockstep simulation will step
+		uint32_t getTick() const {
+			return mTick;
+		}
+
+		bool isLockstep() const {
+			return mLockstep;
+		}
+
+		///copies the bodies, contacts, joints and particles in out, on the physics thread
+		void captureState(WorldState& out) const;
+
+		///brings the world back to a captured state, on the physics thread
+		/**
+		The bodies and joints that are not in the state are deactivated until a state that contains them is restored. */
+		void restoreState(const WorldState& state);
+
+		///hashes the state of the live bodies in a snapshot, to compare the simulations of different machines
+		static uint64_t checksum(const BodySnapshot& state);
+
+		struct InactivityResult {
+			uint32_t steps = 0;
+			///the bodies that left the bounds; they are deactivated and the caller should dispose of their objects
+			std::vector<Body*> culledBodies;
+			///false if maxSteps were taken before everything went to sleep
+			bool settled = false;
+		};
+
 		std::unique_ptr<World> createSimulationClone();
-		void simulateToInactivity(float timeStep, uint32_t velocityIterations, uint32_t positionIterations, uint32_t particleIterations, const Dojo::AABB& insideBounds, uint32_t maxSteps = UINT_MAX);
+
+		///steps a simulation clone on the calling thread until all its bodies sleep or leave insideBounds
+		InactivityResult simulateToInactivity(float timeStep, uint32_t velocityIterations, uint32_t positionIterations, uint32_t particleIterations, const Dojo::AABB& insideBounds, uint32_t maxSteps = UINT_MAX);
+
+		///simulates each clone to inactivity in parallel on the pool, and lets update() merge them all into this world
+		/**
+		The clones are independent, so each one is simulated by a single task. Must be called on the main thread, and
+		returns at once: the first update() after all the clones are settled merges them, so the main thread must not wait
+		on the future before that.
+		\param insideBounds the bounds of each clone
+		\returns the result of each clone, once update() merged them */
+		std::future<std::vector<InactivityResult>> settleClones(std::vector<std::unique_ptr<World>> clones, const std::vector<Dojo::AABB>& insideBounds, Dojo::WorkerPool& pool, float timeStep, uint32_t velocityIterations, uint32_t positionIterations, uint32_t particleIterations, uint32_t maxSteps = UINT_MAX);
 
 		void mergeWorld(std::unique_ptr<World> other);
 
@@ -158,19 +269,37 @@ namespace Phys {
 		struct PerformanceInfo {
 			float timeStepUsageFraction;
 			float timeStepSimulationFraction;
+			///the query batches that were split on the background pool, and the average time each took
+			uint32_t parallelQueries;
+			float parallelQueryTime;
+			///the clones merged by settleClones, and the average time between settleClones and their merge
+			uint32_t settledClones;
+			float settleTime;
+			///the pairs that went through the contact filter, and the fraction of them that the contact table rejected
+			uint64_t filteredPairs;
+			float filterRejectedFraction;
+			///the fraction of the simulation time spent by Box2D finding and updating the contacts
+			float contactTimeFraction;
+			///the average time taken to save the state of the world for each lockstep tick, and to restore it on a rollback
+			float stateCaptureTime;
+			float stateRestoreTime;
 		};
 
 		PerformanceInfo queryPerformanceInfo();
 
-		DebugDrawMeshBuilder& createDebugDrawMesh();
+		///draws the world with lines, in Renderables of parent that are only drawn where viewport can see them
+		DebugDrawMeshBuilder& createDebugDrawMesh(Dojo::Object& parent, Dojo::RenderLayer::ID layer, Dojo::Shader& shader, const Dojo::Viewport& viewport);
 #endif
 
 	private:
 
 		std::thread mThread;
-		std::thread::id mWorkerID;
+		///the thread simulating the world, that for a clone is a pool thread while settleClones runs it
+		std::atomic<std::thread::id> mWorkerID = { std::thread::id() };
+		std::thread::id mMainThreadID;
 
 		bool mBodiesStartActive = false;
+		bool mScheduledCallbacks = false;
 		bool mRunning = true;
 		bool mSimulationPaused = true;
 
@@ -181,6 +310,22 @@ namespace Phys {
 		double mTotalIngameTime = 0;
 		double mTotalUsageTime = 0;
 		double mTotalSimulationTime = 0;
+		double mTotalContactTime = 0;
+		uint64_t mFilteredPairs = 0;
+		uint64_t mRejectedPairs = 0;
+
+		uint32_t mStateCaptures = 0, mStateRestores = 0;
+		double mTotalCaptureTime = 0, mTotalRestoreTime = 0;
+		bool mSlowStateReported = false;
+
+		///warns once if saving or restoring the state would take more than 1 ms for 2000 bodies
+		void _checkStateTime(bool restore, double seconds);
+
+		mutable std::atomic<uint32_t> mParallelQueries = { 0 };
+		mutable std::atomic<uint64_t> mParallelQueryNanoseconds = { 0 };
+
+		uint32_t mSettledClones = 0;
+		double mTotalSettleTime = 0;
 #endif
 
 		Dojo::SmallSet<WorldListener*> mListeners;
@@ -192,23 +337,135 @@ namespace Phys {
 		std::unique_ptr<Dojo::SPSCQueue<DeferredCollision>> mDeferredCollisions;
 		std::unique_ptr<Dojo::SPSCQueue<DeferredSensorCollision>> mDeferredSensorCollisions;
 
+		///all the body command buffers, owned by the main thread
+		mutable std::vector<std::unique_ptr<BodyCommandBuffer>> mBodyCommandBuffers;
+		///the buffer being recorded by the main thread
+		mutable BodyCommandBuffer* mPendingBodyCommands = nullptr;
+		///the buffers given back by the physics thread after running them
+		std::unique_ptr<Dojo::SPSCQueue<BodyCommandBuffer*>> mFreeBodyCommands;
+
 		Dojo::SmallSet<Body*> mBodies;
 		Dojo::SmallSet<std::unique_ptr<Joint>> mJoints;
 		Dojo::SmallSet<ParticleSystem*> mParticleSystems;
 
-		static const int GROUP_COUNT = 256; //HACK
-		ContactMode mCollideMode[GROUP_COUNT][GROUP_COUNT];
+		///the clones given to a settleClones call, that update() merges when the pool is done with all of them
+		struct PendingSettle {
+			std::vector<std::unique_ptr<World>> clones;
+			std::vector<InactivityResult> results;
+			std::atomic<size_t> remaining;
+			std::promise<std::vector<InactivityResult>> promise;
+			std::chrono::high_resolution_clock::time_point startTime;
+		};
+
+		///only used by the main thread
+		std::vector<std::shared_ptr<PendingSettle>> mPendingSettles;
+
+		///batches with less queries than this run on the physics thread alone
+		static constexpr size_t MIN_PARALLEL_QUERIES = 64;
+
+		ContactTable mContactModes;
 		
-		float mRemoveNextSound = 0;
-		std::deque<Vector> mRecentlyPlayedSoundPositions;
+		SoundThrottle mSoundThrottle;
+
+		struct BodyPairHash {
+			size_t operator()(const std::pair<const Body*, const Body*>& pair) const {
+				return std::hash<const Body*>()(pair.first) * 31 + std::hash<const Body*>()(pair.second);
+			}
+		};
+
+		///the collisions that began in the current step, one per pair of bodies, only used by the physics thread
+		std::unordered_map<std::pair<const Body*, const Body*>, DeferredCollision, BodyPairHash> mStepCollisions;
 
 		std::unordered_set<BodyPart*> mActiveForceFields;
 
 		std::unique_ptr<DebugDrawMeshBuilder> mDebugMeshBuilder;
+		///set when a static body changes, so that the debug drawing draws them again
+		std::atomic<bool> mStaticBodiesChanged = { false };
+
+		BodySnapshotBuffer mSnapshots;
+		///the body in each snapshot slot, only used by the main thread
+		std::vector<Body*> mSnapshotOwners;
+		std::vector<uint32_t> mFreeSnapshotSlots;
+		uint32_t mNextSnapshotId = 1;
+		///the number of slots used by the bodies on the physics thread
+		uint32_t mSnapshotSize = 0;
+
+		std::atomic<bool> mLockstep = { false };
+		std::atomic<uint32_t> mTick = { 0 }, mTargetTick = { 0 };
+		ChecksumCallback mOnTick;
+		uint64_t mLastChecksum = 0;
+
+		///the states saved at the start of the last ticks, only used by the physics thread
+		std::vector<WorldState> mSavedStates;
+		///the inputs of the ticks that can still be simulated again, only used by the physics thread
+		std::map<uint32_t, std::vector<Command>> mInputs;
+		///the earliest tick that got a late input, UINT_MAX if none
+		uint32_t mRollbackTick = UINT_MAX;
+		///true while the world is restored and simulated again, when nothing is reported outside
+		bool mReplaying = false;
+		///the state when the last rollback started, which has the bodies created after the last saved tick
+		WorldState mRollbackState;
+
+		///the bodies and joints removed in lockstep, kept until their tick leaves the rollback window
+		struct RetiredBody {
+			Body* body;
+			uint32_t tick;
+			std::shared_ptr<Dojo::Component> owner;
+		};
+
+		struct RetiredJoint {
+			std::unique_ptr<Joint> joint;
+			uint32_t tick;
+		};
+
+		std::vector<RetiredBody> mRetiredBodies;
+		std::vector<RetiredJoint> mRetiredJoints;
+		///the bodies that are not in the state restored by the last rollback, inactive until they are
+		std::vector<Body*> mSuspendedBodies;
+
+		///simulates a step and updates everything that depends on it, on the physics thread
+		void _step(float dt, int velocityIterations, int positionIterations, int particleIterations);
+
+		///saves the state, runs the inputs and simulates the next lockstep tick
+		void _stepTick(float dt, int velocityIterations, int positionIterations, int particleIterations);
+
+		///restores the state saved at the start of tick, and simulates again all the ticks after it
+		void _rollback(uint32_t tick, float dt, int velocityIterations, int positionIterations, int particleIterations);
+
+		///adds and removes the bodies and joints that exist in the state but not in the world, or the other way around
+		/**
+		\param restore also moves all the other joints to their state, otherwise only the added bodies and joints are */
+		void _matchState(const WorldState& state, bool restore);
+		void _restoreBody(Body& body, const BodySnapshot& state);
+		void _restoreContacts(const WorldState& state);
+		void _restoreParticles(const WorldState& state);
+
+		///destroys for good the bodies and joints that a rollback can't bring back anymore
+		void _destroyRetired();
+		bool _isRetired(const Body& body) const;
+
+		///copies the state of all the bodies in a snapshot
+		void _captureBodies(BodySnapshot& snapshot) const;
+
+		///writes the state of all the bodies in a new snapshot and publishes it, on the physics thread
+		void _publishSnapshot();
+		///moves the objects of the bodies to their state in the last snapshots, on the main thread
+		void _applySnapshots();
+
+		///sends the pending body commands to the physics thread, from the main thread
+		void _flushBodyCommands() const;
+
+		void _raycast(const Vector& start, const Vector& end, Group rayBelongsToGroup, RayResult& result) const;
+		void _AABBQuery(const Dojo::AABB& area, Group group, uint8_t flags, AABBQueryResult& result) const;
+
+		///calls task on ranges of [0, count), in parallel on the background pool if count is big enough, and returns when all are done
+		void _parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& task) const;
 
-		float _closestRecentlyPlayedSound(const Vector& point);	
 		void _beginFieldContact(BodyPart& partA, BodyPart& partB);
 
+		///merges the clones of the settleClones calls that are done, on the main thread
+		void _mergeSettledClones();
+
 		World();
 	};
 }
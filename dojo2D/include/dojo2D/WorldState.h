@@ -0,0 +1,72 @@
+#pragma once
+
+#include "common_header.h"
+
+#include "BodySnapshot.h"
+
+namespace Phys {
+	///everything that a step of a World depends on, saved at the start of a tick so that the tick can be simulated again
+	/**
+	Contacts and joints refer to their bodies by snapshot slot and to fixtures by their index in the fixture list of
+	their body, so a state can only be restored in a world that has the same bodies in the same slots, like the world
+	that saved it or the world of another machine running the same lockstep. */
+	struct WorldState {
+		enum ContactFlags : uint8_t {
+			Touching = 1 << 0,
+			Enabled = 1 << 1
+		};
+
+		///a contact between two fixtures, with the manifold that holds the impulses that warm start it
+		struct Contact {
+			uint32_t slotA, slotB;
+			uint16_t fixtureA, fixtureB;
+			uint16_t childA, childB;
+			uint8_t flags;
+			b2Manifold manifold;
+		};
+
+		struct Joint {
+			uint32_t slotA, slotB;
+			b2JointType type;
+			bool collideConnected, enableMotor;
+			b2Vec2 localAnchorA, localAnchorB;
+			float referenceAngle, motorSpeed, maxMotorTorque;
+			float length, frequencyHz, dampingRatio;
+			///the impulses that warm start the joint: point and angle impulse for revolute joints, only x for distance joints
+			b2Vec3 impulse;
+			float motorImpulse;
+		};
+
+		///the particles of a particle system, laid out by field like LiquidFun does
+		struct Particles {
+			std::vector<b2Vec2> positions, velocities;
+			std::vector<uint32> flags;
+			std::vector<b2ParticleColor> colors;
+			std::vector<float> lifetimes;
+
+			size_t size() const {
+				return positions.size();
+			}
+		};
+
+		uint32_t tick = UINT_MAX;
+
+		BodySnapshot bodies;
+		///the contacts in the order of the contact list of the world
+		std::vector<Contact> contacts;
+		std::vector<Joint> joints;
+		///the particles of each particle system of the world, in the order they were added
+		std::vector<Particles> particles;
+
+		///appends a compact binary copy of the state to out
+		/**
+		Only the live body slots are written, without their masses, and only the used points of the manifolds.
+		The bytes are in the order of the machine, like the other binary formats of the engine. */
+		void serialize(std::vector<uint8_t>& out) const;
+
+		///reads a state written by serialize
+		/**
+		\returns false if the data is truncated or malformed, in which case the state must not be restored */
+		bool deserialize(vec_view<uint8_t> data);
+	};
+}
@@ -28,6 +28,11 @@ Body::Body(Dojo::Object& object, World& world, Group group, bool staticShape, bo
 		//bodyDef.bullet = true;
 	}
 
+	mLinearDamping = bodyDef.linearDamping;
+	mAngularDamping = bodyDef.angularDamping;
+
+	world._addToSnapshots(self);
+
 	//only enable this on attach
 	bodyDef.awake = bodyDef.active = world.shouldCreateBodiesAsActive();
 	bodyDef.userData = this;
@@ -74,6 +79,7 @@ Phys::BodyPart& Phys::Body::_addShape(std::shared_ptr<b2Shape> shape, const Mate
 		fixtureDef.userData = (void*)&part;
 
 		part.fixture = *mBody.unwrap().CreateFixture(&fixtureDef);
+		getWorld()._onBodyChanged(mBody.unwrap());
 	};
 	getWorld().asyncCommand(std::move(f));
 
@@ -92,6 +98,7 @@ void Body::removePart(BodyPart& part) {
 	mParts.erase(elem);
 	getWorld().asyncCommand([this, part = std::move(temp)] {
 		mBody.unwrap().DestroyFixture(&part->getFixture());
+		getWorld()._onBodyChanged(mBody.unwrap());
 	});
 }
 
@@ -100,6 +107,7 @@ void Phys::Body::removeAllParts() {
 		for (auto&& part : parts) {
 			mBody.unwrap().DestroyFixture(&part->getFixture());
 		}
+		getWorld()._onBodyChanged(mBody.unwrap());
 	});
 }
 
@@ -178,22 +186,28 @@ void Body::destroyPhysics() {
 
 	getWorld().asyncCommand([&] {
 		if (mBody.is_some()) {
-			mParts.clear(); //delete all parts
-
 			getWorld().removeBody(self);
-			getWorld().getBox2D().DestroyBody(mBody.to_raw_ptr());
-			mBody = {};
 		}
 	});
 }
 
+void Body::_destroyB2Body() {
+	mParts.clear(); //delete all parts
+
+	getWorld()._onBodyChanged(mBody.unwrap());
+	getWorld().getBox2D().DestroyBody(mBody.to_raw_ptr());
+	mBody = {};
+}
+
 void Body::onDestroy(std::unique_ptr<Component> myself) {
+	getWorld()._removeFromSnapshots(self);
+
 	if(mBody.is_some()) {
 		destroyPhysics(); //it's safe to call this even if it was already happening because of onDispose()
 
-		//assign it to a task so that it can survive until it's destroyed
-		getWorld().asyncCommand([owned = std::shared_ptr<Component>(std::move(myself))]() mutable {
-			owned = {};
+		//assign it to a task so that it can survive until it's destroyed, or until the world can't roll it back
+		getWorld().asyncCommand([this, owned = std::shared_ptr<Component>(std::move(myself))]() mutable {
+			getWorld()._releaseBody(std::move(owned));
 		});
 	}
 
@@ -209,47 +223,83 @@ void Body::onSimulationPaused() {
 	object.speed = Vector::Zero;
 }
 
-void Body::updateObject() {
-	//TODO this should just set the interpolation target rather than the actual transform?
-	auto& t = mBody.unwrap().GetTransform();
+void Body::updateObject(const Vector& position, Radians angle, const Vector& velocity, bool fixedRotation) {
+	object.position = position;
+	object.speed = velocity;
 
-	object.position = asVec(t.p);
-	object.speed = asVec(mBody.unwrap().GetLinearVelocity());
+	//fixed rotation bodies follow the rotation of the object instead
+	if (not fixedRotation) {
+		object.setRoll(angle);
+	}
+}
 
-	if (mBody.unwrap().IsFixedRotation()) {
-		mBody.unwrap().SetTransform(t.p, object.getRoll());
+void Body::_updateFixedRotation() {
+	auto& body = mBody.unwrap();
+	body.SetTransform(body.GetPosition(), object.getRoll());
+}
+
+void Body::_execute(const BodyCommand& command) {
+	auto& body = mBody.unwrap();
+	switch (command.op) {
+	case BodyCommand::Op::ApplyForce:
+		body.ApplyForceToCenter(command.vector, true);
+		break;
+	case BodyCommand::Op::ApplyForceAtWorldPoint:
+		body.ApplyForce(command.vector, command.point, true);
+		break;
+	case BodyCommand::Op::ApplyForceAtLocalPoint:
+		body.ApplyForce(command.vector, body.GetWorldPoint(command.point), true);
+		break;
+	case BodyCommand::Op::ApplyTorque:
+		body.ApplyTorque(command.scalar, true);
+		break;
+	case BodyCommand::Op::ForcePosition:
+		body.SetTransform(command.vector, body.GetAngle());
+		getWorld()._onBodyChanged(body);
+		break;
+	case BodyCommand::Op::ForceRotation:
+		body.SetTransform(body.GetPosition(), command.scalar);
+		getWorld()._onBodyChanged(body);
+		break;
+	case BodyCommand::Op::ForceVelocity:
+		body.SetLinearVelocity(command.vector);
+		break;
+	case BodyCommand::Op::SetTransform:
+		body.SetTransform(command.vector, command.scalar);
+		getWorld()._onBodyChanged(body);
+		break;
+	case BodyCommand::Op::SetActive: {
+		bool active = command.scalar != 0;
+		if (not isStatic()) {
+			body.SetAwake(active);
+		}
+
+		body.SetActive(active);
+		getWorld()._onBodyChanged(body);
+		break;
 	}
-	else {
-		object.setRoll(Radians(t.q.GetAngle()));
+	default:
+		FAIL("Unknown body command");
 	}
 }
 
 void Body::applyForce(const Vector& force) {
 	DEBUG_ASSERT(force.isValid(), "This will hang up b2d mang");
-	getWorld().asyncCommand([ = ]() {
-		mBody.unwrap().ApplyForceToCenter(asB2Vec(force), true);
-	});
+	getWorld().bodyCommand({ BodyCommand::Op::ApplyForce, this, asB2Vec(force) });
 }
 
 void Body::applyForceAtWorldPoint(const Vector& force, const Vector& worldPoint) {
 	DEBUG_ASSERT(force.isValid(), "This will hang up b2d mang");
-	getWorld().asyncCommand([ = ]() {
-		mBody.unwrap().ApplyForce(asB2Vec(force), asB2Vec(worldPoint), true);
-	});
+	getWorld().bodyCommand({ BodyCommand::Op::ApplyForceAtWorldPoint, this, asB2Vec(force), asB2Vec(worldPoint) });
 }
 
 void Body::applyForceAtLocalPoint(const Vector& force, const Vector& localPoint) {
 	DEBUG_ASSERT(force.isValid(), "This will hang up b2d mang");
-	getWorld().asyncCommand([ = ]() {
-		b2Vec2 worldPoint = mBody.unwrap().GetWorldPoint(asB2Vec(localPoint));
-		mBody.unwrap().ApplyForce(asB2Vec(force), worldPoint, true);
-	});
+	getWorld().bodyCommand({ BodyCommand::Op::ApplyForceAtLocalPoint, this, asB2Vec(force), asB2Vec(localPoint) });
 }
 
 void Body::applyTorque(float t) {
-	getWorld().asyncCommand([ = ]() {
-		mBody.unwrap().ApplyTorque(t, true);
-	});
+	getWorld().bodyCommand({ BodyCommand::Op::ApplyTorque, this, {}, {}, t });
 }
 
 void Body::setFixedRotation(bool enable) {
@@ -271,32 +321,25 @@ void Phys::Body::setGravityScale(float scale) {
 }
 
 void Body::forcePosition(const Vector& position) {
-	getWorld().asyncCommand([ = ]() {
-		auto t = mBody.unwrap().GetTransform();
-		mBody.unwrap().SetTransform(asB2Vec(position), t.q.GetAngle());
-	});
+	getWorld().bodyCommand({ BodyCommand::Op::ForcePosition, this, asB2Vec(position) });
 }
 
 void Body::forceRotation(Radians angle) {
-	getWorld().asyncCommand([ = ]() {
-		auto t = mBody.unwrap().GetTransform();
-		mBody.unwrap().SetTransform(t.p, angle);
-	});
+	getWorld().bodyCommand({ BodyCommand::Op::ForceRotation, this, {}, {}, angle });
 }
 
 void Body::setTransform(const Vector& position, Radians angle) {
-	getWorld().asyncCommand([ = ]() {
-		mBody.unwrap().SetTransform(asB2Vec(position), angle);
-	});
+	getWorld().bodyCommand({ BodyCommand::Op::SetTransform, this, asB2Vec(position), {}, angle });
 }
 
 void Body::forceVelocity(const Vector& velocity) {
-	getWorld().asyncCommand([ = ]() {
-		mBody.unwrap().SetLinearVelocity(asB2Vec(velocity));
-	});
+	getWorld().bodyCommand({ BodyCommand::Op::ForceVelocity, this, asB2Vec(velocity) });
 }
 
 void Body::setDamping(float linear, float angular) {
+	mLinearDamping = linear;
+	mAngularDamping = angular;
+
 	getWorld().asyncCommand([=]() {
 		mBody.unwrap().SetLinearDamping(linear);
 		mBody.unwrap().SetAngularDamping(angular);
@@ -304,25 +347,22 @@ void Body::setDamping(float linear, float angular) {
 }
 
 float Body::getLinearDamping() const {
-	return _waitForBody().GetLinearDamping();
+	return mLinearDamping;
 }
 
 float Body::getAngularDamping() const {
-	return _waitForBody().GetAngularDamping();
+	return mAngularDamping;
 }
 
 Dojo::Vector Body::getPosition() const {
+	if (auto snapshot = _getSnapshot().to_ref()) {
+		return asVec(snapshot.get().positions[mSnapshotSlot]);
+	}
 	return asVec(_waitForBody().GetPosition());
 }
 
 void Phys::Body::setActive(bool active) {
-	getWorld().asyncCommand([this, active]() {
-		if (not isStatic()) {
-			mBody.unwrap().SetAwake(active);
-		}
-
-		mBody.unwrap().SetActive(active);
-	});
+	getWorld().bodyCommand({ BodyCommand::Op::SetActive, this, {}, {}, active ? 1.f : 0.f });
 }
 
 b2BodyDef Body::makeDefinition() const {
@@ -347,6 +387,9 @@ b2BodyDef Body::makeDefinition() const {
 }
 
 void Phys::Body::changeWorld(World& newWorld) {
+	getWorld()._removeFromSnapshots(self);
+	newWorld._addToSnapshots(self);
+
 	newWorld.asyncCommand([this, &newWorld] {
 		//recreate the body in the new world
 		auto def = makeDefinition();
@@ -359,28 +402,35 @@ void Phys::Body::changeWorld(World& newWorld) {
 			auto fixtureDef = part->makeDefinition();
 			part->_resetFixture(*mBody.unwrap().CreateFixture(&fixtureDef));
 		}
+		newWorld._onBodyChanged(mBody.unwrap());
 
 		//TODO remove the old body
 	});
 }
 
 float Body::getMass() const {
+	if (auto snapshot = _getSnapshot().to_ref()) {
+		return snapshot.get().masses[mSnapshotSlot];
+	}
 	return _waitForBody().GetMass();
 }
 
 Vector Body::getLocalPoint(const Vector& worldPosition) const {
-	return asVec(_waitForBody().GetLocalPoint(asB2Vec(worldPosition)));
+	return asVec(b2MulT(_getTransform(), asB2Vec(worldPosition)));
 }
 
 Phys::Vector Phys::Body::getLocalDirection(const Vector& worldDirection) const {
-	return asVec(_waitForBody().GetLocalVector(asB2Vec(worldDirection)));
+	return asVec(b2MulT(_getTransform().q, asB2Vec(worldDirection)));
 }
 
 Vector Body::getWorldPoint(const Vector& localPosition) const {
-	return asVec(_waitForBody().GetWorldPoint(asB2Vec(localPosition)));
+	return asVec(b2Mul(_getTransform(), asB2Vec(localPosition)));
 }
 
 Vector Body::getVelocity() const {
+	if (auto snapshot = _getSnapshot().to_ref()) {
+		return asVec(snapshot.get().velocities[mSnapshotSlot]);
+	}
 	return asVec(_waitForBody().GetLinearVelocity());
 }
 
@@ -389,6 +439,9 @@ Vector Body::getVelocityAtLocalPoint(const Vector& localPoint) const {
 }
 
 float Body::getAngularVelocity() const {
+	if (auto snapshot = _getSnapshot().to_ref()) {
+		return snapshot.get().angularVelocities[mSnapshotSlot];
+	}
 	return _waitForBody().GetAngularVelocity();
 }
 
@@ -411,6 +464,25 @@ b2Body& Body::_waitForBody() const {
 	return mBody.unwrap();
 }
 
+optional_ref<const BodySnapshot> Body::_getSnapshot() const {
+	auto& world = getWorld();
+	if (world.isMainThread() and not world.isWorkerThread()) {
+		auto& snapshot = world.getSnapshot();
+		if (snapshot.contains(mSnapshotSlot, mSnapshotId)) {
+			return snapshot;
+		}
+	}
+	return{};
+}
+
+b2Transform Body::_getTransform() const {
+	if (auto snapshot = _getSnapshot().to_ref()) {
+		auto& s = snapshot.get();
+		return{ s.positions[mSnapshotSlot], b2Rot(s.angles[mSnapshotSlot]) };
+	}
+	return _waitForBody().GetTransform();
+}
+
 void Body::_registerJoint(Joint& joint) {
 	DEBUG_ASSERT(not mJoints.contains(&joint), "Joint already registered");
 	mJoints.emplace(&joint);
@@ -430,5 +502,12 @@ float Body::getWeight() const {
 }
 
 bool Body::isPushable() const {
-	return mPushable and _waitForBody().IsActive() and not isStatic();
+	if (not mPushable or isStatic()) {
+		return false;
+	}
+
+	if (auto snapshot = _getSnapshot().to_ref()) {
+		return (snapshot.get().flags[mSnapshotSlot] & BodySnapshot::Active) != 0;
+	}
+	return _waitForBody().IsActive();
 }
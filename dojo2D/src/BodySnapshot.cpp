@@ -0,0 +1,32 @@
+#include "BodySnapshot.h"
+
+using namespace Phys;
+
+void BodySnapshot::reset(size_t size) {
+	//the free slots are zeroed too, so that no stale state survives in them
+	ids.assign(size, 0);
+	positions.assign(size, b2Vec2_zero);
+	velocities.assign(size, b2Vec2_zero);
+	angles.assign(size, 0.f);
+	angularVelocities.assign(size, 0.f);
+	masses.assign(size, 0.f);
+	flags.assign(size, 0);
+}
+
+void BodySnapshotBuffer::publish() {
+	//release, so that the content of the buffer is visible to the thread that acquires it
+	auto old = mReady.exchange(mWriteIndex | NewFlag, std::memory_order_acq_rel);
+	mWriteIndex = old & IndexMask;
+}
+
+bool BodySnapshotBuffer::acquire() {
+	if ((mReady.load(std::memory_order_relaxed) & NewFlag) == 0) {
+		return false;
+	}
+
+	//give back the oldest buffer, the publisher can only set the flag again so the exchange always gets a new snapshot
+	auto ready = mReady.exchange(mPreviousIndex, std::memory_order_acq_rel);
+	mPreviousIndex = mCurrentIndex;
+	mCurrentIndex = ready & IndexMask;
+	return true;
+}
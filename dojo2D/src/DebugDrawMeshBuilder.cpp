@@ -4,23 +4,244 @@
 using namespace Dojo;
 
 namespace Phys {
-	DebugDrawMeshBuilder::DebugDrawMeshBuilder() {
+	static std::unique_ptr<Mesh> _makeDebugMesh() {
+		auto mesh = make_unique<Mesh>();
+		mesh->setTriangleMode(PrimitiveMode::LineList);
+		mesh->setVertexFields({ VertexField::Position2D, VertexField::Color });
+		mesh->setIndexByteSize(sizeof(uint32_t)); //big levels have more than 64k vertices
+		mesh->setDynamic(true);
+		return mesh;
+	}
+
+	DebugDrawMeshBuilder::DebugDrawMeshBuilder(Object& parent, RenderLayer::ID layer, Shader& shader, const Viewport& viewport) :
+		mViewport(viewport) {
 		SetFlags(e_shapeBit | e_jointBit | e_pairBit);
 
-		mMesh = make_unique<Mesh>();
-		mMesh->setTriangleMode(PrimitiveMode::LineList);
-		mMesh->setVertexFields({ VertexField::Position2D, VertexField::Color });
-		mMesh->setDynamic(true);
+		mMesh = _makeDebugMesh();
+		mStaticMesh = _makeDebugMesh();
+
+		mViewRect.lowerBound = mViewRect.upperBound = b2Vec2_zero;
+		mStaticRect = mViewRect;
+
+		//the Renderables are added to the renderer directly, like the layers of a TextArea, so parent can have its own
+		mStaticRenderable = make_unique<Renderable>(parent, layer, *mStaticMesh, shader);
+		mRenderable = make_unique<Renderable>(parent, layer, *mMesh, shader);
+
+		auto& renderer = Platform::singleton().getRenderer();
+		renderer.addRenderable(*mStaticRenderable);
+		renderer.addRenderable(*mRenderable);
+	}
+
+	DebugDrawMeshBuilder::~DebugDrawMeshBuilder() {
+		auto& renderer = Platform::singleton().getRenderer();
+		renderer.removeRenderable(*mRenderable);
+		renderer.removeRenderable(*mStaticRenderable);
+	}
+
+	void DebugDrawMeshBuilder::setEnabled(bool enable) {
+		mEnabled = enable;
+		mRenderable->setVisible(enable);
+		mStaticRenderable->setVisible(enable);
 	}
 
-	void DebugDrawMeshBuilder::update(b2World& world) {
-		if (mEnabled) {
-			mMesh->begin();
+	void DebugDrawMeshBuilder::update(b2World& world, bool staticChanged) {
+		if (not mEnabled) {
+			return;
+		}
+
+		auto flags = GetFlags();
+
+		auto& rect = mViewport.getGraphicsAABB();
+		mViewRect.lowerBound = asB2Vec(rect.min);
+		mViewRect.upperBound = asB2Vec(rect.max);
 
-			world.DrawDebugData();
+		//the static mesh is only drawn and uploaded again when the static bodies change, or when the view leaves it
+		auto staticFlags = flags & e_shapeBit;
+		if (staticChanged or staticFlags != mStaticFlags or not mStaticRect.Contains(mViewRect)) {
+			mStaticFlags = staticFlags;
 
-			mMesh->end();
+			auto margin = 0.5f * (mViewRect.upperBound - mViewRect.lowerBound);
+			mStaticRect.lowerBound = mViewRect.lowerBound - margin;
+			mStaticRect.upperBound = mViewRect.upperBound + margin;
+
+			_drawStatic(world);
 		}
+
+		mVertices.clear();
+		mBounds = AABB::Invalid;
+
+		if (flags & (e_shapeBit | e_aabbBit)) {
+			for (auto body = world.GetBodyList(); body; body = body->GetNext()) {
+				if ((flags & e_shapeBit) and body->GetType() != b2_staticBody) {
+					_drawBody(*body);
+				}
+
+				if ((flags & e_aabbBit) and body->IsActive()) {
+					const b2Color color(0.9f, 0.3f, 0.9f);
+					for (auto fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+						for (auto i : range(fixture->GetShape()->GetChildCount())) {
+							auto& aabb = fixture->GetAABB(i);
+							if (_isVisible(aabb)) {
+								b2Vec2 vs[] = {
+									aabb.lowerBound,
+									{ aabb.upperBound.x, aabb.lowerBound.y },
+									aabb.upperBound,
+									{ aabb.lowerBound.x, aabb.upperBound.y }
+								};
+								DrawPolygon(vs, 4, color);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		if (flags & e_jointBit) {
+			const b2Color color(0.5f, 0.8f, 0.8f);
+			for (auto joint = world.GetJointList(); joint; joint = joint->GetNext()) {
+				auto a = joint->GetAnchorA();
+				auto b = joint->GetAnchorB();
+
+				b2AABB aabb;
+				aabb.lowerBound = b2Min(a, b);
+				aabb.upperBound = b2Max(a, b);
+				if (_isVisible(aabb)) {
+					DrawSegment(a, b, color);
+				}
+			}
+		}
+
+		if (flags & e_pairBit) {
+			const b2Color color(0.9f, 0.9f, 0.3f);
+			b2WorldManifold manifold;
+			for (auto contact = world.GetContactList(); contact; contact = contact->GetNext()) {
+				if (not contact->IsTouching()) {
+					continue;
+				}
+
+				contact->GetWorldManifold(&manifold);
+				for (auto i : range(contact->GetManifold()->pointCount)) {
+					auto& p = manifold.points[i];
+					b2AABB aabb = { p, p };
+					if (_isVisible(aabb)) {
+						DrawSegment(p, p + 0.1f * manifold.normal, color);
+					}
+				}
+			}
+		}
+
+		if (flags & e_particleBit) {
+			for (auto ps = world.GetParticleSystemList(); ps; ps = ps->GetNext()) {
+				DrawParticles(ps->GetPositionBuffer(), ps->GetRadius(), ps->GetColorBuffer(), ps->GetParticleCount());
+			}
+		}
+
+		_upload(*mMesh);
+	}
+
+	void DebugDrawMeshBuilder::_drawStatic(b2World& world) {
+		mVertices.clear();
+		mBounds = AABB::Invalid;
+
+		if (mStaticFlags & e_shapeBit) {
+			for (auto body = world.GetBodyList(); body; body = body->GetNext()) {
+				if (body->GetType() == b2_staticBody) {
+					_drawBody(*body);
+				}
+			}
+		}
+
+		_upload(*mStaticMesh);
+	}
+
+	bool DebugDrawMeshBuilder::_isVisible(const b2AABB& aabb) const {
+		return b2TestOverlap(aabb, mViewRect);
+	}
+
+	void DebugDrawMeshBuilder::_drawBody(const b2Body& body) {
+		auto fixture = body.GetFixtureList();
+		if (not fixture) {
+			return;
+		}
+
+		auto& xf = body.GetTransform();
+
+		//cull the bodies as a whole, the static ones against the area of the static mesh.
+		//The inactive bodies have no AABBs in the broadphase, so they are computed from the shapes
+		b2AABB aabb, childAABB;
+		fixture->GetShape()->ComputeAABB(&aabb, xf, 0);
+		for (auto f = fixture; f; f = f->GetNext()) {
+			for (auto i : range(f->GetShape()->GetChildCount())) {
+				f->GetShape()->ComputeAABB(&childAABB, xf, i);
+				aabb.Combine(childAABB);
+			}
+		}
+
+		bool visible = body.GetType() == b2_staticBody ? b2TestOverlap(aabb, mStaticRect) : _isVisible(aabb);
+		if (not visible) {
+			return;
+		}
+
+		b2Color color;
+		if (not body.IsActive()) {
+			color = b2Color(0.5f, 0.5f, 0.3f);
+		}
+		else if (body.GetType() == b2_staticBody) {
+			color = b2Color(0.5f, 0.9f, 0.5f);
+		}
+		else if (body.GetType() == b2_kinematicBody) {
+			color = b2Color(0.5f, 0.5f, 0.9f);
+		}
+		else if (not body.IsAwake()) {
+			color = b2Color(0.6f, 0.6f, 0.6f);
+		}
+		else {
+			color = b2Color(0.9f, 0.7f, 0.7f);
+		}
+
+		for (; fixture; fixture = fixture->GetNext()) {
+			_drawFixture(*fixture, xf, color);
+		}
+	}
+
+	void DebugDrawMeshBuilder::_drawFixture(const b2Fixture& fixture, const b2Transform& xf, const b2Color& color) {
+		switch (fixture.GetType()) {
+		case b2Shape::e_circle: {
+			auto circle = (const b2CircleShape*)fixture.GetShape();
+			DrawSolidCircle(b2Mul(xf, circle->m_p), circle->m_radius, b2Mul(xf.q, b2Vec2(1.0f, 0.0f)), color);
+			break;
+		}
+		case b2Shape::e_edge: {
+			auto edge = (const b2EdgeShape*)fixture.GetShape();
+			DrawSegment(b2Mul(xf, edge->m_vertex1), b2Mul(xf, edge->m_vertex2), color);
+			break;
+		}
+		case b2Shape::e_chain: {
+			auto chain = (const b2ChainShape*)fixture.GetShape();
+			for (int32 i = 1; i < chain->m_count; ++i) {
+				DrawSegment(b2Mul(xf, chain->m_vertices[i - 1]), b2Mul(xf, chain->m_vertices[i]), color);
+			}
+			break;
+		}
+		case b2Shape::e_polygon: {
+			auto poly = (const b2PolygonShape*)fixture.GetShape();
+			b2Vec2 vertices[b2_maxPolygonVertices];
+			for (int32 i = 0; i < poly->m_count; ++i) {
+				vertices[i] = b2Mul(xf, poly->m_vertices[i]);
+			}
+			DrawSolidPolygon(vertices, poly->m_count, color);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	void DebugDrawMeshBuilder::_upload(Mesh& mesh) {
+		auto count = (Mesh::IndexType)mVertices.size();
+		mesh.begin(std::max<Mesh::IndexType>(1, count));
+		mesh.appendRawVertexData(mVertices.data(), count, mBounds);
+		mesh.end();
 	}
 
 	void DebugDrawMeshBuilder::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) {
@@ -63,18 +284,30 @@ namespace Phys {
 	}
 
 	void DebugDrawMeshBuilder::DrawParticles(const b2Vec2 *centers, float32 radius, const b2ParticleColor *colors, int32 count) {
-		DEBUG_TODO;
+		//draw a cross for each visible particle
+		const b2Color defaultColor(0.3f, 0.5f, 0.9f);
+		for (auto i : range(count)) {
+			auto& p = centers[i];
+			b2AABB aabb = { p, p };
+			if (not _isVisible(aabb)) {
+				continue;
+			}
+
+			auto color = colors ? colors[i].GetColor() : defaultColor;
+			DrawSegment({ p.x - radius, p.y }, { p.x + radius, p.y }, color);
+			DrawSegment({ p.x, p.y - radius }, { p.x, p.y + radius }, color);
+		}
 	}
 
 	void DebugDrawMeshBuilder::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color) {
-		mMesh->vertex(asVec(p1));
-		mMesh->color(asColor(color));
+		auto rgba = asColor(color).toRGBA();
+		mVertices.push_back({ p1.x, p1.y, rgba });
+		mVertices.push_back({ p2.x, p2.y, rgba });
 
-		mMesh->vertex(asVec(p2));
-		mMesh->color(asColor(color));
+		mBounds = mBounds.expandToFit(asVec(p1)).expandToFit(asVec(p2));
 	}
 
 	void DebugDrawMeshBuilder::DrawTransform(const b2Transform& xf) {
 		DEBUG_TODO;
 	}
-}
\ No newline at end of file
+}
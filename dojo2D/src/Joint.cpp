@@ -106,6 +106,8 @@ Joint::b2MultiJointDesc Joint::makeDefinition() const {
 		FAIL("Invalid joint. Not initialized?");
 	}
 
+	//the lockstep finds the joint from its Box2D joint
+	def.generic.userData = const_cast<Joint*>(this);
 	return def;
 }
 
@@ -118,3 +120,15 @@ void Joint::_deinit(World& world) {
 
 	mJoint = {};
 }
+
+void Joint::_suspend(World& world) {
+	world.getBox2D().DestroyJoint(&mJoint.unwrap());
+	mJoint = {};
+}
+
+void Joint::_resume(World& world, const b2JointDef& def) {
+	DEBUG_ASSERT(mJoint.is_none(), "The joint already exists");
+	DEBUG_ASSERT(def.userData == this, "The definition belongs to another joint");
+
+	mJoint = *world.getBox2D().CreateJoint(&def);
+}
@@ -63,6 +63,18 @@ ParticleSystem::Particle::Particle(const Dojo::Vector& pos, const Dojo::Vector&
 	def.userData = this;
 }
 
+void ParticleSystem::ParticleBatch::add(const Vector& pos, const Vector& velocity, const Dojo::Color& color) {
+	positions.emplace_back(asB2Vec(pos));
+	velocities.emplace_back(asB2Vec(velocity));
+	colors.emplace_back(b2Color(color.r, color.g, color.b));
+}
+
+void ParticleSystem::ParticleBatch::reserve(size_t count) {
+	positions.reserve(count);
+	velocities.reserve(count);
+	colors.reserve(count);
+}
+
 void ParticleSystem::addParticles(const ParticleList& particles) {
 	getWorld().asyncCommand([ = ]() {
 		for (auto&& particle : particles) {
@@ -79,10 +91,37 @@ void ParticleSystem::addParticles(ParticleList&& rhs) {
 	});
 }
 
+void ParticleSystem::addParticles(ParticleBatch&& rhs) {
+	DEBUG_ASSERT(rhs.lifetime > 0, "Invalid lifetime");
+	DEBUG_ASSERT(rhs.velocities.size() == rhs.size() and rhs.colors.size() == rhs.size(), "The batch fields have different sizes");
+
+	if (rhs.size() == 0) {
+		return;
+	}
+
+	getWorld().asyncCommand([this, batch = std::move(rhs)]() {
+		b2ParticleGroupDef def;
+		def.flags = b2_waterParticle | b2_colorMixingParticle;
+		def.positionData = batch.positions.data();
+		def.particleCount = (int32)batch.size();
+		def.lifetime = batch.lifetime;
+
+		auto group = particleSystem->CreateParticleGroup(def);
+
+		//the group def gives the same velocity and color to all the particles, so fill in the buffers after
+		auto first = group->GetBufferIndex();
+		std::copy(batch.velocities.begin(), batch.velocities.end(), particleSystem->GetVelocityBuffer() + first);
+		std::copy(batch.colors.begin(), batch.colors.end(), particleSystem->GetColorBuffer() + first);
+		std::fill_n(particleSystem->GetUserDataBuffer() + first, batch.size(), this);
+	});
+}
+
 void ParticleSystem::applyForceField(const Dojo::Vector& force) {
 	getWorld().asyncCommand([this, force] {
-		for (auto i : range(0, particleSystem->GetParticleCount())) {
-			particleSystem->ParticleApplyForce(i, asB2Vec(force));
+		auto count = particleSystem->GetParticleCount();
+		if (count > 0) {
+			//ApplyForce divides the force between the particles in the range, adding it straight to the force buffer
+			particleSystem->ApplyForce(0, count, (float)count * asB2Vec(force));
 		}
 	});
 }
@@ -122,7 +161,8 @@ void Phys::ParticleSystem::changeWorld(World& newWorld) {
 			def.color = oldPS->GetColorBuffer()[i];
 			def.lifetime = oldPS->GetParticleLifetime(i);
 			def.userData = oldPS->GetUserDataBuffer()[i];
-			def.group = oldPS->GetGroupBuffer()[i];
+			//the groups belong to the old system
+			def.group = nullptr;
 
 			particleSystem->CreateParticle(def);
 		}
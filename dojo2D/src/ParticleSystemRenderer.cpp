@@ -15,6 +15,7 @@ std::unique_ptr<Dojo::Mesh> _makeMesh() {
 	mesh->setDynamic(true);
 	mesh->setTriangleMode(PrimitiveMode::TriangleList);
 	mesh->setVertexFields({ VertexField::Position2D, VertexField::Color, VertexField::UV0 });
+	mesh->setIndexByteSize(sizeof(uint32_t)); //big fluids have more than 64k vertices
 
 	return mesh;
 }
@@ -49,41 +50,11 @@ void ParticleSystemRenderer::update(float dt) {
 	if (isVisible() and not rebuilding) {
 		rebuilding = true;
 
-		mParticleSystem.getWorld().asyncCommand([this, &b2Particles, &viewport]() {
-			mesh[1]->begin(b2Particles.GetParticleCount() * 4);
-
-			auto position = b2Particles.GetPositionBuffer();
-			auto color = b2Particles.GetColorBuffer();
-
-			for (int i = 0; i < b2Particles.GetParticleCount(); ++i, ++position, ++color) {
-				//int hash = ((*userData * 0x1f1f1f1f) >> 1) & 0xf;
-
-				if (viewport.isInViewRect(Vector{ position->x, position->y })) {
-					b2Color c1 = color->GetColor();
-					Color c(c1.r, c1.g, c1.b, 1.f);
-
-					auto baseIdx = mesh[1]->getVertexCount();
-
-					float r = b2Particles.GetRadius() * 1.5f;
-					// 			if (hash < 5 and hash > 0)
-					// 				r -= 0.03f * hash;
-
-					mesh[1]->vertex({position->x - r, position->y - r});
-					mesh[1]->color(c);
-					mesh[1]->uv(0, 0);
-					mesh[1]->vertex({position->x + r, position->y - r});
-					mesh[1]->color(c);
-					mesh[1]->uv(1, 0);
-					mesh[1]->vertex({position->x - r, position->y + r});
-					mesh[1]->color(c);
-					mesh[1]->uv(0, 1);
-					mesh[1]->vertex({position->x + r, position->y + r});
-					mesh[1]->color(c);
-					mesh[1]->uv(1, 1);
-
-					mesh[1]->quad(baseIdx, baseIdx + 2, baseIdx + 1, baseIdx + 3);
-				}
-			}
+		//copy the view rect now, the viewport can't be read on the physics thread
+		auto viewRect = viewport.getGraphicsAABB();
+
+		mParticleSystem.getWorld().asyncCommand([this, &b2Particles, viewRect]() {
+			_buildMesh(*mesh[1], b2Particles, viewRect);
 		},
 		[this]() {
 			mesh[1]->end();
@@ -99,3 +70,51 @@ void ParticleSystemRenderer::update(float dt) {
 		});
 	}
 }
+
+void ParticleSystemRenderer::_buildMesh(Mesh& mesh, const b2ParticleSystem& particles, const AABB& viewRect) {
+	static_assert(sizeof(ParticleVertex) == 16, "ParticleVertex doesn't match the vertex format of the mesh");
+
+	static const uint32_t UV[] = {
+		glm::packHalf2x16({ 0, 0 }),
+		glm::packHalf2x16({ 1, 0 }),
+		glm::packHalf2x16({ 0, 1 }),
+		glm::packHalf2x16({ 1, 1 })
+	};
+
+	auto count = (uint32_t)particles.GetParticleCount();
+	auto position = particles.GetPositionBuffer();
+	auto color = particles.GetColorBuffer();
+	float r = particles.GetRadius() * 1.5f;
+
+	mVertices.resize(count * 4);
+	auto out = mVertices.data();
+
+	//always write the quad and only advance if the particle is visible, so that there are no branches in the loop
+	uint32_t visible = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		auto& p = position[i];
+		auto c = color[i];
+		c.a = 0xff;
+
+		auto v = out + visible * 4;
+		v[0] = { p.x - r, p.y - r, c, UV[0] };
+		v[1] = { p.x + r, p.y - r, c, UV[1] };
+		v[2] = { p.x - r, p.y + r, c, UV[2] };
+		v[3] = { p.x + r, p.y + r, c, UV[3] };
+
+		visible +=
+			(p.x >= viewRect.min.x) &
+			(p.x <= viewRect.max.x) &
+			(p.y >= viewRect.min.y) &
+			(p.y <= viewRect.max.y);
+	}
+
+	//the indices are always the same, so they are only generated when there are more quads than ever
+	for (auto base = (uint32_t)mQuadIndices.size() / 6 * 4; mQuadIndices.size() < visible * 6; base += 4) {
+		mQuadIndices.insert(mQuadIndices.end(), { base, base + 1, base + 2, base + 1, base + 3, base + 2 });
+	}
+
+	mesh.begin(std::max(1u, visible * 4));
+	mesh.appendRawVertexData(mVertices.data(), visible * 4, mParticleSystem.getSimulationAABB().grow(r));
+	mesh.appendRawIndexData(mQuadIndices.data(), visible * 6);
+}
@@ -0,0 +1,70 @@
+#include "SoundThrottle.h"
+
+using namespace Phys;
+
+SoundThrottle::SoundThrottle(float minDistance, float lifetime, uint32_t maxVoicesPerMaterial) :
+	mMinDistance(minDistance),
+	mLifetime(lifetime),
+	mMaxVoicesPerMaterial(maxVoicesPerMaterial) {
+	DEBUG_ASSERT(minDistance > 0, "Invalid distance");
+	DEBUG_ASSERT(lifetime > 0, "Invalid lifetime");
+}
+
+void SoundThrottle::update(float dt) {
+	mAge += dt;
+	if (mAge > mLifetime) {
+		//drop the old generation all at once instead of expiring each sound
+		std::swap(mGenerations[0], mGenerations[1]);
+		mGenerations[0].cells.clear();
+		mGenerations[0].voices.clear();
+		mAge = 0;
+	}
+}
+
+bool SoundThrottle::tryPlay(const Vector& pos, const Material& material) {
+	uint32_t voices = 0;
+	for (auto&& generation : mGenerations) {
+		auto elem = generation.voices.find(&material);
+		if (elem != generation.voices.end()) {
+			voices += elem->second;
+		}
+	}
+
+	if (voices >= mMaxVoicesPerMaterial) {
+		return false;
+	}
+
+	auto x = (int32_t)std::floor(pos.x / mMinDistance);
+	auto y = (int32_t)std::floor(pos.y / mMinDistance);
+	auto minDistanceSquared = mMinDistance * mMinDistance;
+
+	for (auto&& generation : mGenerations) {
+		for (int32_t i = x - 1; i <= x + 1; ++i) {
+			for (int32_t j = y - 1; j <= y + 1; ++j) {
+				auto cell = generation.cells.find(_getCell(i, j));
+				if (cell == generation.cells.end()) {
+					continue;
+				}
+
+				for (auto&& played : cell->second) {
+					if (played.distanceSquared(pos) < minDistanceSquared) {
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	auto& current = mGenerations[0];
+	current.cells[_getCell(x, y)].emplace_back(pos);
+	++current.voices[&material];
+	return true;
+}
+
+void SoundThrottle::clear() {
+	for (auto&& generation : mGenerations) {
+		generation.cells.clear();
+		generation.voices.clear();
+	}
+	mAge = 0;
+}
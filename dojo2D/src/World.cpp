@@ -44,7 +44,7 @@ void World::deactivateAllBodies() {
 std::unique_ptr<World> World::createSimulationClone() {
 	auto clone = std::unique_ptr<World>(new World()); //HACK must use new because make_unique doesn't see the private ctor
 
-	memcpy(clone->mCollideMode, mCollideMode, sizeof(mCollideMode));
+	clone->mContactModes = mContactModes;
 	clone->mDefaultLinearDamping = mDefaultLinearDamping;
 	clone->mDefaultAngularDamping = mDefaultAngularDamping;
 
@@ -53,46 +53,101 @@ std::unique_ptr<World> World::createSimulationClone() {
 	clone->mBodiesStartActive = true;
 
 	//assume that this world will be simulated on this thread
-	clone->mWorkerID = std::this_thread::get_id();
+	clone->mMainThreadID = std::this_thread::get_id();
+	clone->mWorkerID = clone->mMainThreadID;
 
 	return clone;
 }
 
-void Phys::World::simulateToInactivity(float timeStep, uint32_t velocityIterations, uint32_t positionIterations, uint32_t particleIterations, const Dojo::AABB& insideBounds, uint32_t maxSteps /*= UINT_MAX*/) {
-	//process all available commands
-	
-// 	bool done = false;
-// 	Job job;
-// 	Command callback;
-// 
-// 	uint32_t step = 0;
-// 	while (not done) {
-// 		mBox2D->Step(timeStep, velocityIterations, positionIterations, particleIterations);
-// 
-// 		done = true;
-// 		for (auto&& b : mBodies) {
-// 			auto& body = b->getB2Body().unwrap();
-// 			if (body.IsAwake() and (body.IsActive() and body.IsSleepingAllowed()) and not b->isStatic()) {
-// 				//check if the body center is in the allowed bounds, otherwise delete it
-// 				if (not insideBounds.contains(asVec(body.GetPosition()))) {
-// 					//delete this body and continue simulating
-// 					removeBody(*b);
-// 				}
-// 				done = false;
-// 				break;
-// 			}
-// 		}
-// 
-// 		for (auto&& ps : mParticleSystems) {
-// 			if (not ps->isAsleep()) {
-// 				done = false;
-// 				break;
-// 			}
-// 		}
-// 
-// 		++step;
-// 		DEBUG_ASSERT(step < maxSteps, "Too many steps"); //TODO delete all the bodies that didn't sleep
-// 	}
+World::InactivityResult World::simulateToInactivity(float timeStep, uint32_t velocityIterations, uint32_t positionIterations, uint32_t particleIterations, const Dojo::AABB& insideBounds, uint32_t maxSteps /*= UINT_MAX*/) {
+	DEBUG_ASSERT(not mCommands, "Only simulation clones can be simulated to inactivity");
+
+	//the clone belongs to the thread that simulates it until it's done
+	mWorkerID = std::this_thread::get_id();
+
+	InactivityResult result;
+	while (result.steps < maxSteps) {
+		mBox2D->Step(timeStep, velocityIterations, positionIterations, particleIterations);
+		++result.steps;
+
+		bool done = true;
+		for (auto&& b : mBodies) {
+			auto& body = b->getB2Body().unwrap();
+			if (b->isStatic() or not body.IsAwake() or not body.IsActive()) {
+				continue;
+			}
+
+			//stop simulating the bodies that fall out of the bounds, they would never go to sleep
+			if (not insideBounds.contains(asVec(body.GetPosition()))) {
+				body.SetActive(false);
+				result.culledBodies.emplace_back(b);
+			}
+			else if (body.IsSleepingAllowed()) {
+				done = false;
+			}
+		}
+
+		for (auto&& ps : mParticleSystems) {
+			if (not ps->isAsleep()) {
+				done = false;
+				break;
+			}
+		}
+
+		if (done) {
+			result.settled = true;
+			break;
+		}
+	}
+
+	mWorkerID = mMainThreadID;
+	return result;
+}
+
+std::future<std::vector<World::InactivityResult>> World::settleClones(std::vector<std::unique_ptr<World>> clones, const std::vector<Dojo::AABB>& insideBounds, Dojo::WorkerPool& pool, float timeStep, uint32_t velocityIterations, uint32_t positionIterations, uint32_t particleIterations, uint32_t maxSteps /*= UINT_MAX*/) {
+	DEBUG_ASSERT(isMainThread(), "Wrong Thread");
+	DEBUG_ASSERT(clones.size() == insideBounds.size(), "Each clone needs its bounds");
+
+	auto pending = make_shared<PendingSettle>();
+	pending->clones = std::move(clones);
+	pending->results.resize(pending->clones.size());
+	pending->remaining = pending->clones.size();
+	pending->startTime = std::chrono::high_resolution_clock::now();
+
+	//the tasks share the ownership of the clones, so they can finish even if this world is destroyed first
+	for (size_t i = 0; i < pending->clones.size(); ++i) {
+		auto bounds = insideBounds[i];
+		pool.queue([=] {
+			pending->results[i] = pending->clones[i]->simulateToInactivity(timeStep, velocityIterations, positionIterations, particleIterations, bounds, maxSteps);
+			--pending->remaining;
+		});
+	}
+
+	mPendingSettles.emplace_back(pending);
+	return pending->promise.get_future();
+}
+
+void World::_mergeSettledClones() {
+	for (size_t i = 0; i < mPendingSettles.size();) {
+		auto pending = mPendingSettles[i];
+		if (pending->remaining > 0) {
+			++i;
+			continue;
+		}
+
+		mPendingSettles.erase(mPendingSettles.begin() + i);
+
+		for (auto&& clone : pending->clones) {
+			mergeWorld(std::move(clone));
+		}
+
+#ifndef PUBLISH
+		mSettledClones += (uint32_t)pending->clones.size();
+		mTotalSettleTime += Dojo::durationToSeconds(std::chrono::high_resolution_clock::now() - pending->startTime) * pending->clones.size();
+#endif
+
+		pending->promise.set_value(std::move(pending->results));
+	}
 }
 
 void World::mergeWorld(std::unique_ptr<World> other) {
@@ -122,18 +177,13 @@ void World::mergeWorld(std::unique_ptr<World> other) {
 	sync(); //wait for all the merges to be done before letting the world be destroyed
 }
 
-World::World(const Vector& gravity, float damping, float angularDamping, float timeStep, int velocityIterations, int positionIterations, int particleIterations) {
+World::World(const Vector& gravity, float damping, float angularDamping, float timeStep, int velocityIterations, int positionIterations, int particleIterations) :
+	mMainThreadID(std::this_thread::get_id()) {
 
 	setDefaultDamping(damping, angularDamping);
 
 	DEBUG_ASSERT(timeStep > 0, "Invalid timestep");
 
-	for (int i = 0; i < GROUP_COUNT; ++i) {
-		for (int j = 0; j < GROUP_COUNT; ++j) {
-			mCollideMode[j][i] = ContactMode::Normal;
-		}
-	}
-
 	//create the box 2D world
 	mBox2D = make_unique<b2World>(asB2Vec(gravity));
 	mBox2D->SetContactFilter(this);
@@ -141,6 +191,7 @@ World::World(const Vector& gravity, float damping, float angularDamping, float t
 
 	mCommands = make_unique<Dojo::MPSCQueue<Job>>();
 	mCallbacks = make_unique<Dojo::SPSCQueue<Command>>();
+	mFreeBodyCommands = make_unique<Dojo::SPSCQueue<BodyCommandBuffer*>>();
 	mDeferredCollisions = make_unique<Dojo::SPSCQueue<DeferredCollision>>();
 	mDeferredSensorCollisions = make_unique<Dojo::SPSCQueue<DeferredSensorCollision>>();
 
@@ -158,40 +209,36 @@ World::World(const Vector& gravity, float damping, float angularDamping, float t
 			auto startTime = high_resolution_clock::now();
 
 			//process all available commands
+			bool ranCommands = false;
 			while ((mSimulationPaused or timer.getElapsedTime() < timeStep) and mCommands->try_dequeue(job)) {
 				job.command();
+				ranCommands = true;
 
 				if (job.callback) {
 					mCallbacks->enqueue(std::move(job.callback));
 				}
 			}
 
-			bool doSimulation = not mSimulationPaused and timer.getElapsedTime() >= timeStep;
-			if (doSimulation) {
-				auto simStartTime = high_resolution_clock::now();
-
-				auto step = std::min(maxStep, static_cast<float>(timer.getElapsedTime()));
-				timer.reset();
-				mBox2D->Step(step, velocityIterations, positionIterations, particleIterations);
+			//a late input simulates again the ticks after it before going on
+			if (mRollbackTick != UINT_MAX) {
+				_rollback(mRollbackTick, timeStep, velocityIterations, positionIterations, particleIterations);
+				mRollbackTick = UINT_MAX;
+			}
 
-				//update the force fields
-				for (auto&& fieldPart : mActiveForceFields) {
-					fieldPart->getForceField().unwrap().applyToAllContacts(*fieldPart);
-				}
+			//lockstep ticks always have the same length and run as soon as they are allowed
+			bool doSimulation = mLockstep ?
+				not mSimulationPaused and mTick < mTargetTick :
+				not mSimulationPaused and timer.getElapsedTime() >= timeStep;
 
-				for (auto&& b : mBodies) {
-					auto& body = b->getB2Body().unwrap();
-					if (body.IsAwake() and body.IsActive()) {
-						b->updateObject();
-					}
+			if (doSimulation) {
+				if (mLockstep) {
+					timer.reset();
+					_stepTick(timeStep, velocityIterations, positionIterations, particleIterations);
 				}
-
-#ifndef PUBLISH
-				mTotalSimulationTime += durationToSeconds(high_resolution_clock::now() - simStartTime);
-#endif
-
-				for (auto&& listener : mListeners) {
-					listener->onPhysicsStep(step);
+				else {
+					auto step = std::min(maxStep, static_cast<float>(timer.getElapsedTime()));
+					timer.reset();
+					_step(step, velocityIterations, positionIterations, particleIterations);
 				}
 
 #ifndef PUBLISH
@@ -204,6 +251,11 @@ World::World(const Vector& gravity, float damping, float angularDamping, float t
 			mTotalUsageTime += durationToSeconds(high_resolution_clock::now() - startTime);
 #endif
 
+			//let the main thread see the changes made by commands while the simulation is paused
+			if (ranCommands and mSimulationPaused) {
+				_publishSnapshot();
+			}
+
 			if(!doSimulation) {
 				std::this_thread::yield();
 			}
@@ -212,6 +264,10 @@ World::World(const Vector& gravity, float damping, float angularDamping, float t
 }
 
 World::~World() {
+	if (mScheduledCallbacks) {
+		Dojo::Platform::singleton().getScheduler().removeSource(this);
+	}
+
 	mRunning = false;
 	if (mThread.joinable()) {
 		mThread.join();
@@ -231,14 +287,11 @@ void World::removeListener(WorldListener& listener) {
 }
 
 void World::setContactMode(Group A, Group B, ContactMode mode) {
-	mCollideMode[A][B] = mCollideMode[B][A] = mode;
+	mContactModes.set(A, B, mode);
 }
 
 ContactMode World::getContactModeFor(Group A, Group B) const {
-	auto modeA = mCollideMode[A][B];
-	auto modeB = mCollideMode[B][A];
-
-	return std::min(modeA, modeB);
+	return mContactModes.get(A, B);
 }
 
 void World::asyncCommand(Command command, Command callback) const {
@@ -257,10 +310,53 @@ void World::asyncCommand(Command command, Command callback) const {
 		}
 	}
 	else {
+		//the body commands recorded before this command have to run before it
+		if (isMainThread()) {
+			_flushBodyCommands();
+		}
+
 		mCommands->enqueue(std::move(command), std::move(callback));
 	}
 }
 
+void World::bodyCommand(const BodyCommand& command) const {
+	if (not mCommands or isWorkerThread()) {
+		command.body->_execute(command);
+	}
+	else if (isMainThread()) {
+		if (not mPendingBodyCommands and not mFreeBodyCommands->try_dequeue(mPendingBodyCommands)) {
+			mBodyCommandBuffers.emplace_back(make_unique<BodyCommandBuffer>());
+			mPendingBodyCommands = mBodyCommandBuffers.back().get();
+		}
+
+		mPendingBodyCommands->emplace_back(command);
+	}
+	else {
+		//other threads don't have a buffer of their own
+		mCommands->enqueue([command] {
+			command.body->_execute(command);
+		}, Command{});
+	}
+}
+
+void World::_flushBodyCommands() const {
+	if (not mPendingBodyCommands or mPendingBodyCommands->empty()) {
+		return;
+	}
+
+	auto buffer = mPendingBodyCommands;
+	mPendingBodyCommands = nullptr;
+
+	mCommands->enqueue([this, buffer] {
+		for (auto&& command : *buffer) {
+			command.body->_execute(command);
+		}
+
+		buffer->clear();
+		mFreeBodyCommands->enqueue(buffer);
+	}, Command{});
+}
+
 void World::setDefaultDamping(float linear, float angular) {
 	DEBUG_ASSERT(linear >= 0 && angular >= 0, "Invalid damping value");
 
@@ -299,9 +395,14 @@ bool World::ShouldCollide(b2Fixture* fixtureA, b2Fixture* fixtureB) {
 
 	auto cm = getContactModeFor(partA.group, partB.group);
 
+#ifndef PUBLISH
+	++mFilteredPairs;
+	mRejectedPairs += (cm != ContactMode::Normal);
+#endif
+
 	if (cm != ContactMode::Normal) {
 		//a "ghost collision" acts like a two-way sensor
-		if (cm == ContactMode::Ghost and not fixtureA->IsSensor() and not fixtureB->IsSensor()) {
+		if (cm == ContactMode::Ghost and not fixtureA->IsSensor() and not fixtureB->IsSensor() and not mReplaying) {
 			mDeferredSensorCollisions->enqueue(partB.body, partA.body, partA._getWeakPtr());
 			mDeferredSensorCollisions->enqueue(partA.body, partB.body, partB._getWeakPtr());
 		}
@@ -309,12 +410,12 @@ bool World::ShouldCollide(b2Fixture* fixtureA, b2Fixture* fixtureB) {
 		return false;
 	}
 
-	//check if the sensors should collide
-	if (partA.type == BodyPartType::Sensor) {
+	//check if the sensors should collide, a rollback already reported them the first time
+	if (partA.type == BodyPartType::Sensor and not mReplaying) {
 		mDeferredSensorCollisions->enqueue(partB.body, partA.body, partA._getWeakPtr());
 	}
 
-	if (partB.type == BodyPartType::Sensor) {
+	if (partB.type == BodyPartType::Sensor and not mReplaying) {
 		mDeferredSensorCollisions->enqueue(partA.body, partB.body, partB._getWeakPtr());
 	}
 
@@ -344,7 +445,14 @@ bool World::ShouldCollide(b2Fixture* fixture, b2ParticleSystem* particleSystem,
 	auto& part = getPartForFixture(fixture);
 	auto& ps = ParticleSystem::getFor(particleSystem);
 
-	if (getContactModeFor(part.group, ps.group) != ContactMode::Normal) {
+	bool collides = mContactModes.collides(part.group, ps.group);
+
+#ifndef PUBLISH
+	++mFilteredPairs;
+	mRejectedPairs += not collides;
+#endif
+
+	if (not collides) {
 		return false;
 	}
 	else {
@@ -378,8 +486,8 @@ void World::BeginContact(b2Contact* contact) {
 	DEBUG_ASSERT(bodyA.isStatic() or bodyA.getMass() > 0, "HM");
 	DEBUG_ASSERT(bodyB.isStatic() or bodyB.getMass() > 0, "HM");
 
-	//don't report collisions between bodies with no listeners, duh
-	if (not bodyA.collisionListener and not bodyB.collisionListener) {
+	//don't report collisions between bodies with no listeners, duh, nor the ones already reported before a rollback
+	if ((not bodyA.collisionListener and not bodyB.collisionListener) or mReplaying) {
 		return;
 	}
 
@@ -396,7 +504,21 @@ void World::BeginContact(b2Contact* contact) {
 	}
 
 	float force = 0; //TODO extimate the force for sounds & damages
-	mDeferredCollisions->enqueue(partA._getWeakPtr(), partB._getWeakPtr(), force, point);
+
+	//many contacts can begin between the same bodies in a step, only send the strongest one to the main thread
+	std::pair<const Body*, const Body*> key(&bodyA, &bodyB);
+	if (key.second < key.first) {
+		std::swap(key.first, key.second);
+	}
+
+	auto elem = mStepCollisions.find(key);
+	if (elem == mStepCollisions.end()) {
+		mStepCollisions.emplace(key, DeferredCollision(partA._getWeakPtr(), partB._getWeakPtr(), force, point));
+	}
+	else if (force > elem->second.force) {
+		elem->second.force = force;
+		elem->second.point = point;
+	}
 }
 
 void World::EndContact(b2Contact* contact) {
@@ -419,27 +541,33 @@ void World::EndContact(b2Contact* contact) {
 	}
 }
 
-std::future<RayResult> World::raycast(const Vector& start, const Vector& end, Group rayBelongsToGroup) const {
-	auto promise = make_shared<std::promise<RayResult>>(); //TODO pool the promises perhaps
-
+void World::_raycast(const Vector& start, const Vector& end, Group rayBelongsToGroup, RayResult& result) const {
 	DEBUG_ASSERT(end.isValid(), "HHMM");
 
-	asyncCommand([this, promise, start, end, rayBelongsToGroup]() {
-		RayResult result(self);
-		result.group = rayBelongsToGroup;
+	result = RayResult(self);
+	result.group = rayBelongsToGroup;
 
-		mBox2D->RayCast(
-			&result,
-			{ start.x, start.y },
-			{ end.x, end.y }
-		);
+	mBox2D->RayCast(
+		&result,
+		{ start.x, start.y },
+		{ end.x, end.y }
+	);
 
-		if (not result.hit) {
-			result.position = end;
-		}
+	if (not result.hit) {
+		result.position = end;
+	}
+
+	result.dist = start.distance(result.position);
+}
 
+std::future<RayResult> World::raycast(const Vector& start, const Vector& end, Group rayBelongsToGroup) const {
+	auto promise = make_shared<std::promise<RayResult>>(); //use a RaycastBatch to avoid this allocation
+
+	DEBUG_ASSERT(end.isValid(), "HHMM");
 
-		result.dist = start.distance(result.position);
+	asyncCommand([this, promise, start, end, rayBelongsToGroup]() {
+		RayResult result;
+		_raycast(start, end, rayBelongsToGroup, result);
 
 		promise->set_value(result);
 	});
@@ -447,84 +575,104 @@ std::future<RayResult> World::raycast(const Vector& start, const Vector& end, Gr
 	return promise->get_future();
 }
 
+void World::raycast(RaycastBatch& batch, Command callback) const {
+	batch._begin();
+
+	asyncCommand([this, &batch] {
+		_parallelFor(batch.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				auto& ray = batch.getQuery(i);
+				_raycast(ray.start, ray.end, ray.group, batch._getResult(i));
+			}
+		});
+
+		batch._end();
+	}, std::move(callback));
+}
+
 bool World::isWorkerThread() const {
-	return std::this_thread::get_id() == mWorkerID;
+	return std::this_thread::get_id() == mWorkerID.load();
 }
 
-std::future<AABBQueryResult> World::AABBQuery(const Dojo::AABB& area, Group group, uint8_t flags) const {
-	auto promise = make_shared<std::promise<AABBQueryResult>>(); //TODO pool results
-	asyncCommand([this, promise, flags, area, group] {
-		b2PolygonShape aabbShape;
-		AABBQueryResult result;
+void World::_AABBQuery(const Dojo::AABB& area, Group group, uint8_t flags, AABBQueryResult& result) const {
+	b2PolygonShape aabbShape;
+	result.clear();
 
-		if (flags & QUERY_PRECISE) {
-			Vector dim = area.getSize();
-			aabbShape.SetAsBox(dim.x, dim.y, asB2Vec(area.getCenter()), 0);
-		}
+	if (flags & QUERY_PRECISE) {
+		Vector dim = area.getSize();
+		aabbShape.SetAsBox(dim.x, dim.y, asB2Vec(area.getCenter()), 0);
+	}
 
-		auto report = [&](b2Fixture * fixture) {
-			if (not fixture->IsSensor()) {
-				auto& part = getPartForFixture(fixture);
-				if (not (flags & QUERY_PUSHABLE_ONLY) or part.body.isPushable()) {
-					auto contactMode = getContactModeFor(group, part.group);
+	auto report = [&](b2Fixture * fixture) {
+		if (not fixture->IsSensor()) {
+			auto& part = getPartForFixture(fixture);
+			if (mContactModes.collides(group, part.group)) {
 
-					if (contactMode == ContactMode::Normal) {
+				if (not (flags & QUERY_PUSHABLE_ONLY) or part.body.isPushable()) {
 
-						if (not (flags & QUERY_PRECISE) or shapesOverlap(aabbShape, *fixture)) {
-							result.empty = false;
+					if (not (flags & QUERY_PRECISE) or shapesOverlap(aabbShape, *fixture)) {
+						result.empty = false;
 
-							if (flags & QUERY_BODIES) {
-								result.bodies.insert(&part.body);
-							}
+						if (flags & QUERY_BODIES) {
+							result.bodies.insert(&part.body);
+						}
 
-							else if (flags & QUERY_FIXTURES) {
-								result.fixtures.emplace_back(fixture);
-							}
-							else {
-								return false;    //stop search immediately
-							}
+						else if (flags & QUERY_FIXTURES) {
+							result.fixtures.emplace_back(fixture);
+						}
+						else {
+							return false;    //stop search immediately
 						}
 					}
 				}
 			}
+		}
 
-			return true;
-		};
+		return true;
+	};
 
-		class Query : public b2QueryCallback {
-		public:
-			decltype(report)& func;
-			AABBQueryResult::ParticleList& particles;
-			bool queryParticles;
+	class Query : public b2QueryCallback {
+	public:
+		decltype(report)& func;
+		AABBQueryResult::ParticleList& particles;
+		bool queryParticles;
 
-			Query(decltype(func)& f, AABBQueryResult::ParticleList& p, bool queryParticles)
-				: func(f)
-				, particles(p) {
-			}
+		Query(decltype(func)& f, AABBQueryResult::ParticleList& p, bool queryParticles)
+			: func(f)
+			, particles(p)
+			, queryParticles(queryParticles) {
+		}
 
-			virtual bool ReportFixture(b2Fixture* fixture) override {
-				return func(fixture);
-			}
+		virtual bool ReportFixture(b2Fixture* fixture) override {
+			return func(fixture);
+		}
 
-			virtual bool ReportParticle(b2ParticleSystem* particleSystem, int32 index) override {
-				//TODO //WARNING LiquidFun's particle reporting mechanics look like really inefficient
-				//jumbles of virtuals, this can probably be optimized
+		virtual bool ReportParticle(b2ParticleSystem* particleSystem, int32 index) override {
+			//TODO //WARNING LiquidFun's particle reporting mechanics look like really inefficient
+			//jumbles of virtuals, this can probably be optimized
 
-				particles[particleSystem].emplace_back(index);
-				return true;
-			}
+			particles[particleSystem].emplace_back(index);
+			return true;
+		}
 
-			virtual bool ShouldQueryParticleSystem(const b2ParticleSystem* particleSystem) override {
-				return queryParticles;
-			}
-		};
+		virtual bool ShouldQueryParticleSystem(const b2ParticleSystem* particleSystem) override {
+			return queryParticles;
+		}
+	};
 
-		b2AABB bb;
-		bb.lowerBound = asB2Vec(area.min);
-		bb.upperBound = asB2Vec(area.max);
+	b2AABB bb;
+	bb.lowerBound = asB2Vec(area.min);
+	bb.upperBound = asB2Vec(area.max);
+
+	Query q = { report, result.particles, (flags & QUERY_PARTICLES) > 0 };
+	mBox2D->QueryAABB(&q, bb);
+}
 
-		Query q = { report, result.particles, (flags & QUERY_PARTICLES) > 0 };
-		mBox2D->QueryAABB(&q, bb);
+std::future<AABBQueryResult> World::AABBQuery(const Dojo::AABB& area, Group group, uint8_t flags) const {
+	auto promise = make_shared<std::promise<AABBQueryResult>>(); //use an AABBQueryBatch to avoid this allocation
+	asyncCommand([this, promise, flags, area, group] {
+		AABBQueryResult result;
+		_AABBQuery(area, group, flags, result);
 
 		promise->set_value(std::move(result));
 	});
@@ -532,20 +680,110 @@ std::future<AABBQueryResult> World::AABBQuery(const Dojo::AABB& area, Group grou
 	return promise->get_future();
 }
 
+void World::AABBQuery(AABBQueryBatch& batch, Command callback) const {
+	batch._begin();
+
+	asyncCommand([this, &batch] {
+		_parallelFor(batch.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				auto& query = batch.getQuery(i);
+				_AABBQuery(query.area, query.group, query.flags, batch._getResult(i));
+			}
+		});
+
+		batch._end();
+	}, std::move(callback));
+}
+
+void World::_parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& task) const {
+	if (count < MIN_PARALLEL_QUERIES) {
+		task(0, count);
+		return;
+	}
+
+#ifndef PUBLISH
+	auto startTime = std::chrono::high_resolution_clock::now();
+#endif
+
+	//the queries only read the world, and the physics thread waits for all of them, so it doesn't change meanwhile
+	struct Chunks {
+		size_t count, size;
+		std::atomic<size_t> next = { 0 }, done = { 0 };
+		Dojo::Semaphore finished{ 0 };
+	};
+
+	auto helpers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	auto chunks = make_shared<Chunks>();
+	chunks->count = std::min<size_t>(helpers + 1, count / (MIN_PARALLEL_QUERIES / 2));
+	chunks->size = (count + chunks->count - 1) / chunks->count;
+
+	//each participant claims chunks until none are left, so the physics thread never waits for a busy worker to start;
+	//a helper that runs after all the chunks were claimed returns without touching task, which might be gone by then
+	auto run = [&task, count](Chunks& chunks) {
+		for (auto i = chunks.next++; i < chunks.count; i = chunks.next++) {
+			auto begin = i * chunks.size;
+			task(begin, std::min(count, begin + chunks.size));
+
+			if (++chunks.done == chunks.count) {
+				chunks.finished.notifyOne();
+			}
+		}
+	};
+
+	auto& pool = Dojo::Platform::singleton().getBackgroundPool();
+	for (size_t i = 1; i < chunks->count; ++i) {
+		pool.queue([chunks, run] {
+			run(*chunks);
+		});
+	}
+
+	run(*chunks);
+	chunks->finished.wait();
+
+#ifndef PUBLISH
+	++mParallelQueries;
+	mParallelQueryNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+#endif
+}
+
 void World::applyForceField(const Dojo::AABB& area, Group group, const Vector& force, FieldType type) {
 	asyncCommand([this, area, group, force] {
 		auto F = asB2Vec(force);
-		auto query = AABBQuery(area, group, QUERY_FIXTURES | QUERY_PARTICLES | QUERY_PUSHABLE_ONLY).get();
+		AABBQueryResult query;
+		_AABBQuery(area, group, QUERY_FIXTURES | QUERY_PUSHABLE_ONLY, query);
 
 		for (auto&& fixture : query.fixtures) {
 			//TODO the force should be proportional to the area or to the volume
 			fixture->GetBody()->ApplyForceToCenter(F, true);
 		}
 
-		for (auto&& pair : query.particles) {
-			for (auto&& i : pair.second) {
-				pair.first->ParticleApplyForce(i, F);
+		//apply the force while querying the particles instead of listing them first
+		class ParticleQuery : public b2QueryCallback {
+		public:
+			b2Vec2 force;
+
+			ParticleQuery(const b2Vec2& force)
+				: force(force) {
+			}
+
+			virtual bool ReportFixture(b2Fixture* fixture) override {
+				return true;
+			}
+
+			virtual bool ReportParticle(b2ParticleSystem* particleSystem, int32 index) override {
+				particleSystem->ParticleApplyForce(index, force);
+				return true;
 			}
+		};
+
+		b2AABB bb;
+		bb.lowerBound = asB2Vec(area.min);
+		bb.upperBound = asB2Vec(area.max);
+
+		//each particle system only visits the particles in the area through its sorted proxies
+		ParticleQuery q = { F };
+		for (auto ps = mBox2D->GetParticleSystemList(); ps; ps = ps->GetNext()) {
+			ps->QueryAABB(&q, bb);
 		}
 	});
 }
@@ -557,14 +795,6 @@ Vector World::getGravity() const {
 
 const float MIN_SOUND_FORCE = 1.f;
 
-float World::_closestRecentlyPlayedSound(const Vector& point) {
-	float minDist = FLT_MAX;
-	for (auto&& pos : mRecentlyPlayedSoundPositions) {
-		minDist = std::min(minDist, pos.distanceSquared(point));
-	}
-	return sqrt(minDist);
-}
-
 void World::playCollisionSound(const DeferredCollision& collision, const BodyPart& part) {
 	//TODO choose which sound to play... both? random? existing?
 	//TODO this code doesn't belong here too much, perhaps World shouldn't know about sounds
@@ -575,18 +805,13 @@ void World::playCollisionSound(const DeferredCollision& collision, const BodyPar
 		if (auto set = impactSound.to_ref()) {
 
 			auto pos = asVec(collision.point);
-			if (_closestRecentlyPlayedSound(pos) > 0.2f) {
+			if (mSoundThrottle.tryPlay(pos, part.material)) {
 				float volume = std::min(collision.force / 3.f, 1.f);
 				Dojo::Platform::singleton().getSoundManager().playSound(
 					pos,
 					set.get(),
 					volume
 				);
-
-				if (mRecentlyPlayedSoundPositions.size() > 20) {
-					mRecentlyPlayedSoundPositions.pop_front();
-				}
-				mRecentlyPlayedSoundPositions.emplace_back(pos);
 			}
 		}
 	}
@@ -605,15 +830,14 @@ Joint& World::addJoint(std::unique_ptr<Joint> joint) {
 void World::update(float dt) {
 	DEBUG_ASSERT(not isWorkerThread(), "Wrong Thread");
 
-	//remove a recently played sound
-	if (mRecentlyPlayedSoundPositions.size() > 0) {
-		mRemoveNextSound += dt;
-		if (mRemoveNextSound > 0.5f) {
-			mRecentlyPlayedSoundPositions.pop_front();
-			mRemoveNextSound = 0;
-		}
+	_applySnapshots();
+
+	if (mPendingSettles.size() > 0) {
+		_mergeSettledClones();
 	}
 
+	mSoundThrottle.update(dt);
+
 	//play back all collisions
 	DeferredCollision c;
 
@@ -650,16 +874,43 @@ void World::update(float dt) {
 		}
 	}
 
-	//TODO timeslice this in some way?
-	//right now it can stall the main thread with too many callbacks
-	Command callback;
-
-	while (mCallbacks->try_dequeue(callback)) {
-		callback();
+	if (not mScheduledCallbacks) {
+		Command callback;
+		while (mCallbacks->try_dequeue(callback)) {
+			callback();
+		}
 	}
 
 	if(mDebugMeshBuilder) {
-		mDebugMeshBuilder->update(*mBox2D);
+		mDebugMeshBuilder->update(*mBox2D, mStaticBodiesChanged.exchange(false));
+	}
+
+	_flushBodyCommands();
+}
+
+void World::setScheduledCallbacks(bool enable) {
+	DEBUG_ASSERT(isMainThread(), "Wrong Thread");
+
+	if (enable == mScheduledCallbacks) {
+		return;
+	}
+
+	mScheduledCallbacks = enable;
+
+	auto& scheduler = Dojo::Platform::singleton().getScheduler();
+	if (enable) {
+		//the callbacks can be too many for a single frame, this way they don't stall update()
+		scheduler.addSource(this, Dojo::MainThreadScheduler::Priority::Normal, "Phys::World callbacks", [this] {
+			Command callback;
+			if (mCallbacks->try_dequeue(callback)) {
+				callback();
+				return true;
+			}
+			return false;
+		});
+	}
+	else {
+		scheduler.removeSource(this);
 	}
 }
 
@@ -672,62 +923,896 @@ void World::removeJoint(Joint& joint) {
 		ptr->_deinit(self); //destroy the physics
 
 		mJoints.erase(elem);
+
+		//a rollback can create it again, until its tick leaves the window
+		if (mLockstep) {
+			mRetiredJoints.push_back({ std::move(ptr), mTick });
+		}
 	});
 }
 
 void World::addBody(Body& body) {
 	DEBUG_ASSERT(isWorkerThread(), "Wrong Thread");
 	mBodies.emplace(&body);
+
+	mSnapshotSize = std::max(mSnapshotSize, body._getSnapshotSlot() + 1);
 }
 
-void World::removeBody(Body& body) {
-	DEBUG_ASSERT(isWorkerThread(), "Wrong Thread");
+void World::_addToSnapshots(Body& body) {
+	DEBUG_ASSERT(isMainThread(), "Wrong Thread");
 
-	//go over all joints active on this body and deactivate them
-	auto joints = body.getJoints(); //copy because getjoints will remove the joints from the vector
-	for (auto&& joint : joints) {
-		removeJoint(*joint);
+	uint32_t slot;
+	if (mFreeSnapshotSlots.empty()) {
+		slot = (uint32_t)mSnapshotOwners.size();
+		mSnapshotOwners.emplace_back(nullptr);
+	}
+	else {
+		slot = mFreeSnapshotSlots.back();
+		mFreeSnapshotSlots.pop_back();
 	}
 
-	mBodies.erase(&body);
+	mSnapshotOwners[slot] = &body;
+	body._setSnapshotSlot(slot, mNextSnapshotId++);
 }
 
-void World::pause() {
-	asyncCommand([this] {
-		DEBUG_ASSERT(not mSimulationPaused, "Already paused");
-		mSimulationPaused = true;
+void World::_removeFromSnapshots(Body& body) {
+	DEBUG_ASSERT(isMainThread(), "Wrong Thread");
 
-		//tell all bodies they're being paused
-		for (auto&& body : mBodies) {
-			body->onSimulationPaused();
-		}
-	});
+	//the physics thread can still publish the body until it's removed, but the id won't match the next owner of the slot
+	auto slot = body._getSnapshotSlot();
+	DEBUG_ASSERT(slot < mSnapshotOwners.size() and mSnapshotOwners[slot] == &body, "The body is not in the snapshots");
+
+	mSnapshotOwners[slot] = nullptr;
+	mFreeSnapshotSlots.emplace_back(slot);
 }
 
-void World::resume() {
-	asyncCommand([this] {
-		DEBUG_ASSERT(mSimulationPaused, "Already resumed");
-		mSimulationPaused = false;
-	});
+void World::_step(float dt, int velocityIterations, int positionIterations, int particleIterations) {
+	using namespace std::chrono;
+
+	auto simStartTime = high_resolution_clock::now();
+
+	mBox2D->Step(dt, velocityIterations, positionIterations, particleIterations);
+
+#ifndef PUBLISH
+	//the profile is in milliseconds
+	auto& profile = mBox2D->GetProfile();
+	mTotalContactTime += (profile.broadphase + profile.collide) * 0.001;
+#endif
+
+	for (auto&& collision : mStepCollisions) {
+		mDeferredCollisions->enqueue(std::move(collision.second));
+	}
+	mStepCollisions.clear();
+
+	//update the force fields
+	for (auto&& fieldPart : mActiveForceFields) {
+		fieldPart->getForceField().unwrap().applyToAllContacts(*fieldPart);
+	}
+
+	for (auto&& b : mBodies) {
+		auto& body = b->getB2Body().unwrap();
+		if (body.IsAwake() and body.IsActive() and body.IsFixedRotation()) {
+			b->_updateFixedRotation();
+		}
+	}
+
+	_publishSnapshot();
+
+#ifndef PUBLISH
+	mTotalSimulationTime += Dojo::durationToSeconds(high_resolution_clock::now() - simStartTime);
+#endif
+
+	//the listeners already saw the ticks that a rollback simulates again
+	if (not mReplaying) {
+		for (auto&& listener : mListeners) {
+			listener->onPhysicsStep(dt);
+		}
+	}
 }
 
+void World::_stepTick(float dt, int velocityIterations, int positionIterations, int particleIterations) {
+	uint32_t tick = mTick;
+
+	auto& saved = mSavedStates[tick % mSavedStates.size()];
+
+	//when simulating again, the bodies and joints added or removed in this tick the first time are added or removed now
+	if (mReplaying) {
+		_matchState(saved, false);
+	}
+
 #ifndef PUBLISH
-World::PerformanceInfo World::queryPerformanceInfo() {
+	auto captureStartTime = std::chrono::high_resolution_clock::now();
+#endif
+
+	captureState(saved);
+	saved.tick = tick;
+
+#ifndef PUBLISH
+	auto captureTime = Dojo::durationToSeconds(std::chrono::high_resolution_clock::now() - captureStartTime);
+	++mStateCaptures;
+	mTotalCaptureTime += captureTime;
+	_checkStateTime(false, captureTime);
+#endif
+
+	auto inputs = mInputs.find(tick);
+	if (inputs != mInputs.end()) {
+		for (auto&& input : inputs->second) {
+			input();
+		}
+	}
+
+	_step(dt, velocityIterations, positionIterations, particleIterations);
+	mTick = tick + 1;
+
+	//Box2D moves the center of mass and computes the transform from it, while a restore computes the center from the
+	//transform; the result can differ by a rounding error, so the center is always computed from the transform
+	for (auto&& b : mBodies) {
+		auto& body = b->getB2Body().unwrap();
+		if (body.IsAwake() and body.IsActive() and body.GetLocalCenter().LengthSquared() > 0) {
+			body.SetTransform(body.GetPosition(), body.GetAngle());
+		}
+	}
+
+	//the inputs that fell out of the rollback window can't be run again
+	if (tick >= mSavedStates.size()) {
+		mInputs.erase(mInputs.begin(), mInputs.upper_bound(tick - (uint32_t)mSavedStates.size()));
+	}
+
+	_destroyRetired();
+
+	if (mOnTick) {
+		//the snapshot published by the step contains the state at the end of the tick
+		auto checksum = mLastChecksum;
+		mCallbacks->enqueue([this, tick, checksum] {
+			mOnTick(tick, checksum);
+		});
+	}
+}
+
+void World::_rollback(uint32_t tick, float dt, int velocityIterations, int positionIterations, int particleIterations) {
+	DEBUG_ASSERT(isWorkerThread(), "Wrong Thread");
+
+	auto& saved = mSavedStates[tick % mSavedStates.size()];
+	DEBUG_ASSERT(saved.tick == tick, "The tick is out of the rollback window, the input can't be applied");
+	if (saved.tick != tick) {
+		return;
+	}
+
+	auto lastTick = mTick.load();
+	mReplaying = true;
+
+	//the bodies created after the last saved tick are only in the current state
+	captureState(mRollbackState);
+	mRollbackState.tick = lastTick;
+
+#ifndef PUBLISH
+	auto restoreStartTime = std::chrono::high_resolution_clock::now();
+#endif
+
+	restoreState(saved);
+	mTick = tick;
+
+#ifndef PUBLISH
+	auto restoreTime = Dojo::durationToSeconds(std::chrono::high_resolution_clock::now() - restoreStartTime);
+	++mStateRestores;
+	mTotalRestoreTime += restoreTime;
+	_checkStateTime(true, restoreTime);
+#endif
+
+	//simulate again all at once, so that no command can run in the middle of the old ticks
+	while (mTick < lastTick) {
+		_stepTick(dt, velocityIterations, positionIterations, particleIterations);
+	}
+
+	_matchState(mRollbackState, false);
+	DEBUG_ASSERT(mSuspendedBodies.empty(), "Some bodies were not brought back after the rollback");
+
+	mReplaying = false;
+	_publishSnapshot();
+}
+
+#ifndef PUBLISH
+void World::_checkStateTime(bool restore, double seconds) {
+	//too few bodies to measure reliably
+	if (mSlowStateReported or mBodies.size() < 256) {
+		return;
+	}
+
+	auto timeFor2k = seconds / mBodies.size() * 2000;
+	if (timeFor2k > 0.001) {
+		mSlowStateReported = true;
+		auto format = restore ?
+			"Phys::World: restoring the state of {} bodies took {} us, more than 1 ms per 2000 bodies" :
+			"Phys::World: saving the state of {} bodies took {} us, more than 1 ms per 2000 bodies";
+		Dojo::gp_log->appendFormat(Dojo::LogEntry::EL_WARNING, format, (uint32_t)mBodies.size(), (int64_t)(seconds * 1e6));
+	}
+}
+#endif
+
+void World::startLockstep(uint32_t rollbackWindow, ChecksumCallback onTick) {
+	DEBUG_ASSERT(rollbackWindow > 0, "The rollback window must contain at least a tick");
+
+	asyncCommand([this, rollbackWindow, onTick = std::move(onTick)]() mutable {
+		mSavedStates.clear();
+		mSavedStates.resize(rollbackWindow);
+		mInputs.clear();
+		mOnTick = std::move(onTick);
+
+		//Box2D doesn't expose the sleep timers of the bodies, so they couldn't be restored
+		mBox2D->SetAllowSleeping(false);
+
+		mTick = mTargetTick = 0;
+		mLockstep = true;
+	});
+}
+
+void World::advanceTo(uint32_t tick) {
+	//only ever move forward, ticks are only simulated again by rollbacks
+	auto target = mTargetTick.load();
+	while (target < tick and not mTargetTick.compare_exchange_weak(target, tick)) {}
+}
+
+void World::scheduleInput(uint32_t tick, Command input) {
+	DEBUG_ASSERT(input, "Command can't be a NOP");
+
+	asyncCommand([this, tick, input = std::move(input)]() mutable {
+		mInputs[tick].emplace_back(std::move(input));
+
+		//the tick was already simulated without this input, the physics thread rolls back before the next tick
+		if (tick < mTick) {
+			mRollbackTick = std::min(mRollbackTick, tick);
+		}
+	});
+}
+
+namespace {
+	//Box2D keeps the flags of the contacts, the proxies of the fixtures and the impulses of the joints protected.
+	//These classes are never created, they only hand out pointers to those members
+	struct ContactAccess : b2Contact {
+		static uint32 b2Contact::* flags() {
+			return &ContactAccess::m_flags;
+		}
+
+		static uint32 touchingFlag() {
+			return e_touchingFlag;
+		}
+	};
+
+	struct FixtureAccess : b2Fixture {
+		static b2FixtureProxy* b2Fixture::* proxies() {
+			return &FixtureAccess::m_proxies;
+		}
+	};
+
+	struct RevoluteJointAccess : b2RevoluteJoint {
+		static b2Vec3 b2RevoluteJoint::* impulse() {
+			return &RevoluteJointAccess::m_impulse;
+		}
+
+		static float32 b2RevoluteJoint::* motorImpulse() {
+			return &RevoluteJointAccess::m_motorImpulse;
+		}
+	};
+
+	struct DistanceJointAccess : b2DistanceJoint {
+		static float32 b2DistanceJoint::* impulse() {
+			return &DistanceJointAccess::m_impulse;
+		}
+	};
+
+	Body& getBodyFor(const b2Body& body) {
+		return *(Body*)body.GetUserData();
+	}
+
+	uint16_t getFixtureIndex(const b2Fixture& fixture) {
+		uint16_t index = 0;
+		for (auto f = fixture.GetBody()->GetFixtureList(); f != &fixture; f = f->GetNext()) {
+			++index;
+		}
+		return index;
+	}
+
+	b2Fixture* getFixture(const std::vector<Body*>& bodies, uint32_t slot, uint16_t index) {
+		if (slot >= bodies.size() or not bodies[slot]) {
+			return nullptr;
+		}
+
+		auto fixture = bodies[slot]->getB2Body().unwrap().GetFixtureList();
+		for (; fixture and index > 0; --index) {
+			fixture = fixture->GetNext();
+		}
+		return fixture;
+	}
+
+	b2Contact* findContact(b2Fixture& A, int32 childA, b2Fixture& B, int32 childB) {
+		for (auto edge = A.GetBody()->GetContactList(); edge; edge = edge->next) {
+			auto c = edge->contact;
+			if ((c->GetFixtureA() == &A and c->GetChildIndexA() == childA and c->GetFixtureB() == &B and c->GetChildIndexB() == childB) or
+				(c->GetFixtureA() == &B and c->GetChildIndexA() == childB and c->GetFixtureB() == &A and c->GetChildIndexB() == childA)) {
+				return c;
+			}
+		}
+		return nullptr;
+	}
+
+	void writeJointState(b2Joint& joint, const WorldState::Joint& state) {
+		if (state.type == e_revoluteJoint) {
+			auto& revolute = static_cast<b2RevoluteJoint&>(joint);
+			revolute.EnableMotor(state.enableMotor);
+			revolute.SetMotorSpeed(state.motorSpeed);
+			revolute.SetMaxMotorTorque(state.maxMotorTorque);
+			revolute.*RevoluteJointAccess::impulse() = state.impulse;
+			revolute.*RevoluteJointAccess::motorImpulse() = state.motorImpulse;
+		}
+		else {
+			auto& distance = static_cast<b2DistanceJoint&>(joint);
+			distance.SetLength(state.length);
+			distance.SetFrequency(state.frequencyHz);
+			distance.SetDampingRatio(state.dampingRatio);
+			distance.*DistanceJointAccess::impulse() = state.impulse.x;
+		}
+	}
+}
+
+void World::captureState(WorldState& state) const {
+	state.tick = mTick;
+	_captureBodies(state.bodies);
+
+	state.contacts.clear();
+	for (auto c = mBox2D->GetContactList(); c; c = c->GetNext()) {
+		auto A = c->GetFixtureA();
+		auto B = c->GetFixtureB();
+
+		WorldState::Contact contact;
+		contact.slotA = getBodyFor(*A->GetBody())._getSnapshotSlot();
+		contact.slotB = getBodyFor(*B->GetBody())._getSnapshotSlot();
+		contact.fixtureA = getFixtureIndex(*A);
+		contact.fixtureB = getFixtureIndex(*B);
+		contact.childA = (uint16_t)c->GetChildIndexA();
+		contact.childB = (uint16_t)c->GetChildIndexB();
+		contact.flags = (c->IsTouching() ? WorldState::Touching : 0) | (c->IsEnabled() ? WorldState::Enabled : 0);
+		contact.manifold = *c->GetManifold();
+		state.contacts.emplace_back(contact);
+	}
+
+	state.joints.clear();
+	for (auto j = mBox2D->GetJointList(); j; j = j->GetNext()) {
+		WorldState::Joint joint = {};
+		joint.slotA = getBodyFor(*j->GetBodyA())._getSnapshotSlot();
+		joint.slotB = getBodyFor(*j->GetBodyB())._getSnapshotSlot();
+		joint.type = j->GetType();
+		joint.collideConnected = j->GetCollideConnected();
+
+		if (joint.type == e_revoluteJoint) {
+			auto& revolute = static_cast<const b2RevoluteJoint&>(*j);
+			joint.localAnchorA = revolute.GetLocalAnchorA();
+			joint.localAnchorB = revolute.GetLocalAnchorB();
+			joint.referenceAngle = revolute.GetReferenceAngle();
+			joint.enableMotor = revolute.IsMotorEnabled();
+			joint.motorSpeed = revolute.GetMotorSpeed();
+			joint.maxMotorTorque = revolute.GetMaxMotorTorque();
+			joint.impulse = revolute.*RevoluteJointAccess::impulse();
+			joint.motorImpulse = revolute.*RevoluteJointAccess::motorImpulse();
+		}
+		else if (joint.type == e_distanceJoint) {
+			auto& distance = static_cast<const b2DistanceJoint&>(*j);
+			joint.localAnchorA = distance.GetLocalAnchorA();
+			joint.localAnchorB = distance.GetLocalAnchorB();
+			joint.length = distance.GetLength();
+			joint.frequencyHz = distance.GetFrequency();
+			joint.dampingRatio = distance.GetDampingRatio();
+			joint.impulse.x = distance.*DistanceJointAccess::impulse();
+		}
+		else {
+			FAIL("Joint::Type doesn't create this kind of joint");
+		}
+
+		state.joints.emplace_back(joint);
+	}
+
+	state.particles.resize(mParticleSystems.size());
+	auto saved = state.particles.begin();
+	for (auto&& ps : mParticleSystems) {
+		auto& system = ps->getParticleSystem();
+		auto count = system.GetParticleCount();
+		auto& particles = *saved++;
+
+		particles.positions.assign(system.GetPositionBuffer(), system.GetPositionBuffer() + count);
+		particles.velocities.assign(system.GetVelocityBuffer(), system.GetVelocityBuffer() + count);
+		particles.flags.assign(system.GetFlagsBuffer(), system.GetFlagsBuffer() + count);
+		particles.colors.assign(system.GetColorBuffer(), system.GetColorBuffer() + count);
+		particles.lifetimes.assign(count, 0.f);
+		if (system.GetDestructionByAge()) {
+			for (int32 i = 0; i < count; ++i) {
+				particles.lifetimes[i] = system.GetParticleLifetime(i);
+			}
+		}
+	}
+}
+
+void World::restoreState(const WorldState& state) {
+	DEBUG_ASSERT(isWorkerThread(), "Wrong Thread");
+
+	//Box2D reports the contacts destroyed and found by the restore, but they didn't happen in the simulation
+	auto replaying = mReplaying;
+	mReplaying = true;
+
+	_matchState(state, true);
+
+	for (auto&& b : mBodies) {
+		_restoreBody(*b, state.bodies);
+	}
+
+	_restoreContacts(state);
+	_restoreParticles(state);
+
+	mReplaying = replaying;
+}
+
+void World::_restoreBody(Body& b, const BodySnapshot& state) {
+	auto slot = b._getSnapshotSlot();
+	auto& body = b.getB2Body().unwrap();
+	auto flags = state.flags[slot];
+
+	body.SetActive((flags & BodySnapshot::Active) != 0);
+	body.SetTransform(state.positions[slot], state.angles[slot]);
+
+	//falling asleep clears the velocity, so it goes first
+	body.SetAwake((flags & BodySnapshot::Moving) != 0);
+	body.SetLinearVelocity(state.velocities[slot]);
+	body.SetAngularVelocity(state.angularVelocities[slot]);
+
+	_onBodyChanged(body);
+}
+
+void World::_matchState(const WorldState& state, bool restore) {
+	auto& bodies = state.bodies;
+
+	//the bodies created after the state wait, inactive, until the tick that created them
+	std::vector<Body*> missing;
+	for (auto&& b : mBodies) {
+		if (not bodies.contains(b->_getSnapshotSlot(), b->_getSnapshotId())) {
+			missing.emplace_back(b);
+		}
+	}
+
+	for (auto&& b : missing) {
+		mBodies.erase(b);
+		b->getB2Body().unwrap().SetActive(false);
+		_onBodyChanged(b->getB2Body().unwrap());
+
+		//the removed bodies are already waiting in mRetiredBodies
+		if (not _isRetired(*b)) {
+			mSuspendedBodies.emplace_back(b);
+		}
+	}
+
+	auto bringBack = [&](Body& b) {
+		if (not mBodies.contains(&b) and bodies.contains(b._getSnapshotSlot(), b._getSnapshotId())) {
+			mBodies.emplace(&b);
+			_restoreBody(b, bodies);
+			return true;
+		}
+		return false;
+	};
+
+	mSuspendedBodies.erase(std::remove_if(mSuspendedBodies.begin(), mSuspendedBodies.end(), [&](Body* b) {
+		return bringBack(*b);
+	}), mSuspendedBodies.end());
+
+	//and the bodies removed after the state come back until the tick that removed them
+	for (auto&& retired : mRetiredBodies) {
+		bringBack(*retired.body);
+	}
+
+	//joints are matched to the state by their bodies
+	std::vector<bool> matched(state.joints.size(), false);
+	auto matchJoint = [&](Joint& joint) {
+		auto slotA = joint.getBodyA()._getSnapshotSlot();
+		auto slotB = joint.getBodyB()._getSnapshotSlot();
+		bool exists = joint.getB2Joint().is_some();
+
+		//the slots of the bodies that are not in the state might belong to other bodies in it
+		bool live = mBodies.contains(&joint.getBodyA()) and mBodies.contains(&joint.getBodyB());
+
+		for (size_t i = 0; live and i < state.joints.size(); ++i) {
+			auto& saved = state.joints[i];
+			if (matched[i] or saved.slotA != slotA or saved.slotB != slotB) {
+				continue;
+			}
+
+			matched[i] = true;
+			if (not exists) {
+				Joint::b2MultiJointDesc def;
+				if (saved.type == e_revoluteJoint) {
+					def.revolute = b2RevoluteJointDef();
+					def.revolute.localAnchorA = saved.localAnchorA;
+					def.revolute.localAnchorB = saved.localAnchorB;
+					def.revolute.referenceAngle = saved.referenceAngle;
+				}
+				else {
+					def.distance = b2DistanceJointDef();
+					def.distance.localAnchorA = saved.localAnchorA;
+					def.distance.localAnchorB = saved.localAnchorB;
+				}
+
+				def.generic.bodyA = &joint.getBodyA().getB2Body().unwrap();
+				def.generic.bodyB = &joint.getBodyB().getB2Body().unwrap();
+				def.generic.collideConnected = saved.collideConnected;
+				def.generic.userData = &joint;
+				joint._resume(self, def.generic);
+			}
+
+			if (restore or not exists) {
+				writeJointState(joint.getB2Joint().unwrap(), saved);
+			}
+			return;
+		}
+
+		if (exists) {
+			joint._suspend(self);
+		}
+	};
+
+	for (auto&& joint : mJoints) {
+		matchJoint(*joint);
+	}
+
+	for (auto&& retired : mRetiredJoints) {
+		matchJoint(*retired.joint);
+	}
+}
+
+void World::_restoreContacts(const WorldState& state) {
+	std::vector<Body*> bodies(state.bodies.size(), nullptr);
+	for (auto&& b : mBodies) {
+		auto slot = b->_getSnapshotSlot();
+		if (slot < bodies.size() and b->getB2Body().unwrap().IsActive()) {
+			bodies[slot] = b;
+		}
+	}
+
+	//HACK the contact manager is only exposed as const, but its methods are public
+	auto& contactManager = const_cast<b2ContactManager&>(mBox2D->GetContactManager());
+	auto flags = ContactAccess::flags();
+	auto touching = ContactAccess::touchingFlag();
+
+	//the contacts that are not in the state start over, like if the broadphase just found them
+	for (auto c = mBox2D->GetContactList(); c; c = c->GetNext()) {
+		c->GetManifold()->pointCount = 0;
+		c->*flags &= ~touching;
+	}
+
+	for (auto&& saved : state.contacts) {
+		auto A = getFixture(bodies, saved.slotA, saved.fixtureA);
+		auto B = getFixture(bodies, saved.slotB, saved.fixtureB);
+		if (not A or not B or saved.childA >= A->GetShape()->GetChildCount() or saved.childB >= B->GetShape()->GetChildCount()) {
+			continue;
+		}
+
+		auto contact = findContact(*A, saved.childA, *B, saved.childB);
+		if (not contact) {
+			auto proxies = FixtureAccess::proxies();
+			contactManager.AddPair(&(A->*proxies)[saved.childA], &(B->*proxies)[saved.childB]);
+
+			contact = findContact(*A, saved.childA, *B, saved.childB);
+			if (not contact) {
+				continue; //the filter doesn't let them collide anymore
+			}
+		}
+
+		*contact->GetManifold() = saved.manifold;
+		contact->SetEnabled((saved.flags & WorldState::Enabled) != 0);
+		if (saved.flags & WorldState::Touching) {
+			contact->*flags |= touching;
+		}
+	}
+
+	//the force fields only know their contacts from BeginContact, so they are told again about the touching ones
+	for (auto&& part : mActiveForceFields) {
+		part->getForceField().unwrap().clearContacts();
+	}
+	mActiveForceFields.clear();
+
+	for (auto c = mBox2D->GetContactList(); c; c = c->GetNext()) {
+		if (not c->IsTouching()) {
+			continue;
+		}
+
+		auto& partA = getPartForFixture(c->GetFixtureA());
+		auto& partB = getPartForFixture(c->GetFixtureB());
+		if (partA.type == BodyPartType::ForceField) {
+			_beginFieldContact(partA, partB);
+		}
+		else if (partB.type == BodyPartType::ForceField) {
+			_beginFieldContact(partB, partA);
+		}
+	}
+}
+
+void World::_restoreParticles(const WorldState& state) {
+	DEBUG_ASSERT(state.particles.size() == mParticleSystems.size(), "The state has different particle systems");
+
+	auto saved = state.particles.begin();
+	for (auto&& ps : mParticleSystems) {
+		if (saved == state.particles.end()) {
+			break;
+		}
+
+		auto& particles = *saved++;
+		auto& system = ps->getParticleSystem();
+		auto count = (int32)particles.size();
+
+		//the particles created after the state are destroyed, and the ones destroyed after it are created again;
+		//the groups can't be restored, so the particles created again don't belong to any
+		for (int32 i = count; i < system.GetParticleCount(); ++i) {
+			system.DestroyParticle(i);
+		}
+
+		for (int32 i = system.GetParticleCount(); i < count; ++i) {
+			b2ParticleDef def;
+			def.flags = particles.flags[i];
+			def.position = particles.positions[i];
+			def.velocity = particles.velocities[i];
+			def.color = particles.colors[i];
+			def.lifetime = particles.lifetimes[i];
+			def.userData = ps;
+			system.CreateParticle(def);
+		}
+
+		count = std::min(count, system.GetParticleCount());
+		std::copy_n(particles.positions.data(), count, system.GetPositionBuffer());
+		std::copy_n(particles.velocities.data(), count, system.GetVelocityBuffer());
+		std::copy_n(particles.colors.data(), count, system.GetColorBuffer());
+
+		for (int32 i = 0; i < count; ++i) {
+			system.SetParticleFlags(i, particles.flags[i]);
+			if (system.GetDestructionByAge()) {
+				system.SetParticleLifetime(i, particles.lifetimes[i]);
+			}
+		}
+	}
+}
+
+void World::_destroyRetired() {
+	auto window = (uint32_t)mSavedStates.size();
+
+	//joints first, as they refer to their bodies
+	mRetiredJoints.erase(std::remove_if(mRetiredJoints.begin(), mRetiredJoints.end(), [&](RetiredJoint& retired) {
+		if (retired.tick + window > mTick) {
+			return false;
+		}
+
+		if (retired.joint->getB2Joint().is_some()) {
+			retired.joint->_suspend(self);
+		}
+		return true;
+	}), mRetiredJoints.end());
+
+	mRetiredBodies.erase(std::remove_if(mRetiredBodies.begin(), mRetiredBodies.end(), [&](RetiredBody& retired) {
+		if (retired.tick + window > mTick) {
+			return false;
+		}
+
+		DEBUG_ASSERT(not mBodies.contains(retired.body), "A body brought back by a rollback wasn't removed again");
+		retired.body->_destroyB2Body();
+		return true;
+	}), mRetiredBodies.end());
+}
+
+bool World::_isRetired(const Body& body) const {
+	for (auto&& retired : mRetiredBodies) {
+		if (retired.body == &body) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void World::_releaseBody(std::shared_ptr<Dojo::Component> owner) {
+	DEBUG_ASSERT(isWorkerThread(), "Wrong Thread");
+
+	//a retired body can still be brought back by a rollback, so it has to live until it's destroyed
+	for (auto&& retired : mRetiredBodies) {
+		if (retired.body == owner.get()) {
+			retired.owner = std::move(owner);
+			return;
+		}
+	}
+}
+
+void World::_captureBodies(BodySnapshot& snapshot) const {
+	snapshot.reset(mSnapshotSize);
+
+	for (auto&& b : mBodies) {
+		auto& body = b->getB2Body().unwrap();
+		auto slot = b->_getSnapshotSlot();
+
+		snapshot.ids[slot] = b->_getSnapshotId();
+		snapshot.positions[slot] = body.GetPosition();
+		snapshot.angles[slot] = body.GetAngle();
+		snapshot.velocities[slot] = body.GetLinearVelocity();
+		snapshot.angularVelocities[slot] = body.GetAngularVelocity();
+		snapshot.masses[slot] = body.GetMass();
+
+		uint8_t flags = 0;
+		if (body.IsAwake() and body.IsActive()) {
+			flags |= BodySnapshot::Moving;
+		}
+		if (body.IsActive()) {
+			flags |= BodySnapshot::Active;
+		}
+		if (body.IsFixedRotation()) {
+			flags |= BodySnapshot::FixedRotation;
+		}
+		snapshot.flags[slot] = flags;
+	}
+}
+
+uint64_t World::checksum(const BodySnapshot& state) {
+	//FNV-1a over the bytes of the fields that the simulation changes
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const void* data, size_t size) {
+		auto bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+
+	//only the live slots count, and not their ids, which are local to each machine
+	for (size_t slot = 0; slot < state.size(); ++slot) {
+		if (state.ids[slot] == 0) {
+			continue;
+		}
+
+		add(&state.positions[slot], sizeof(b2Vec2));
+		add(&state.velocities[slot], sizeof(b2Vec2));
+		add(&state.angles[slot], sizeof(float));
+		add(&state.angularVelocities[slot], sizeof(float));
+	}
+	return hash;
+}
+
+void World::_publishSnapshot() {
+	auto& snapshot = mSnapshots.getWriteBuffer();
+	_captureBodies(snapshot);
+
+	if (mLockstep) {
+		mLastChecksum = checksum(snapshot);
+	}
+
+	//the ticks simulated again by a rollback are not shown, the main thread only sees where it ends
+	if (mReplaying) {
+		return;
+	}
+
+	snapshot.time = Dojo::durationToSeconds(std::chrono::high_resolution_clock::now().time_since_epoch());
+	mSnapshots.publish();
+}
+
+void World::_applySnapshots() {
+	mSnapshots.acquire();
+
+	auto& current = mSnapshots.getCurrent();
+	auto& previous = mSnapshots.getPrevious();
+
+	//show the bodies one snapshot interval in the past, so that there are always two snapshots to interpolate
+	float alpha = 1;
+	auto interval = current.time - previous.time;
+	if (interval > 0) {
+		auto now = Dojo::durationToSeconds(std::chrono::high_resolution_clock::now().time_since_epoch());
+		alpha = (float)glm::clamp((now - current.time) / interval, 0.0, 1.0);
+	}
+
+	for (uint32_t slot = 0; slot < mSnapshotOwners.size(); ++slot) {
+		auto body = mSnapshotOwners[slot];
+		if (not body or not current.contains(slot, body->_getSnapshotId())) {
+			continue;
+		}
+
+		auto flags = current.flags[slot];
+		bool hasPrevious = previous.contains(slot, body->_getSnapshotId());
+		bool moving = (flags & BodySnapshot::Moving) != 0;
+		bool wasMoving = hasPrevious and (previous.flags[slot] & BodySnapshot::Moving);
+
+		//sleeping bodies were already moved to their final position when they stopped
+		if (not moving and not wasMoving) {
+			continue;
+		}
+
+		auto position = current.positions[slot];
+		auto angle = current.angles[slot];
+		if (moving and hasPrevious) {
+			position = previous.positions[slot] + alpha * (position - previous.positions[slot]);
+			angle = previous.angles[slot] + alpha * (angle - previous.angles[slot]);
+		}
+
+		body->updateObject(asVec(position), Radians(angle), asVec(current.velocities[slot]), (flags & BodySnapshot::FixedRotation) != 0);
+	}
+}
+
+void World::removeBody(Body& body) {
+	DEBUG_ASSERT(isWorkerThread(), "Wrong Thread");
+
+	if (mLockstep and _isRetired(body)) {
+		return;
+	}
+
+	//go over all joints active on this body and deactivate them
+	auto joints = body.getJoints(); //copy because getjoints will remove the joints from the vector
+	for (auto&& joint : joints) {
+		removeJoint(*joint);
+	}
+
+	mBodies.erase(&body);
+
+	//in lockstep the body stays, inactive, until a rollback can't bring it back anymore
+	if (mLockstep) {
+		mSuspendedBodies.erase(std::remove(mSuspendedBodies.begin(), mSuspendedBodies.end(), &body), mSuspendedBodies.end());
+		body.getB2Body().unwrap().SetActive(false);
+		_onBodyChanged(body.getB2Body().unwrap());
+		mRetiredBodies.push_back({ &body, mTick, {} });
+	}
+	else {
+		body._destroyB2Body();
+	}
+}
+
+void World::pause() {
+	asyncCommand([this] {
+		DEBUG_ASSERT(not mSimulationPaused, "Already paused");
+		mSimulationPaused = true;
+
+		//tell all bodies they're being paused
+		for (auto&& body : mBodies) {
+			body->onSimulationPaused();
+		}
+	});
+}
+
+void World::resume() {
+	asyncCommand([this] {
+		DEBUG_ASSERT(mSimulationPaused, "Already resumed");
+		mSimulationPaused = false;
+	});
+}
+
+#ifndef PUBLISH
+World::PerformanceInfo World::queryPerformanceInfo() {
+	auto queries = mParallelQueries.exchange(0);
+	auto queryNanoseconds = mParallelQueryNanoseconds.exchange(0);
+
 	auto info = PerformanceInfo{
 		float(mTotalUsageTime / mTotalIngameTime),
-		float(mTotalSimulationTime / mTotalIngameTime)
+		float(mTotalSimulationTime / mTotalIngameTime),
+		queries,
+		queries ? float(queryNanoseconds * 1e-9 / queries) : 0.f,
+		mSettledClones,
+		mSettledClones ? float(mTotalSettleTime / mSettledClones) : 0.f,
+		mFilteredPairs,
+		mFilteredPairs ? float(mRejectedPairs) / mFilteredPairs : 0.f,
+		mTotalSimulationTime > 0 ? float(mTotalContactTime / mTotalSimulationTime) : 0.f,
+		mStateCaptures ? float(mTotalCaptureTime / mStateCaptures) : 0.f,
+		mStateRestores ? float(mTotalRestoreTime / mStateRestores) : 0.f
 	};
 
+	mSettledClones = 0;
+	mTotalSettleTime = 0;
+	mTotalContactTime = 0;
+	mFilteredPairs = mRejectedPairs = 0;
+	mStateCaptures = mStateRestores = 0;
+	mTotalCaptureTime = mTotalRestoreTime = 0;
+
 	mTotalIngameTime = 0;
 	mTotalSimulationTime = mTotalUsageTime = 0;
 
 	return info;
 }
 
-DebugDrawMeshBuilder& World::createDebugDrawMesh() {
+DebugDrawMeshBuilder& World::createDebugDrawMesh(Dojo::Object& parent, Dojo::RenderLayer::ID layer, Dojo::Shader& shader, const Dojo::Viewport& viewport) {
 	DEBUG_ASSERT(mDebugMeshBuilder == nullptr, "Already created");
 
-	mDebugMeshBuilder = make_unique<DebugDrawMeshBuilder>();
+	mDebugMeshBuilder = make_unique<DebugDrawMeshBuilder>(parent, layer, shader, viewport);
 	mBox2D->SetDebugDraw(mDebugMeshBuilder.get());
 	
 	return *mDebugMeshBuilder;
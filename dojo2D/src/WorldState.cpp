@@ -0,0 +1,265 @@
+#include "WorldState.h"
+
+using namespace Phys;
+
+namespace {
+	const uint32_t MAGIC = 0x31535744; //"DWS1"
+
+	template<typename T>
+	void write(std::vector<uint8_t>& out, const T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+		auto bytes = (const uint8_t*)&value;
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	template<typename T>
+	void writeArray(std::vector<uint8_t>& out, const std::vector<T>& values) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+		auto bytes = (const uint8_t*)values.data();
+		out.insert(out.end(), bytes, bytes + values.size() * sizeof(T));
+	}
+
+	///reads values in order, and fails every read after the first one that goes past the end
+	class Reader {
+	public:
+		Reader(vec_view<uint8_t> data) :
+			mData(data) {
+
+		}
+
+		template<typename T>
+		bool read(T& value) {
+			return readBytes(&value, sizeof(T));
+		}
+
+		template<typename T>
+		bool readArray(std::vector<T>& values, size_t count) {
+			//check the count first, so that a corrupt one can't allocate the whole memory
+			if (count > (mData.size() - mPosition) / sizeof(T)) {
+				mFailed = true;
+				return false;
+			}
+			values.resize(count);
+			return readBytes(values.data(), count * sizeof(T));
+		}
+
+		///true if there are at least count elements of size left, for the counts that size the vectors
+		bool canRead(size_t count, size_t size) const {
+			return not mFailed and count <= (mData.size() - mPosition) / size;
+		}
+
+		bool done() const {
+			return not mFailed and mPosition == mData.size();
+		}
+
+	private:
+		vec_view<uint8_t> mData;
+		size_t mPosition = 0;
+		bool mFailed = false;
+
+		bool readBytes(void* dest, size_t size) {
+			if (mFailed or size > mData.size() - mPosition) {
+				mFailed = true;
+				return false;
+			}
+			memcpy(dest, mData.data() + mPosition, size);
+			mPosition += size;
+			return true;
+		}
+	};
+}
+
+void WorldState::serialize(std::vector<uint8_t>& out) const {
+	uint32_t liveBodies = 0;
+	for (auto id : bodies.ids) {
+		liveBodies += id != 0;
+	}
+
+	write(out, MAGIC);
+	write(out, tick);
+	write(out, (uint32_t)bodies.size());
+	write(out, liveBodies);
+	write(out, (uint32_t)contacts.size());
+	write(out, (uint32_t)joints.size());
+	write(out, (uint32_t)particles.size());
+
+	for (uint32_t slot = 0; slot < bodies.size(); ++slot) {
+		if (bodies.ids[slot] == 0) {
+			continue;
+		}
+
+		write(out, slot);
+		write(out, bodies.ids[slot]);
+		write(out, bodies.positions[slot]);
+		write(out, bodies.angles[slot]);
+		write(out, bodies.velocities[slot]);
+		write(out, bodies.angularVelocities[slot]);
+		write(out, bodies.flags[slot]);
+	}
+
+	for (auto&& contact : contacts) {
+		auto& manifold = contact.manifold;
+		write(out, contact.slotA);
+		write(out, contact.slotB);
+		write(out, contact.fixtureA);
+		write(out, contact.fixtureB);
+		write(out, contact.childA);
+		write(out, contact.childB);
+		write(out, contact.flags);
+		write(out, (uint8_t)manifold.type);
+		write(out, (uint8_t)manifold.pointCount);
+
+		//contacts that don't touch have no points, and are just the pair
+		if (manifold.pointCount > 0) {
+			write(out, manifold.localNormal);
+			write(out, manifold.localPoint);
+			for (int32 i = 0; i < manifold.pointCount; ++i) {
+				auto& point = manifold.points[i];
+				write(out, point.localPoint);
+				write(out, point.normalImpulse);
+				write(out, point.tangentImpulse);
+				write(out, point.id.key);
+			}
+		}
+	}
+
+	for (auto&& joint : joints) {
+		write(out, joint.slotA);
+		write(out, joint.slotB);
+		write(out, (uint8_t)joint.type);
+		write(out, (uint8_t)joint.collideConnected);
+		write(out, (uint8_t)joint.enableMotor);
+		write(out, joint.localAnchorA);
+		write(out, joint.localAnchorB);
+		write(out, joint.referenceAngle);
+		write(out, joint.motorSpeed);
+		write(out, joint.maxMotorTorque);
+		write(out, joint.length);
+		write(out, joint.frequencyHz);
+		write(out, joint.dampingRatio);
+		write(out, joint.impulse);
+		write(out, joint.motorImpulse);
+	}
+
+	for (auto&& system : particles) {
+		write(out, (uint32_t)system.size());
+		writeArray(out, system.positions);
+		writeArray(out, system.velocities);
+		writeArray(out, system.flags);
+		writeArray(out, system.colors);
+		writeArray(out, system.lifetimes);
+	}
+}
+
+bool WorldState::deserialize(vec_view<uint8_t> data) {
+	Reader reader(data);
+
+	uint32_t magic = 0, slots = 0, liveBodies = 0, contactCount = 0, jointCount = 0, systemCount = 0;
+	reader.read(magic);
+	reader.read(tick);
+	reader.read(slots);
+	reader.read(liveBodies);
+	reader.read(contactCount);
+	reader.read(jointCount);
+	reader.read(systemCount);
+
+	//each element takes at least this many bytes, so that corrupt counts fail before allocating
+	if (magic != MAGIC or liveBodies > slots or
+		not reader.canRead(liveBodies, 33) or
+		not reader.canRead(contactCount, 19) or
+		not reader.canRead(jointCount, 67) or
+		not reader.canRead(systemCount, 4)) {
+		return false;
+	}
+
+	bodies.reset(slots);
+	for (uint32_t i = 0; i < liveBodies; ++i) {
+		uint32_t slot = 0;
+		if (not reader.read(slot) or slot >= slots) {
+			return false;
+		}
+
+		reader.read(bodies.ids[slot]);
+		reader.read(bodies.positions[slot]);
+		reader.read(bodies.angles[slot]);
+		reader.read(bodies.velocities[slot]);
+		reader.read(bodies.angularVelocities[slot]);
+		reader.read(bodies.flags[slot]);
+	}
+
+	contacts.resize(contactCount);
+	for (auto&& contact : contacts) {
+		uint8_t type = 0, pointCount = 0;
+		reader.read(contact.slotA);
+		reader.read(contact.slotB);
+		reader.read(contact.fixtureA);
+		reader.read(contact.fixtureB);
+		reader.read(contact.childA);
+		reader.read(contact.childB);
+		reader.read(contact.flags);
+		reader.read(type);
+		reader.read(pointCount);
+
+		if (type > b2Manifold::e_faceB or pointCount > b2_maxManifoldPoints) {
+			return false;
+		}
+
+		auto& manifold = contact.manifold;
+		manifold = b2Manifold();
+		manifold.type = (b2Manifold::Type)type;
+		manifold.pointCount = pointCount;
+
+		if (pointCount > 0) {
+			reader.read(manifold.localNormal);
+			reader.read(manifold.localPoint);
+			for (int32 i = 0; i < manifold.pointCount; ++i) {
+				auto& point = manifold.points[i];
+				reader.read(point.localPoint);
+				reader.read(point.normalImpulse);
+				reader.read(point.tangentImpulse);
+				reader.read(point.id.key);
+			}
+		}
+	}
+
+	joints.resize(jointCount);
+	for (auto&& joint : joints) {
+		uint8_t type = 0, collideConnected = 0, enableMotor = 0;
+		reader.read(joint.slotA);
+		reader.read(joint.slotB);
+		reader.read(type);
+		reader.read(collideConnected);
+		reader.read(enableMotor);
+		reader.read(joint.localAnchorA);
+		reader.read(joint.localAnchorB);
+		reader.read(joint.referenceAngle);
+		reader.read(joint.motorSpeed);
+		reader.read(joint.maxMotorTorque);
+		reader.read(joint.length);
+		reader.read(joint.frequencyHz);
+		reader.read(joint.dampingRatio);
+		reader.read(joint.impulse);
+		reader.read(joint.motorImpulse);
+
+		if (type != e_revoluteJoint and type != e_distanceJoint) {
+			return false;
+		}
+
+		joint.type = (b2JointType)type;
+		joint.collideConnected = collideConnected != 0;
+		joint.enableMotor = enableMotor != 0;
+	}
+
+	particles.resize(systemCount);
+	for (auto&& system : particles) {
+		uint32_t count = 0;
+		reader.read(count);
+		reader.readArray(system.positions, count);
+		reader.readArray(system.velocities, count);
+		reader.readArray(system.flags, count);
+		reader.readArray(system.colors, count);
+		reader.readArray(system.lifetimes, count);
+	}
+
+	return reader.done();
+}
@@ -40,6 +40,7 @@
 #include <dojo/RenderState.h>
 #include <dojo/Renderable.h>
 #include <dojo/ResourceGroup.h>
+#include <dojo/Semaphore.h>
 #include <dojo/SoundBuffer.h>
 #include <dojo/SoundListener.h>
 #include <dojo/SoundManager.h>
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "Semaphore.h"
+
+namespace Dojo {
+	///A mutex that spins with exponential backoff before putting the thread to sleep
+	/**
+	locking and unlocking an uncontended AdaptiveMutex costs a single atomic operation, and short critical sections
+	are usually over before the spinning ends; only a thread that spun in vain parks on the semaphore.
+	It can be used with std::lock_guard and std::unique_lock. */
+	class AdaptiveMutex {
+	public:
+		AdaptiveMutex() = default;
+		AdaptiveMutex(const AdaptiveMutex&) = delete;
+		AdaptiveMutex& operator=(const AdaptiveMutex&) = delete;
+
+		void lock();
+
+		bool try_lock() {
+			int32_t expected = 0;
+			return mState.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+		}
+
+		void unlock() {
+			//hand the lock to a sleeping thread, if any
+			if (mState.fetch_sub(1, std::memory_order_release) > 1) {
+				mWaiters.notifyOne();
+			}
+		}
+
+	private:
+		///the owner plus the threads waiting to acquire the lock
+		std::atomic<int32_t> mState = { 0 };
+		Semaphore mWaiters = Semaphore(0);
+	};
+
+	///A primitive that lets an idle thread sleep until a condition it checks without locks might have become true
+	/**
+	the waiter calls prepareWait(), checks its condition again and then either cancelWait() or wait() with the key it got;
+	a notification that comes after prepareWait() is never lost.
+	notifyOne() and notifyAll() cost a single load when no one is waiting, so producers can call them after every push. */
+	class EventCount {
+	public:
+		typedef uint32_t Key;
+
+		EventCount() = default;
+		EventCount(const EventCount&) = delete;
+		EventCount& operator=(const EventCount&) = delete;
+
+		Key prepareWait() {
+			return static_cast<Key>(mState.fetch_add(1, std::memory_order_seq_cst) >> EpochShift);
+		}
+
+		void cancelWait() {
+			mState.fetch_sub(1, std::memory_order_seq_cst);
+		}
+
+		///sleeps until a notification newer than key arrives
+		void wait(Key key);
+
+		void notifyOne() {
+			_notify(false);
+		}
+
+		void notifyAll() {
+			_notify(true);
+		}
+
+	private:
+		static const uint64_t EpochShift = 32;
+		static const uint64_t WaiterMask = (1ull << EpochShift) - 1;
+
+		///the epoch in the high bits, the number of waiters in the low bits
+		std::atomic<uint64_t> mState = { 0 };
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+
+		void _notify(bool all);
+	};
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "MappedFile.h"
+
+namespace Dojo {
+	class WorkerPool;
+
+	///An AssetPack is an engine-native read-only archive, built from a data folder by make_pack.py
+	/**
+	The pack is memory mapped and its tables are used in place, they are only validated when the pack is opened;
+	names are found with a perfect hash and a single comparison.
+	The files of each folder are laid out contiguously, page aligned and in the order in which a ResourceGroup loads them,
+	so that prefetching a folder turns into one large sequential read; each file can be stored or compressed with LZ4 or deflate.
+
+	An AssetPack can be used from any thread. */
+	class AssetPack : public std::enable_shared_from_this<AssetPack> {
+	public:
+		///the extension of the pack files, without the dot
+		static const utf::string_view Extension;
+
+		static const uint32_t Version = 1;
+
+		///files prefetched and not used yet are kept in memory up to this size, the others are decompressed when they are opened
+		static const size_t MaxPrefetchedSize = 64 * 1024 * 1024;
+
+		enum class Compression : uint8_t {
+			None,
+			LZ4,
+			Deflate
+		};
+
+		struct Entry {
+			uint64_t offset;
+			uint32_t compressedSize;
+			uint32_t size;
+			uint32_t nameOffset;
+			uint16_t nameLength;
+			Compression compression;
+			uint8_t reserved;
+		};
+
+		struct Folder {
+			uint64_t dataOffset;
+			uint64_t dataSize;
+			uint32_t firstEntry;
+			uint32_t entryCount;
+			uint32_t nameOffset;
+			uint16_t nameLength;
+			uint16_t reserved;
+		};
+
+		explicit AssetPack(utf::string_view path);
+
+		AssetPack(const AssetPack&) = delete;
+		AssetPack& operator=(const AssetPack&) = delete;
+
+		bool isValid() const {
+			return mValid;
+		}
+
+		///returns the entry with this path relative to the root of the pack, if any
+		optional_ref<const Entry> find(utf::string_view path) const;
+
+		///adds the paths of all the files directly inside folder, relative to the root of the pack, in their load order
+		void getFiles(utf::string_view folder, std::vector<utf::string>& out) const;
+
+		///returns the uncompressed content of an entry
+		/**
+		Stored entries point straight in the pack, the others are taken from the prefetched files or decompressed right away.
+		\param owner receives the object that keeps the content alive
+		\returns an empty view if the entry is corrupt */
+		vec_view<uint8_t> getContent(const Entry& entry, std::shared_ptr<const void>& owner);
+
+		///starts reading the whole folder with one large read and decompressing its files in parallel on pool
+		void prefetch(utf::string_view folder, WorkerPool& pool);
+
+		uint32_t getEntryCount() const {
+			return mEntryCount;
+		}
+
+	private:
+		typedef std::shared_ptr<const std::vector<uint8_t>> Buffer;
+
+		MappedFile mFile;
+		bool mValid = false;
+
+		uint32_t mEntryCount = 0, mSlotCount = 0, mBucketCount = 0, mFolderCount = 0;
+		const uint32_t* mSeeds = nullptr;
+		const uint32_t* mSlots = nullptr;
+		const Entry* mEntries = nullptr;
+		const Folder* mFolders = nullptr;
+		const char* mNames = nullptr;
+		size_t mNamesSize = 0;
+
+		std::unordered_map<uint32_t, Buffer> mPrefetched;
+		size_t mPrefetchedSize = 0;
+		std::mutex mPrefetchedMutex;
+
+		bool _parse();
+
+		utf::string_view _getName(uint32_t nameOffset, uint16_t nameLength) const;
+		optional_ref<const Folder> _findFolder(utf::string_view folder) const;
+
+		vec_view<uint8_t> _getData(const Entry& entry) const;
+		Buffer _decompress(const Entry& entry) const;
+	};
+}
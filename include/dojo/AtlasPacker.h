@@ -0,0 +1,130 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "PixelFormat.h"
+
+namespace Dojo {
+	///AtlasPacker packs many small images in a few big atlas pages using the MaxRects algorithm
+	/**
+	Images are trimmed of their fully transparent borders and can be rotated by 90 degrees to fit better;
+	each of them is surrounded by a padding made of copies of its border pixels, so that filtering never bleeds from its neighbours.
+	Images in the same group always end up in the same page, so that a whole FrameSet can refer to a single atlas.
+
+	The packer runs at load time in the ResourceGroups with autoAtlas set, or offline with packFolder to write the page images and their .atlasinfo */
+	class AtlasPacker {
+	public:
+		struct Settings {
+			///the biggest side of a page; images bigger than this get a page of their own
+			uint32_t pageSize = 2048;
+			///the pixels of border around each image
+			uint32_t padding = 2;
+			bool allowRotation = true;
+			bool trim = true;
+			///when false, the groups that don't fit in a single page are left out of the pages rather than split
+			bool splitGroups = true;
+		};
+
+		///where an image was placed
+		struct Placement {
+			///the page of an image that was left out, see Settings::splitGroups
+			static const uint32_t NotPlaced = UINT32_MAX;
+
+			uint32_t page = 0;
+			///the rect that contains the trimmed image in the page, without padding
+			uint32_t x = 0, y = 0, width = 0, height = 0;
+			///the image is stored rotated 90 degrees clockwise, so the rect has width and height swapped
+			bool rotated = false;
+			///the position of the trimmed rect in the original image
+			uint32_t trimX = 0, trimY = 0;
+			uint32_t originalWidth = 0, originalHeight = 0;
+		};
+
+		///reads an image file as tightly packed RGBA8 pixels; can be called from any thread
+		static PixelFormat readImage(utf::string_view path, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height);
+
+		///packs all the image sequences in folder and writes their pages and a outputName.atlasinfo in outputFolder
+		/**
+		each sequence becomes a FrameSet named after it in the .atlasinfo, just like addSets would name it if the images were loose */
+		static bool packFolder(utf::string_view folder, utf::string_view outputFolder, utf::string_view outputName, const Settings& settings);
+
+		AtlasPacker();
+		explicit AtlasPacker(const Settings& settings);
+
+		///adds a tightly packed RGBA8 image to be packed and returns its index
+		/**
+		\param group images with the same group are placed in the same page */
+		uint32_t add(std::vector<uint8_t> rgba, uint32_t width, uint32_t height, int group = -1);
+
+		///places all the images in pages
+		/**
+		\returns false if a group was too big for a single page and had to be split or left out */
+		bool pack();
+
+		uint32_t getImageCount() const {
+			return static_cast<uint32_t>(mImages.size());
+		}
+
+		uint32_t getPageCount() const {
+			return static_cast<uint32_t>(mPages.size());
+		}
+
+		uint32_t getPageWidth(uint32_t page) const {
+			return mPages.at(page).usedWidth;
+		}
+
+		uint32_t getPageHeight(uint32_t page) const {
+			return mPages.at(page).usedHeight;
+		}
+
+		const Placement& getPlacement(uint32_t image) const {
+			return mImages.at(image).placement;
+		}
+
+		bool isPlaced(uint32_t image) const {
+			return getPlacement(image).page != Placement::NotPlaced;
+		}
+
+		///returns the fraction of the pages' area covered by the trimmed images
+		float getEfficiency() const;
+
+		///composes the RGBA8 pixels of a page, getPageWidth * getPageHeight * 4 bytes
+		std::vector<uint8_t> renderPage(uint32_t page) const;
+
+	private:
+		struct Rect {
+			uint32_t x, y, width, height;
+
+			bool contains(const Rect& r) const {
+				return r.x >= x and r.y >= y and r.x + r.width <= x + width and r.y + r.height <= y + height;
+			}
+
+			bool intersects(const Rect& r) const {
+				return r.x < x + width and x < r.x + r.width and r.y < y + height and y < r.y + r.height;
+			}
+		};
+
+		struct Image {
+			std::vector<uint8_t> rgba;
+			uint32_t width, height;
+			int group;
+			Placement placement;
+		};
+
+		struct Page {
+			uint32_t width, height;
+			uint32_t usedWidth = 0, usedHeight = 0;
+			std::vector<Rect> freeRects;
+		};
+
+		Settings mSettings;
+		std::vector<Image> mImages;
+		std::vector<Page> mPages;
+
+		Page _makePage(uint32_t width, uint32_t height) const;
+		void _trim(Image& image) const;
+		bool _findPosition(const Page& page, uint32_t width, uint32_t height, Rect& best, bool& rotated) const;
+		void _place(Page& page, const Rect& rect);
+		bool _insertGroup(Page& page, const std::vector<uint32_t>& images);
+	};
+}
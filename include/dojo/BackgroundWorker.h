@@ -3,9 +3,10 @@
 #include "dojo_common_header.h"
 
 #include "SPSCQueue.h"
+#include "MPSCQueue.h"
 #include "AsyncJob.h"
-#include "Semaphore.h"
-#include "SpinLock.h"
+#include "AdaptiveMutex.h"
+#include "WorkerPool.h"
 
 namespace Dojo {
 	
@@ -20,6 +21,8 @@ namespace Dojo {
 		const bool allowMultipleProducers;
 
 		///Creates a new BackgroundWorker
+		/**
+		any thread can queue jobs in any worker; allowMultipleProducers makes the producers use a lock-free queue instead of taking turns on a lock */
 		explicit BackgroundWorker(bool async, bool allowMultipleProducers);
 		virtual ~BackgroundWorker();
 
@@ -47,16 +50,32 @@ namespace Dojo {
 
 		bool _runOneCallback();
 		bool _runAllCallbacks();
+
+#ifndef PUBLISH
+		///adds the jobs queued in this worker, the time spent queueing them and the time it took to wake up to stats
+		void _addStats(WorkerPool::Stats& stats) const;
+#endif
 	private:
 
 		std::atomic<bool> mRunning;
 		std::thread mThread;
-		Semaphore mAvailableTasksSemaphore;
+		///the worker thread sleeps on this when there are no tasks
+		EventCount mAvailableTasksEvent;
 
-		SpinLock mQueueLock;
+		///only one of the two queues exists: the lock-free MPSCQueue if allowMultipleProducers, or else a SPSCQueue whose producers take mQueueLock
 		std::unique_ptr<SPSCQueue<AsyncJob>> mQueue;
+		std::unique_ptr<MPSCQueue<AsyncJob>> mSharedQueue;
+		AdaptiveMutex mQueueLock;
 		std::unique_ptr<SPSCQueue<AsyncJob>> mCompletedQueue;
 
+#ifndef PUBLISH
+		std::atomic<uint64_t> mQueuedJobs = { 0 }, mQueueNanoseconds = { 0 };
+		std::atomic<uint64_t> mWakeups = { 0 }, mWakeNanoseconds = { 0 };
+		///when the last job was queued, in nanoseconds of the high_resolution_clock
+		std::atomic<int64_t> mLastQueueTime = { 0 };
+#endif
+
+		bool _tryDequeue(AsyncJob& job);
 		AsyncJob _waitForNextTask();
 
 	private:
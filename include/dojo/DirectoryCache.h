@@ -0,0 +1,66 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+namespace Dojo {
+	///DirectoryCache lists the files of each folder once, and then answers all the queries for that folder from memory
+	/**
+	The files of a folder are grouped by extension and their version and tag are parsed once.
+	The listing can be saved in a manifest and loaded at the next run, so that the folders in it are never scanned again;
+	shipped builds that include a complete manifest don't touch the file system to find their resources. */
+	class DirectoryCache {
+	public:
+		///lists all the files directly inside folder, appending their paths to out
+		typedef std::function<void(utf::string_view folder, std::vector<utf::string>& out)> Scanner;
+
+		struct File {
+			utf::string path;
+			///the result of Path::getVersion and Path::getTag on the file name
+			int version, tag;
+		};
+
+		struct Stats {
+			uint32_t scannedFolders = 0;
+			uint32_t scannedFiles = 0;
+			///the folders that were loaded from a manifest
+			uint32_t manifestFolders = 0;
+			uint32_t queries = 0;
+			///the time spent scanning and loading the manifest, in seconds
+			float scanTime = 0, manifestTime = 0;
+		};
+
+		explicit DirectoryCache(Scanner scanner);
+
+		///appends the files in folder with this extension, in the order in which the folder was scanned
+		void getFiles(utf::string_view folder, utf::string_view extension, std::vector<File>& out);
+
+		///loads the folders listed in a manifest
+		/**
+		\param root the folder that the paths of the files in the manifest are relative to
+		\returns false if the manifest doesn't exist or is not valid */
+		bool loadManifest(utf::string_view path, utf::string_view root);
+
+		///saves all the folders scanned so far in a manifest, the paths of their files must be inside root
+		bool saveManifest(utf::string_view path, utf::string_view root) const;
+
+		///forgets all the folders, so that they are scanned again
+		void clear();
+
+		Stats getStats() const;
+
+	private:
+		typedef std::unordered_map<std::string, std::vector<File>> FilesByExtension;
+
+		Scanner mScanner;
+
+		std::unordered_map<std::string, FilesByExtension> mFolders;
+		///the folders in the order in which they were scanned, to save the manifest in a stable order
+		std::vector<std::string> mFolderOrder;
+
+		Stats mStats;
+		mutable std::mutex mMutex;
+
+		FilesByExtension& _add(std::string folder);
+		static void _addFile(FilesByExtension& folder, utf::string path);
+	};
+}
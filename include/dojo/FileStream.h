@@ -3,6 +3,7 @@
 #include "dojo_common_header.h"
 
 #include "Stream.h"
+#include "vec_view.h"
 
 namespace Dojo {
 	///FileStream is an interface to read and write from files
@@ -34,6 +35,15 @@ namespace Dojo {
 		*/
 		virtual void close() = 0;
 
+		///returns the whole content if it's already in memory and can be used without reading it, otherwise an empty view
+		/**
+		\param owner receives an object that keeps the content alive after the stream is closed
+		\remark the FileStream must have been opened
+		*/
+		virtual vec_view<uint8_t> getContentInPlace(std::shared_ptr<const void>& owner) {
+			return{};
+		}
+
 	protected:
 
 		utf::string mPath;
@@ -3,6 +3,7 @@
 #include "dojo_common_header.h"
 
 #include "Platform.h"
+#include "MappedFile.h"
 
 namespace Dojo {
 	class FontSystem {
@@ -21,7 +22,7 @@ namespace Dojo {
 	private:
 
 		FaceMap faceMap;
-		std::vector<std::vector<uint8_t>> ownedBuffers;
+		std::vector<std::unique_ptr<MappedFile>> ownedFiles;
 
 		FT_Library freeType;
 
@@ -6,7 +6,21 @@ namespace Dojo {
 	class GlobalUniformData {
 	public:
 		Matrix view, projection, world, worldView, worldViewProjection;
-		Vector viewDirection, targetDimension;
+		Vector viewDirection, targetDimension, targetDimensionInv;
+		float time = 0;
+	};
+
+	///the std140 layout of the DojoFrame uniform block, updated once per frame
+	struct FrameUniformBlock {
+		float time;
+		float _padding[3];
 	};
-}
 
+	///the std140 layout of the DojoView uniform block, updated when the view or the projection change
+	struct ViewUniformBlock {
+		Matrix view, projection;
+		glm::vec4 viewDirection;
+		///xy is the size of the target in pixels, zw is the size of a pixel in UV space
+		glm::vec4 targetDimension;
+	};
+}
@@ -3,58 +3,143 @@
 #include "dojo_common_header.h"
 
 #include "LogEntry.h"
+#include "ring_buffer.h"
+#include "MPSCQueue.h"
+#include "AdaptiveMutex.h"
 
 namespace Dojo {
 	class LogListener;
 
 	///The Log class manages dojo's debug output and can redirect it to file, or it can be read from a console
+	/**
+	Appending to the Log never blocks: each thread pushes compact records in its own lock-free queue,
+	and a background thread formats them, keeps the last maxLines in a ring buffer and dispatches them to the LogListeners.
+	Listeners are therefore called from the Log thread, one record at a time and in order for each producer thread.
+	Errors are flushed synchronously, so that they are written out before a crash can swallow them. */
 	class Log {
 	public:
+		typedef ring_buffer<LogEntry> LogQueue;
 
-		typedef std::vector<LogEntry> LogQueue;
+		///the most numeric arguments that a formatted message can take
+		static const size_t MaxArgs = 6;
 
-		explicit Log(uint32_t maxLines = 1024) :
-			mMaxLines(maxLines) {
-			DEBUG_ASSERT( mMaxLines > 0, "Cannot create a Log with 0 or less lines" );
-		}
+		///the longest message that append stores without allocating
+		static const size_t InlineTextSize = 192;
 
-		~Log() {
-		}
+		explicit Log(uint32_t maxLines = 1024);
+
+		~Log();
 
 		///appends another message to the log, with an optional severity level
+		/**
+		messages up to InlineTextSize bytes are copied in the record itself, so that appending them doesn't allocate */
 		void append(utf::string_view message, LogEntry::Level level = LogEntry::EL_WARNING);
 
-		///adds a listener that will receive events from this Log
-		void addListener(LogListener& l) {
-			pListeners.emplace(&l);
+		///appends a message without formatting it on the calling thread
+		/**
+		\param format a string with static lifetime, each {} is replaced by the next argument on the Log thread
+		\param args up to MaxArgs numbers, the only thing that is copied in the record */
+		template <class... Args>
+		void appendFormat(LogEntry::Level level, const char* format, Args... args) {
+			static_assert(sizeof...(Args) <= MaxArgs, "Too many arguments for a log record");
+
+			Record record(level);
+			record.format = format;
+			_pushArgs(record, args...);
+			_push(std::move(record));
 		}
 
-		void removeListener(LogListener& l) {
-			pListeners.erase(&l);
-		}
+		///waits until everything appended so far has been dispatched to the listeners
+		void flush();
 
-		///returns the last appended entry
-		const LogEntry& getLastMessage() {
-			return mOutput.back();
-		}
+		///adds a listener that will receive events from this Log
+		void addListener(LogListener& l);
 
-		LogQueue::iterator begin() {
-			return mOutput.begin();
-		}
+		void removeListener(LogListener& l);
 
-		LogQueue::iterator end() {
-			return mOutput.end();
-		}
+		///returns a copy of the last dispatched entry
+		LogEntry getLastMessage();
+
+		///returns a copy of the last dispatched entries, from the oldest
+		std::vector<LogEntry> getHistory();
 
 	private:
+		struct Arg {
+			enum class Type : uint8_t {
+				Int,
+				UInt,
+				Float
+			} type;
+
+			union {
+				int64_t i;
+				uint64_t u;
+				double f;
+			};
+		};
+
+		struct Record {
+			LogEntry::Level level = LogEntry::EL_INFO;
+			time_t timestamp = 0;
+			///the static format string of appendFormat, null when inlineText or text contain the message
+			const char* format = nullptr;
+			uint8_t argCount = 0;
+			Arg args[MaxArgs];
+			uint16_t inlineLength = 0;
+			char inlineText[InlineTextSize];
+			///only used by the messages that don't fit in inlineText
+			utf::string text;
+			///set on the records pushed by flush()
+			Semaphore* flushed = nullptr;
+
+			Record() = default;
+
+			explicit Record(LogEntry::Level level) :
+				level(level),
+				timestamp(time(nullptr)) {
+
+			}
+		};
 
 		SmallSet<LogListener*> pListeners;
+		AdaptiveMutex mListenersMutex;
+
 		LogQueue mOutput;
-		uint32_t mMaxLines;
-		std::mutex mAppendMutex;
+		AdaptiveMutex mOutputMutex;
+
+		MPSCQueue<Record> mRecords;
+		EventCount mRecordsEvent;
+
+		std::atomic<bool> mRunning;
+		std::thread mThread;
+
+		void _push(Record&& record);
 
-		void _append(utf::string_view message, LogEntry::Level level);
+		void _run();
+		void _dispatch(Record& record);
 
-		void _fireOnLogUpdated(const LogEntry& e);
+		static utf::string _format(const Record& record);
+
+		void _pushArgs(Record&) {}
+
+		template <class T, class... Args>
+		void _pushArgs(Record& record, T arg, Args... args) {
+			static_assert(std::is_arithmetic<T>::value, "Log records can only store numbers");
+
+			auto& a = record.args[record.argCount++];
+			if (std::is_floating_point<T>::value) {
+				a.type = Arg::Type::Float;
+				a.f = static_cast<double>(arg);
+			}
+			else if (std::is_signed<T>::value) {
+				a.type = Arg::Type::Int;
+				a.i = static_cast<int64_t>(arg);
+			}
+			else {
+				a.type = Arg::Type::UInt;
+				a.u = static_cast<uint64_t>(arg);
+			}
+			_pushArgs(record, args...);
+		}
 	};
 }
@@ -23,6 +23,20 @@ namespace Dojo {
 			level(lvl) {
 			timestamp = time(nullptr);
 		}
+
+		LogEntry(utf::string_view msg, Level lvl, time_t time) :
+			timestamp(time),
+			text(msg.copy()),
+			level(lvl) {
+
+		}
+
+		LogEntry(utf::string&& msg, Level lvl, time_t time) :
+			timestamp(time),
+			text(std::move(msg)),
+			level(lvl) {
+
+		}
 	};
 
 }
@@ -3,31 +3,247 @@
 #include "dojo_common_header.h"
 
 #include "SPSCQueue.h"
-#include "SpinLock.h"
 
 namespace Dojo {
-	///A multi-producer single-consumer queue which is actually just a shim+spinlock over SPSCQueue.
-	//TODO actually implement without the spinlock?
+	///returns a new id for each queue that needs one, never reused
+	inline uint64_t _nextQueueID() {
+		static std::atomic<uint64_t> sNextID(1);
+		return sNextID.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	///a small per-thread cache from queue ids to the producer slots that thread uses in them
+	inline std::vector<std::pair<uint64_t, void*>>& _producerCache() {
+		static thread_local std::vector<std::pair<uint64_t, void*>> sCache;
+		return sCache;
+	}
+
+	///A lock-free unbounded multi-producer single-consumer queue
+	/**
+	Each producer thread gets its own SPSCQueue, registered the first time it enqueues in a lock-free list;
+	the consumer visits the producers round-robin, so the elements of each producer are dequeued in order,
+	but there is no ordering between different producers.
+	Enqueueing only takes a cached lookup and an SPSCQueue::enqueue, and producers never wait for each other. */
 	template <typename T, size_t MAX_BLOCK_SIZE = 512>
 	class MPSCQueue {
 	public:
-		MPSCQueue() {}
+		MPSCQueue() :
+			mID(_nextQueueID()) {
+
+		}
+
+		MPSCQueue(const MPSCQueue&) = delete;
+		MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+		~MPSCQueue() {
+			auto producer = mHead.load(std::memory_order_acquire);
+			while (producer) {
+				auto next = producer->next;
+				delete producer;
+				producer = next;
+			}
+		}
 
 		template <class... Args>
 		void enqueue(Args&& ... args) {
-			std::lock_guard<SpinLock> lock(mSpinLock);
-			mQueue.enqueue(std::forward<Args>(args)...);
+			_getProducer().queue.enqueue(std::forward<Args>(args)...);
 		}
 
 		template <typename U>
 		bool try_dequeue(U& result) {
-			return mQueue.try_dequeue(result);
+			auto head = mHead.load(std::memory_order_acquire);
+			if (not head) {
+				return false;
+			}
+
+			//start from where the last dequeue left off, so that no producer can starve the others
+			auto start = mNextProducer ? mNextProducer : head;
+			auto producer = start;
+			do {
+				auto next = producer->next ? producer->next : head;
+				if (producer->queue.try_dequeue(result)) {
+					mNextProducer = next;
+					return true;
+				}
+				producer = next;
+			} while (producer != start);
+
+			return false;
+		}
+
+		///dequeues up to max elements in out, returns how many were dequeued
+		template <typename OutputIt>
+		size_t try_dequeue_bulk(OutputIt out, size_t max) {
+			size_t count = 0;
+			for (auto producer = mHead.load(std::memory_order_acquire); producer and count < max; producer = producer->next) {
+				while (count < max and producer->queue.try_dequeue(*out)) {
+					++out;
+					++count;
+				}
+			}
+			return count;
+		}
+
+		///returns the number of threads that have enqueued in this queue
+		size_t getProducerCount() const {
+			size_t count = 0;
+			for (auto producer = mHead.load(std::memory_order_acquire); producer; producer = producer->next) {
+				++count;
+			}
+			return count;
 		}
 
 	private:
+		struct Producer {
+			SPSCQueue<T, MAX_BLOCK_SIZE> queue;
+			std::thread::id owner;
+			Producer* next = nullptr;
 
-		SpinLock mSpinLock;
-		SPSCQueue<T, MAX_BLOCK_SIZE> mQueue;
+			explicit Producer(std::thread::id owner) :
+				owner(owner) {
+
+			}
+		};
+
+		static const size_t MaxCachedQueues = 16;
+
+		const uint64_t mID;
+		std::atomic<Producer*> mHead = {};
+
+		//only used by the consumer
+		Producer* mNextProducer = nullptr;
+
+		Producer& _getProducer() {
+			auto& cache = _producerCache();
+			for (auto&& entry : cache) {
+				if (entry.first == mID) {
+					return *static_cast<Producer*>(entry.second);
+				}
+			}
+
+			//slow path: look for a slot that this thread already registered, or add a new one
+			auto thisThread = std::this_thread::get_id();
+			auto head = mHead.load(std::memory_order_acquire);
+			auto producer = head;
+			while (producer and producer->owner != thisThread) {
+				producer = producer->next;
+			}
+
+			if (not producer) {
+				producer = new Producer(thisThread);
+				producer->next = head;
+				while (not mHead.compare_exchange_weak(producer->next, producer, std::memory_order_release, std::memory_order_acquire));
+			}
+
+			//the cache only avoids the search; a thread that lost its entry finds its producer again
+			if (cache.size() >= MaxCachedQueues) {
+				cache.pop_back();
+			}
+			cache.emplace(cache.begin(), mID, producer);
+			return *producer;
+		}
 	};
-}
 
+	///A lock-free bounded multi-producer single-consumer queue, backed by a fixed ring buffer
+	/**
+	Each slot carries a sequence number that tells producers and the consumer whose turn it is to use it (D. Vyukov's design);
+	producers only contend on a single fetch position and never allocate. try_enqueue fails when the queue is full. */
+	template <typename T>
+	class BoundedMPSCQueue {
+	public:
+		///creates a queue holding up to capacity elements, rounded up to a power of two
+		explicit BoundedMPSCQueue(size_t capacity) :
+			mMask(_ceilToPow2(std::max(capacity, (size_t)2)) - 1),
+			mSlots(mMask + 1) {
+			for (size_t i = 0; i < mSlots.size(); ++i) {
+				mSlots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		BoundedMPSCQueue(const BoundedMPSCQueue&) = delete;
+		BoundedMPSCQueue& operator=(const BoundedMPSCQueue&) = delete;
+
+		~BoundedMPSCQueue() {
+			T discard;
+			while (try_dequeue(discard));
+		}
+
+		size_t getCapacity() const {
+			return mSlots.size();
+		}
+
+		template <class... Args>
+		bool try_enqueue(Args&& ... args) {
+			auto pos = mEnqueuePos.load(std::memory_order_relaxed);
+			Slot* slot;
+			while (true) {
+				slot = &mSlots[pos & mMask];
+				auto sequence = slot->sequence.load(std::memory_order_acquire);
+				auto diff = (intptr_t)sequence - (intptr_t)pos;
+
+				if (diff == 0) {
+					if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						break;
+					}
+				}
+				else if (diff < 0) {
+					return false; //full
+				}
+				else {
+					pos = mEnqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+
+			new (&slot->storage) T(std::forward<Args>(args)...);
+			slot->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		template <typename U>
+		bool try_dequeue(U& result) {
+			auto& slot = mSlots[mDequeuePos & mMask];
+			if (slot.sequence.load(std::memory_order_acquire) != mDequeuePos + 1) {
+				return false; //empty, or the producer hasn't finished writing
+			}
+
+			auto& element = *reinterpret_cast<T*>(&slot.storage);
+			result = std::move(element);
+			element.~T();
+
+			slot.sequence.store(mDequeuePos + mMask + 1, std::memory_order_release);
+			++mDequeuePos;
+			return true;
+		}
+
+		///dequeues up to max elements in out, returns how many were dequeued
+		template <typename OutputIt>
+		size_t try_dequeue_bulk(OutputIt out, size_t max) {
+			size_t count = 0;
+			while (count < max and try_dequeue(*out)) {
+				++out;
+				++count;
+			}
+			return count;
+		}
+
+	private:
+		struct Slot {
+			std::atomic<size_t> sequence;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		};
+
+		static size_t _ceilToPow2(size_t x) {
+			size_t p = 1;
+			while (p < x) {
+				p <<= 1;
+			}
+			return p;
+		}
+
+		const size_t mMask;
+		std::vector<Slot> mSlots;
+
+		//producers and the consumer work on different cache lines
+		alignas(64) std::atomic<size_t> mEnqueuePos = {};
+		alignas(64) size_t mDequeuePos = 0;
+	};
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "Timer.h"
+
+namespace Dojo {
+	///The MainThreadScheduler runs the asynchronous callbacks on the main thread within the time left in each frame
+	/**
+	Work comes either from sources, that are polled for one callback at a time (eg. the WorkerPools), or from callbacks scheduled directly.
+	Each priority class is drained before the next one; within a class, a callback only runs if the moving average of the cost
+	of its site fits in the time that is left, so that a heavy callback waits for a frame with enough room.
+	Sources name a site too, that is shared by all the work they run.
+	Urgent work always runs, and work that has been deferred for MaxDeferredFrames runs anyway so that nothing starves forever. */
+	class MainThreadScheduler {
+	public:
+		enum class Priority {
+			Urgent,
+			Normal,
+			Background
+		};
+
+		static const uint32_t PriorityCount = 3;
+
+		///the smallest budget given to a frame, doubled for each frame in a row that couldn't run all the work
+		static const float MinimumBudget;
+
+		static const uint32_t MaxDeferredFrames = 30;
+
+		struct Stats {
+			///the time given to the callbacks in the last frame and the time they used, in seconds
+			float budget = 0, used = 0;
+			uint32_t executed[PriorityCount] = {};
+			///callbacks and sources skipped in the last frame because they wouldn't fit in the budget
+			uint32_t deferred[PriorityCount] = {};
+			///the frames waited by the oldest scheduled callback of each priority
+			uint32_t maxWaitFrames[PriorityCount] = {};
+			///the frames in a row that ended with deferred work
+			uint32_t starvedFrames = 0;
+			uint32_t totalStarvedFrames = 0;
+		};
+
+		///runs one piece of work and returns false if there was nothing to run
+		typedef std::function<bool()> Source;
+
+		MainThreadScheduler() {}
+
+		MainThreadScheduler(const MainThreadScheduler&) = delete;
+		MainThreadScheduler& operator=(const MainThreadScheduler&) = delete;
+
+		///adds a source of work that is polled every frame; owner is only used to remove it
+		/**
+		\param site a static string naming the work of this source, as in schedule() */
+		void addSource(const void* owner, Priority priority, const char* site, Source source);
+
+		void removeSource(const void* owner);
+
+		///schedules a callback for the next run
+		/**
+		\param site a static string naming where the callback comes from, the callbacks of each site share a cost estimate */
+		void schedule(Priority priority, const char* site, AsyncCallback callback);
+
+		///runs callbacks until availableTime seconds are used or until there is nothing that fits
+		void run(float availableTime);
+
+		///returns the moving average of the cost of the callbacks of this site, in seconds
+		float getEstimatedCost(const char* site) const;
+
+		const Stats& getStats() const {
+			return mStats;
+		}
+
+	private:
+		struct Estimate {
+			float average = 0;
+			bool measured = false;
+
+			void add(float cost) {
+				average = measured ? average + (cost - average) * 0.25f : cost;
+				measured = true;
+			}
+		};
+
+		struct SourceEntry {
+			const void* owner;
+			Priority priority;
+			const char* site;
+			Source source;
+			///the last frame in which the source was polled
+			uint64_t lastPolledFrame = 0;
+			///the last frame in which the source was counted as deferred, so that each source counts once per frame
+			uint64_t lastDeferredFrame = 0;
+		};
+
+		struct Scheduled {
+			const char* site;
+			AsyncCallback callback;
+			uint64_t frame;
+		};
+
+		std::vector<SourceEntry> mSources;
+		std::deque<Scheduled> mScheduled[PriorityCount];
+		std::unordered_map<const char*, Estimate> mSiteCosts;
+
+		Stats mStats;
+		uint64_t mFrame = 0;
+		bool mRunning = false;
+
+		void _eraseRemovedSources();
+		void _runScheduled(Priority priority, float budget, const Timer& timer);
+		void _runSources(Priority priority, float budget, const Timer& timer);
+	};
+}
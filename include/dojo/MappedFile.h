@@ -0,0 +1,75 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "vec_view.h"
+
+namespace Dojo {
+	///A read-only view of the whole content of a file, that lives as long as the MappedFile
+	/**
+	On the platforms that support it the file is memory mapped, so the content is paged in by the OS on demand and never copied;
+	small files, and files that can't be mapped, are read in an owned buffer instead.
+	Files in archives use the content that the archive already has in memory when possible, eg. files stored uncompressed in a zip.
+	Loaders should consume getContent() directly rather than copying it into their own buffers. */
+	class MappedFile {
+	public:
+		enum class AccessHint {
+			///the content will be read once from start to end: read ahead aggressively and drop the pages early
+			Sequential,
+			///the content will be accessed in no particular order, eg. an archive
+			Random
+		};
+
+		///files smaller than this are read with a single buffered read, which is cheaper than setting up a mapping
+		static const size_t MinMappedSize = 64 * 1024;
+
+		explicit MappedFile(utf::string_view path, AccessHint hint = AccessHint::Sequential);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		///true if the file could be opened, even if it was empty
+		bool isOpen() const {
+			return mOpen;
+		}
+
+		///true if the content is memory mapped, or used in place from an archive, rather than read in a buffer
+		bool isMapped() const {
+			return mMapping != nullptr or mContentOwner != nullptr;
+		}
+
+		const uint8_t* data() const {
+			return mData;
+		}
+
+		size_t size() const {
+			return mSize;
+		}
+
+		vec_view<uint8_t> getContent() const {
+			return{ mData, mData + mSize };
+		}
+
+		///asks the OS to start reading a range of the file in memory, before it's accessed
+		void prefetch(size_t offset, size_t size) const;
+
+	private:
+		const uint8_t* mData = nullptr;
+		size_t mSize = 0;
+		bool mOpen = false;
+
+		void* mMapping = nullptr;
+#ifdef PLATFORM_WIN32
+		void* mFileHandle = nullptr;
+		void* mMappingHandle = nullptr;
+#endif
+
+		std::vector<uint8_t> mBuffer;
+		std::shared_ptr<const void> mContentOwner;
+
+		bool _map(utf::string_view path, AccessHint hint);
+		void _unmap();
+		bool _readBuffered(utf::string_view path);
+	};
+}
@@ -133,7 +133,12 @@ namespace Dojo {
 		void tangent(const Vector& n);
 
 		///appends a raw blob of vertices to the vertex array
-		void appendRawVertexData(void* data, IndexType vertexCount);
+		/**
+		\param bounds the bounds of the appended vertices, that are added to the bounds of the mesh */
+		void appendRawVertexData(const void* data, IndexType vertexCount, const AABB& bounds = AABB::Invalid);
+
+		///appends a raw blob of indices, that must have the index byte size of this mesh
+		void appendRawIndexData(const void* data, int count);
 
 		///adds one index
 		void index(IndexType idx);
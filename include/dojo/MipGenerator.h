@@ -0,0 +1,22 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+namespace Dojo {
+	///MipGenerator builds mip chains on the CPU for images that don't come with precomputed levels
+	class MipGenerator {
+	public:
+		///returns the number of levels in a full mip chain for an image of the given size
+		static uint32_t getLevelCount(uint32_t width, uint32_t height);
+
+		///returns the size of the given level of an image of the given size
+		static uint32_t getLevelSize(uint32_t size, uint32_t level) {
+			return std::max(size >> level, 1u);
+		}
+
+		///writes the next level of a RGBA8 image in dest using a 2x2 box filter
+		/**
+		dest has to be getLevelSize(srcWidth, 1) * getLevelSize(srcHeight, 1) * 4 bytes big */
+		static void downsampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dest);
+	};
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "FileStream.h"
+
+namespace Dojo {
+	class AssetPack;
+
+	///PackStream reads a file contained in an AssetPack
+	/**
+	The whole file is in memory when the stream is open: stored files point straight in the pack, compressed files are decompressed
+	in one go when they're opened, unless the pack already prefetched them. */
+	class PackStream : public FileStream {
+	public:
+
+		///creates a stream for the file at internalPath in the pack
+		/**
+		\param path the full path of the file, including the pack
+		\param pack the pack, kept alive by the stream */
+		PackStream(utf::string_view path, std::shared_ptr<AssetPack> pack, utf::string_view internalPath);
+		virtual ~PackStream();
+
+		///opens the file, it can only be read
+		virtual bool open(Access accessType) override;
+
+		virtual int64_t getSize() override;
+
+		virtual Access getAccess() override;
+
+		virtual int64_t getCurrentPosition() override;
+
+		virtual int seek(int64_t offset, int64_t fromWhere = SEEK_SET) override;
+
+		virtual int64_t read(uint8_t* buf, int64_t number) override;
+
+		virtual void close() override;
+
+		///creates a new PackStream to read the same file. Does not copy reading status
+		virtual std::unique_ptr<Stream> copy() const override;
+
+		virtual vec_view<uint8_t> getContentInPlace(std::shared_ptr<const void>& owner) override;
+
+	private:
+
+		std::shared_ptr<AssetPack> mPack;
+		utf::string mInternalPath;
+
+		vec_view<uint8_t> mContent;
+		std::shared_ptr<const void> mContentOwner;
+		int64_t mPosition = 0;
+
+		Access mAccess = Access::BadFile;
+	};
+}
@@ -12,6 +12,24 @@ namespace Dojo {
 		R_8,
 		RG_8,
 		A_8, //same as R_8, but counts as transparent
+
+		//block-compressed formats, only loadable from a precomputed TextureContainer
+		ETC2_RGB,
+		ETC2_RGBA,
+		ASTC_4x4,
+		ASTC_8x8,
+		BC1_RGB,
+		BC3_RGBA,
+		BC7_RGBA,
+
+		//the same block formats, holding sRGB encoded colors
+		ETC2_RGB_SRGB,
+		ETC2_RGBA_SRGB,
+		ASTC_4x4_SRGB,
+		ASTC_8x8_SRGB,
+		BC1_RGB_SRGB,
+		BC3_RGBA_SRGB,
+		BC7_RGBA_SRGB,
 		Unknown
 	};
 }
@@ -5,6 +5,8 @@
 #include "Log.h"
 #include "PixelFormat.h"
 #include "FrameSubmitter.h"
+#include "MainThreadScheduler.h"
+#include "DirectoryCache.h"
 
 namespace Dojo {
 	class SoundManager;
@@ -15,6 +17,8 @@ namespace Dojo {
 	class Email;
 	class ApplicationListener;
 	class FileStream;
+	class ZipIndex;
+	class AssetPack;
 	class WorkerPool;
 
 	///Platform is the base of the engine; it runs the main loop, creates the windows and updates the Game
@@ -84,6 +88,11 @@ namespace Dojo {
 			return *mPools[0]; //HACK
 		}
 
+		///returns the scheduler that runs the asynchronous callbacks on the main thread
+		MainThreadScheduler& getScheduler() {
+			return *mScheduler;
+		}
+
 		///returns "real frame time" or the time actually consumed by game computations in the last frame
 		/**
 		useful to evaluate performance when FPS are locked by the fixed run loop.
@@ -161,6 +170,9 @@ namespace Dojo {
 
 		virtual PixelFormat loadImageFile(std::vector<uint8_t>& imageData, utf::string_view path, uint32_t& width, uint32_t& height, int& pixelSize) = 0;
 
+		///writes a tightly packed RGBA8 image to path, in the format given by its extension
+		bool saveImageFile(utf::string_view path, const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height);
+
 		void addApplicationListener(ApplicationListener& f);
 
 		void removeApplicationListener(ApplicationListener& f);
@@ -201,7 +213,7 @@ namespace Dojo {
 		///creates a new FileStream object for the given path, but does not open it
 		std::unique_ptr<FileStream> getFile(utf::string_view path);
 
-		///loads the whole file allocating a new buffer
+		///loads the whole file allocating a new buffer; prefer a MappedFile to read a file without copying it
 		std::vector<uint8_t> loadFileContent(utf::string_view path);
 
 		///discovers all the files with an extension in a folder
@@ -210,6 +222,20 @@ namespace Dojo {
 		\param out vector where the results are appended*/
 		void getFilePathsForType(utf::string_view type, utf::string_view path, std::vector<utf::string>& out);
 
+		///like getFilePathsForType, but also returns the version and tag of each file
+		/**
+		Each folder is only listed once, or never if it's in the directory manifest */
+		void getFilesForType(utf::string_view type, utf::string_view path, std::vector<DirectoryCache::File>& out);
+
+		///saves all the folders listed so far in the directory manifest in the resources folder
+		/**
+		Call this after all the resources of the game have been found, and ship the manifest with the resources:
+		the folders in it will never be scanned again. The manifest needs to be saved again when the resources change. */
+		bool saveDirectoryManifest();
+
+		///if the folder is in an AssetPack, starts reading and decompressing all of its files on the background pool
+		void prefetchFolder(utf::string_view folder);
+
 		///loads the table found at absPath
 		/**if absPath is empty, the table file is loaded from $(Appdata)/$(GameName)/$(TableName).ds */
 		Table load(utf::string_view absPathOrName);
@@ -243,12 +269,13 @@ namespace Dojo {
 	protected:
 
 		typedef std::vector<utf::string> ZipExtensionList;
-		typedef std::vector<utf::string> PathList;
-		typedef std::map<utf::string, PathList, utf::str_less> ZipFoldersMap;
-		typedef std::map<utf::string, ZipFoldersMap, utf::str_less> ZipFileMapping;
+		typedef std::unordered_map<std::string, std::shared_ptr<const ZipIndex>> ZipIndexMap;
+		typedef std::unordered_map<std::string, std::shared_ptr<AssetPack>> AssetPackMap;
 
 		static std::unique_ptr<Platform> gSingletonPtr;
 
+		static const utf::string_view DirectoryManifestName;
+
 		uint32_t screenWidth, screenHeight, windowWidth, windowHeight;
 		Orientation screenOrientation;
 
@@ -270,13 +297,21 @@ namespace Dojo {
 		std::unique_ptr<Log> mLog;
 		std::unique_ptr<LogListener> mLogWriter;
 
+		std::unique_ptr<MainThreadScheduler> mScheduler;
 		std::vector<std::unique_ptr<WorkerPool>> mPools;
 		SmallSet<WorkerPool*> mAllPools;
 
 		SmallSet<ApplicationListener*> focusListeners;
 
-		///this "caches" the zip headers for faster access - each zip that has been opened has its paths cached here!
-		ZipFileMapping mZipFileMaps;
+		std::unique_ptr<DirectoryCache> mDirectoryCache;
+		///set once the manifest was loaded and the first folder scanned, which getFilesForType can race for
+		std::atomic<bool> mDirectoryManifestChecked = { false };
+		std::mutex mDirectoryManifestMutex;
+
+		///this "caches" the zip headers for faster access - each zip that has been opened is indexed once and shared here
+		ZipIndexMap mZipIndices;
+		AssetPackMap mAssetPacks;
+		std::mutex mArchivesMutex;
 		ZipExtensionList mZipExtensions;
 
 		utf::string _getTablePath(utf::string_view absPathOrName);
@@ -284,7 +319,21 @@ namespace Dojo {
 		///for each component in the path, check if a directory.zip file exists
 		utf::string _replaceFoldersWithExistingZips(utf::string_view absPath);
 
-		const ZipFoldersMap& _getZipFileMap(utf::string_view path, utf::string_view& zipPath, utf::string_view& remainder);
+		///lists all the files in a folder of the resources, or of a zip or pack that replaces it
+		void _scanFolder(utf::string_view path, std::vector<utf::string>& out);
+
+		utf::string _getDirectoryManifestPath();
+
+		void _logDirectoryStats();
+
+		///splits a path in the path of the innermost zip or pack and the path inside it
+		void _splitArchivePath(utf::string_view path, utf::string_view& archivePath, utf::string_view& remainder);
+
+		static bool _isAssetPack(utf::string_view archivePath);
+
+		///these open each archive once and can be called from any thread
+		std::shared_ptr<const ZipIndex> _getZipIndex(utf::string_view zipPath);
+		std::shared_ptr<AssetPack> _getAssetPack(utf::string_view packPath);
 
 		utf::string::const_iterator _findZipExtension(utf::string_view path);
 
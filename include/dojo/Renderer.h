@@ -24,6 +24,7 @@ namespace Dojo {
 	class Mesh;
 	class Game;
 	class FrameSubmitter;
+	class TextureStreamer;
 
 	class Renderer {
 	public:
@@ -89,10 +90,32 @@ namespace Dojo {
 			return frameBatchCount;
 		}
 
+		///returns how many glUniform calls were issued in the last frame
+		int getLastFrameUniformCount();
+
+		///returns how many uniform uploads were skipped in the last frame because the program already had the same value
+		int getLastFrameSkippedUniformCount();
+
 		bool isValid() {
 			return valid;
 		}
 
+		///GL_COMPLETION_STATUS_KHR, shared with the ARB version of the extension; the GL loader might not define it
+		static const uint32_t GLCompletionStatus = 0x91B1;
+
+		///true when the driver compiles and links shaders in the background, so that their completion can be polled with GLCompletionStatus
+		bool supportsParallelShaderCompile() const {
+			return mParallelShaderCompile;
+		}
+
+		///true if the GPU can sample textures stored in format; the uncompressed formats are always supported
+		bool supportsFormat(PixelFormat format) const;
+
+		///returns the streamer that manages the resolution of streamed Textures
+		TextureStreamer& getTextureStreamer() {
+			return *mTextureStreamer;
+		}
+
 		//renders all the layers and their contained Renderables in the given order
 		void renderFrame(float dt);
 
@@ -101,6 +124,9 @@ namespace Dojo {
 	private:
 
 		bool valid;
+		bool mParallelShaderCompile = false;
+		///the compressed GL internal formats that the driver can decode
+		std::vector<uint32_t> mCompressedFormats;
 
 		RenderSurface mBackBuffer;
 
@@ -119,10 +145,18 @@ namespace Dojo {
 
 		Matrix mRenderRotation;
 
+		std::unique_ptr<TextureStreamer> mTextureStreamer;
+
+		float mTime = 0;
+		uint32_t mFrameUniformBuffer = 0, mViewUniformBuffer = 0;
+		ViewUniformBlock mLastViewBlock = {};
+
 		void _updateRenderables(LayerList& layers, float dt);
 
 		///renders a single element using the given viewport
 		void _renderElement(const RenderLayer& layer, const RenderState& renderState);
+		void _notifyVisibleTextures(const RenderLayer& layer, const Viewport& viewport, const Renderable& renderable);
+		void _uploadViewUniforms();
 		void _renderLayer(Viewport& viewport, const RenderLayer& layer);
 		void _renderViewport(Viewport& viewport);
 
@@ -19,6 +19,7 @@
 #include "Shader.h"
 #include "ShaderProgram.h"
 #include "Log.h"
+#include "AtlasPacker.h"
 
 namespace Dojo {
 	///A ResourceGroup manages all of the Resources in Dojo
@@ -49,6 +50,15 @@ namespace Dojo {
 		//various resource properties TODO: refactor
 		bool disableBilinear, disableMipmaps, disableTiling, logchanges = true;
 
+		///textures are loaded at low resolution and streamed in by the Renderer's TextureStreamer when needed
+		bool streamTextures = false;
+
+		///the loose png and jpg images found by addSets are packed in shared atlas pages when loaded, so that they can be batched together
+		bool autoAtlas = false;
+
+		///how the auto atlas pages are packed; images bigger than half a page are left alone
+		AtlasPacker::Settings atlasSettings;
+
 		typedef std::map<utf::string, std::unique_ptr<FrameSet>, utf::str_less> FrameSetMap;
 		typedef std::map<utf::string, std::unique_ptr<Font>, utf::str_less> FontMap;
 		typedef std::map<utf::string, std::unique_ptr<Mesh>, utf::str_less> MeshMap;
@@ -58,6 +68,12 @@ namespace Dojo {
 		typedef std::map<utf::string, std::unique_ptr<ShaderProgram>, utf::str_less> ProgramMap;
 		typedef SmallSet<ResourceGroup*> SubgroupList;
 
+		///how a batch of Shaders was compiled
+		struct ShaderCompileReport {
+			int programs = 0, shaders = 0, cachedShaders = 0, failed = 0;
+			double seconds = 0;
+		};
+
 		///Create a new empty ResourceGroup
 		ResourceGroup();
 
@@ -206,6 +222,14 @@ namespace Dojo {
 		///unloads re-loadable resources without actually destroying resource objects
 		void softUnloadResources(bool recursive = false);
 
+		///compiles and links all the Shaders and ShaderPrograms that aren't loaded yet, and waits until their binaries are in the shader cache
+		/**
+		this can run at install time or on the first boot, so that the following loads only read the cache */
+		ShaderCompileReport precompileShaders(bool recursive = false);
+
+		///returns the bytes of VRAM used by the textures loaded by this group
+		int64_t getTextureMemory(bool recursive = false) const;
+
 		FrameSetMap::const_iterator getFrameSets() const {
 			return frameSets.begin();
 		}
@@ -233,6 +257,19 @@ namespace Dojo {
 
 		SubgroupList subs;
 
+		std::vector<Texture*> mAtlasTiles, mPendingAtlasTiles;
+		std::vector<std::unique_ptr<Texture>> mAtlasPages;
+
+		///packs the pending auto atlas tiles in new pages
+		void _packAtlas();
+		void _removeFromAtlas(FrameSet& set);
+
+		///decodes all the unloaded sounds in parallel, so that loading them only uploads the data
+		void _decodeSounds();
+
+		///submits all the unloaded programs and shaders to the driver together, then finishes them as they complete
+		ShaderCompileReport _compileShaders();
+
 		///load all unloaded registered resources
 		template <class T>
 		void _load(std::map<utf::string, std::unique_ptr<T>, utf::str_less>& map) {
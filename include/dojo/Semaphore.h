@@ -3,17 +3,38 @@
 #include "dojo_common_header.h"
 
 namespace Dojo {
+	///A lightweight counting semaphore
+	/**
+	the count lives in an atomic, so wait() and notify() cost a single atomic operation while the semaphore isn't contended;
+	a waiter spins for a little while before parking on a condition variable, and notify() only touches the condition variable
+	when someone is actually parked. */
 	class Semaphore {
 	public:
-		Semaphore(uint32_t initialCount);
+		explicit Semaphore(uint32_t initialCount);
+		Semaphore(const Semaphore&) = delete;
 		Semaphore& operator=(const Semaphore&) = delete;
 
 		void wait();
-		void notifyOne();
+
+		///decrements the count if it is positive, never blocks
+		bool tryWait();
+
+		void notifyOne() {
+			notify(1);
+		}
+
+		void notify(uint32_t count);
 
 	private:
-		std::mutex mConditionMutex;
-		std::atomic<uint32_t> mCount;
+		///positive: available count; negative: number of parked waiters
+		std::atomic<int32_t> mCount;
+
+		std::mutex mMutex;
 		std::condition_variable mCondition;
+		///wakeups handed to the parked threads, protected by mMutex so that none can be lost
+		uint32_t mWakeups = 0;
+
+		void _park();
+		void _unpark(uint32_t count);
 	};
-}
\ No newline at end of file
+}
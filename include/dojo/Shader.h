@@ -17,6 +17,14 @@ namespace Dojo {
 	///A Shader is an object representing a VSH+PSH couple and its attributes.
 	/**
 	Each Renderable, at any moment, uses exactly one Shader, whether loaded from file (.dsh) or procedurally generated to fake the FF
+
+	Programs using #version 140 or later can read the per-frame and per-view built-ins from uniform blocks shared by all Shaders,
+	which the Renderer updates once per frame and once per viewport instead of once per draw:
+
+		layout(std140) uniform DojoFrame { float TIME; };
+		layout(std140) uniform DojoView { mat4 VIEW; mat4 PROJECTION; vec3 VIEW_DIRECTION; vec4 TARGET_DIMENSION; };
+
+	where TARGET_DIMENSION.zw is TARGET_DIMENSION_INV. The other uniforms are only uploaded when their value changes.
 	*/
 	class Shader : public Resource {
 	public:
@@ -71,6 +79,17 @@ namespace Dojo {
 			}
 		};
 
+		///the binding points of the shared uniform blocks
+		static const uint32_t FrameBlockBinding = 0, ViewBlockBinding = 1;
+
+		///counts the uniform uploads issued and skipped because the program already had the same value
+		struct UniformStats {
+			int issued = 0, skipped = 0;
+		};
+
+		///the uniform stats of all the Shaders, reset by the Renderer each frame
+		static UniformStats sUniformStats;
+
 		///Creates a new Shader from a file path
 		Shader(optional_ref<ResourceGroup> creator, utf::string_view filePath);
 
@@ -102,6 +121,20 @@ namespace Dojo {
 
 		virtual void onUnload(bool soft = false);
 
+		///true if the last load used a program binary from the shader cache instead of compiling
+		bool isLoadedFromCache() const {
+			return mLoadedFromCache;
+		}
+
+		///internal - loads the program from the cache or submits it for linking, without waiting for the driver
+		bool _beginLoad();
+
+		///internal - true if _endLoad can be called without blocking; always true if the driver can't link in parallel
+		bool _isLinkComplete() const;
+
+		///internal - waits for the link started by _beginLoad, stores the binary in the cache and reads the uniforms
+		bool _endLoad();
+
 	private:
 		struct Binary {
 			std::string bytes;
@@ -124,6 +157,10 @@ namespace Dojo {
 
 			std::string name;
 
+			///a copy of the last value uploaded to the program, to skip redundant uploads
+			std::vector<uint8_t> lastValue;
+			bool uploaded = false;
+
 			Uniform() {
 
 			}
@@ -133,7 +170,8 @@ namespace Dojo {
 				count(elementCount),
 				type(ty),
 				builtInUniform(biu),
-				name(name) {
+				name(name),
+				lastValue(_getTypeByteSize(ty) * elementCount) {
 				DEBUG_ASSERT( location >= 0, "Invalid Uniform location" );
 				DEBUG_ASSERT( count > 0, "Invalid element count" );
 				DEBUG_ASSERT(name.size() > 0, "Invalid uniform name");
@@ -150,6 +188,7 @@ namespace Dojo {
 		static void _populateAttributeNameMap();
 
 		static BuiltInUniform _getUniformForName(const std::string& name);
+		static uint32_t _getTypeByteSize(uint32_t glType);
 		static VertexField _getAttributeForName(const std::string& name);
 
 		std::string mPreprocessorHeader;
@@ -159,6 +198,9 @@ namespace Dojo {
 
 		uint32_t mGLProgram;
 
+		bool mLinking = false, mLoadedFromCache = false;
+		utf::string mCachedBinaryPath;
+
 		optional_ref<ShaderProgram> pProgram[ (uint8_t)ShaderProgramType::_Count ];
 		std::vector<std::unique_ptr<ShaderProgram>> mOwnedPrograms;
 
@@ -166,7 +208,7 @@ namespace Dojo {
 
 		const void* _getUniformData(const GlobalUniformData& currentState, const Uniform& uniform, const RenderState& user);
 
-		Binary _getCachedBinary(utf::string_view path);
+		void _bindUniformBlock(const char* name, uint32_t byteSize, uint32_t binding);
 
 		void _storeCachedBinary(utf::string_view path, const Shader::Binary& binary) const;
 	private:
@@ -39,13 +39,28 @@ namespace Dojo {
 		virtual bool onLoad();
 		virtual void onUnload(bool soft = false);
 
+		///true between _beginLoad and _endLoad
+		bool isCompiling() const {
+			return mCompiling;
+		}
+
+		///internal - reads the source and submits it to the driver without waiting for the compilation to end
+		bool _beginLoad();
+
+		///internal - true if _endLoad can be called without blocking; always true if the driver can't compile in parallel
+		bool _isCompileComplete() const;
+
+		///internal - waits for the compilation started by _beginLoad and returns if it succeeded
+		bool _endLoad();
+
 	private:
 
 		std::string mContentString;
 
 		ShaderProgramType mType;
 		uint32_t mGLShader;
+		bool mCompiling = false;
 
-		bool _load();
+		bool _compile();
 	};
 }
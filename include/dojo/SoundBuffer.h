@@ -3,6 +3,7 @@
 #include "dojo_common_header.h"
 
 #include "Resource.h"
+#include "SoundDecoder.h"
 
 namespace Dojo {
 	class Stream;
@@ -49,7 +50,12 @@ namespace Dojo {
 			///loads in the default background queue
 			void loadAsync();
 
-			///loads the chunk asynchronously
+			///gives the chunk its already decoded PCM, so that loading it only needs to upload it
+			void setDecoded(SoundDecoder::PCMPtr pcm) {
+				mDecoded = std::move(pcm);
+			}
+
+			///decodes the chunk through the SoundDecoder cache and uploads it
 			virtual bool onLoad() override;
 
 			virtual void onUnload(bool soft = false) override;
@@ -62,8 +68,13 @@ namespace Dojo {
 			uint32_t size;
 			uint32_t alBuffer;
 			std::atomic<int> references;
+
+			SoundDecoder::PCMPtr mDecoded;
 		};
 
+		///sounds bigger than this in PCM are streamed in Chunks, smaller sounds are loaded whole
+		static const int MAX_UNSTREAMED_SIZE = Chunk::MAX_SIZE * 8;
+
 		typedef std::vector<std::unique_ptr<Chunk>> ChunkList;
 
 		///Creates a new file-loaded SoundBuffer in the given resourcegroup, for the given file path
@@ -71,6 +82,12 @@ namespace Dojo {
 
 		~SoundBuffer();
 
+		///reads the layout of the file and decodes it, or the first Chunk of a stream, without creating any OpenAL buffer
+		/**
+		This can be called on any thread before onLoad, which then only needs to upload the decoded data.
+		ResourceGroups use it to decode all of their sounds in parallel. */
+		void predecode();
+
 		virtual bool onLoad() override;
 		virtual void onUnload(bool soft = false) override;
 
@@ -117,7 +134,9 @@ namespace Dojo {
 		optional_ref<Stream> mSource;
 		std::unique_ptr<FileStream> mFile; //this unique ptr keeps ownership of the file accessor when the src is a file
 
-		bool _loadOgg(Stream& source);
-		bool _loadOggFromFile();
+		std::vector<SoundDecoder::Span> mSpans;
+		SoundDecoder::PCMPtr mFirstChunk;
+
+		utf::string _getCacheKey(int64_t startPosition) const;
 	};
 }
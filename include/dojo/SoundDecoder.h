@@ -0,0 +1,92 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include <list>
+
+namespace Dojo {
+	class Stream;
+
+	///SoundDecoder decodes Ogg Vorbis streams to 16 bit PCM, and keeps the most recently decoded chunks in a cache of bounded size
+	/**
+	The cache is shared by all the SoundBuffers, so replaying the chunks of a looping stream or the variants of a SoundSet
+	doesn't decode them again as long as they fit in the cache. decode() can be called on any thread. */
+	class SoundDecoder {
+	public:
+		///a decoded chunk of sound
+		struct PCM {
+			std::vector<char> samples;
+			int channels = 0;
+			int rate = 0;
+		};
+
+		typedef std::shared_ptr<const PCM> PCMPtr;
+
+		///a part of an Ogg stream that can be decoded on its own
+		struct Span {
+			///the position of the first page in the compressed stream
+			int64_t startPosition;
+			///the size of the span once decoded
+			int64_t size;
+		};
+
+		struct Stats {
+			uint32_t hits = 0, misses = 0;
+			int64_t decodedBytes = 0;
+			///the time spent decoding, in seconds
+			float decodeTime = 0;
+		};
+
+		///splits the stream in the Spans that can be decoded separately
+		/**
+		Streams up to maxSingleSize bytes of PCM are a single Span, bigger ones are split in Spans of about spanSize bytes.
+		\param duration returns the duration of the stream in seconds
+		\returns false if the stream is not a valid Ogg Vorbis stream */
+		static bool readLayout(Stream& source, int64_t maxSingleSize, int64_t spanSize, std::vector<Span>& out, float& duration);
+
+		///creates a decoder that caches up to cacheSize bytes of PCM
+		explicit SoundDecoder(int64_t cacheSize);
+
+		///returns the PCM of a span of the stream, decoding it if it's not in the cache
+		/**
+		\param source an unopened stream, that is opened and closed by the decoder
+		\param key identifies the span in the cache
+		\returns nullptr if the span could not be decoded */
+		PCMPtr decode(Stream& source, utf::string_view key, const Span& span);
+
+		///sets the maximum amount of PCM bytes kept in the cache, evicting the least recently used chunks if needed
+		void setCacheSize(int64_t bytes);
+
+		int64_t getCacheSize() const;
+
+		///returns how many bytes of PCM are currently cached
+		int64_t getCachedBytes() const;
+
+		///empties the cache; the chunks still in use stay alive until they are released
+		void clear();
+
+		Stats getStats() const;
+
+	private:
+		typedef std::list<std::string> UseList;
+
+		struct CacheEntry {
+			PCMPtr pcm;
+			UseList::iterator use;
+		};
+
+		int64_t mCacheSize;
+		int64_t mCachedBytes = 0;
+
+		///the cached keys from the most to the least recently used
+		UseList mUses;
+		std::unordered_map<std::string, CacheEntry> mCache;
+
+		Stats mStats;
+		mutable std::mutex mMutex;
+
+		static PCMPtr _decode(Stream& source, const Span& span);
+
+		void _trim();
+	};
+}
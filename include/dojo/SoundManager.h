@@ -6,6 +6,7 @@
 
 #include "SoundSet.h"
 #include "SoundSource.h"
+#include "SoundDecoder.h"
 
 #define NUM_SOURCES_MIN 16
 #define NUM_SOURCES_MAX 256
@@ -28,6 +29,11 @@ namespace Dojo {
 		static const Easing LinearEasing;
 		static const float m;
 
+		///how many chunks streaming sources keep loaded ahead of the one playing, unless changed with setStreamReadAhead
+		static const int DefaultStreamReadAhead = 2;
+		///the default size of the decoded sound cache in MB
+		static const int DefaultDecodedCacheSize = 16;
+
 		SoundManager();
 
 		~SoundManager();
@@ -88,6 +94,28 @@ namespace Dojo {
 			return busySoundPool;
 		}
 
+		///sets how many chunks streaming sources load ahead of the one playing
+		/**
+		More chunks make streams resistant to longer hitches of the main thread, at the cost of memory.
+		It can also be set with the sound_read_ahead key in the user configuration. */
+		void setStreamReadAhead(int chunks);
+
+		int getStreamReadAhead() const {
+			return mStreamReadAhead;
+		}
+
+		///returns the decoder used by all SoundBuffers, that caches the decoded PCM
+		/**
+		The cache size can be set in MB with the sound_cache_MB key in the user configuration. */
+		SoundDecoder& getDecoder() {
+			return *mDecoder;
+		}
+
+		///returns how many times the sources that have already finished playing ran out of decoded data
+		uint32_t getFinishedUnderrunCount() const {
+			return mFinishedUnderruns;
+		}
+
 		///true if the music is fading
 		bool isMusicFading() {
 			return fadeState != FS_NONE;
@@ -131,6 +159,10 @@ namespace Dojo {
 		float musicVolume;
 		float masterVolume;
 
+		std::unique_ptr<SoundDecoder> mDecoder;
+		int mStreamReadAhead = DefaultStreamReadAhead;
+		uint32_t mFinishedUnderruns = 0;
+
 		///sets the openAL Listener's world transform
 		void _setListenerTransform(const Matrix& worldTransform);
 	};
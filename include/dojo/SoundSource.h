@@ -2,6 +2,8 @@
 
 #include "dojo_common_header.h"
 
+#include <deque>
+
 #include "Vector.h"
 #include "SoundBuffer.h"
 
@@ -93,6 +95,11 @@ namespace Dojo {
 		///returns the elapsed time since source play
 		float getElapsedTime();
 
+		///returns how many times this streaming source played all of its queued chunks before the next one was loaded
+		uint32_t getUnderrunCount() const {
+			return mUnderruns;
+		}
+
 		///is this a dummy sound?
 		bool isValid() {
 			return source != 0;
@@ -120,7 +127,7 @@ namespace Dojo {
 
 	private:
 
-		typedef std::queue<SoundBuffer::Chunk*> ChunkQueue;
+		typedef std::deque<SoundBuffer::Chunk*> ChunkQueue;
 
 		Vector position, lastPosition;
 		bool positionChanged;
@@ -131,13 +138,21 @@ namespace Dojo {
 		uint32_t source;
 		int playState;
 
-		size_t mCurrentChunkID, mQueuedChunks;
-		optional_ref<SoundBuffer::Chunk> mFrontChunk, mBackChunk;
+		///the chunks referenced by this source, in playing order; the first mQueuedChunks are queued in OpenAL, the others are loading
+		ChunkQueue mChunks;
+		size_t mQueuedChunks, mNextChunkID;
+		uint32_t mUnderruns;
+		bool mStarved;
 
 		SoundState state;
 
 		//params
 		bool looping, autoRemove;
 		float baseVolume, pitch;
+
+		///references the next chunks up to the read ahead depth and queues the ones that are loaded
+		void _fillQueue();
+
+		void _releaseChunks();
 	};
 }
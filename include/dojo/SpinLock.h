@@ -2,23 +2,74 @@
 
 #include "dojo_common_header.h"
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#include <immintrin.h>
+#endif
+
 namespace Dojo {
-	class SpinLock {
+	///tells the CPU that this is a busy-wait loop, so that it can save power and let the other hyperthread run
+	inline void cpuRelax() {
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+		_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		asm volatile("yield");
+#endif
+	}
+
+	///Exponential backoff for busy-wait loops
+	/**
+	each pause() waits twice as many cpuRelax as the previous one; once the spin budget is over it yields the thread instead.
+	Primitives that can block use isSpinning() to decide when to stop spinning and park the thread. */
+	class Backoff {
 	public:
-		SpinLock() {
-			mLock.clear(std::memory_order_release);
+		static const uint32_t MaxSpinExponent = 6;
+
+		void pause() {
+			if (mStep <= MaxSpinExponent) {
+				for (uint32_t i = 0; i < (1u << mStep); ++i) {
+					cpuRelax();
+				}
+				++mStep;
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+
+		bool isSpinning() const {
+			return mStep <= MaxSpinExponent;
+		}
+
+		void reset() {
+			mStep = 0;
 		}
 
+	private:
+		uint32_t mStep = 0;
+	};
+
+	///A lock that never sleeps, for very short critical sections
+	class SpinLock {
+	public:
 		void lock() {
-			while (mLock.test_and_set(std::memory_order_acquire)); //spin
+			Backoff backoff;
+			while (mLock.exchange(true, std::memory_order_acquire)) {
+				//wait on a plain load, so that the cache line isn't bounced between the cores
+				do {
+					backoff.pause();
+				} while (mLock.load(std::memory_order_relaxed));
+			}
+		}
+
+		bool try_lock() {
+			return not mLock.load(std::memory_order_relaxed) and not mLock.exchange(true, std::memory_order_acquire);
 		}
 
 		void unlock() {
-			mLock.clear(std::memory_order_release);
+			mLock.store(false, std::memory_order_release);
 		}
 
 	private:
-		std::atomic_flag mLock;
+		std::atomic<bool> mLock = { false };
 	};
 }
-
@@ -14,10 +14,27 @@ namespace Dojo {
 
 		bool hasAlpha;
 
+		///size in pixels of a compression block, 1x1 for uncompressed formats
+		uint32_t blockWidth, blockHeight;
+		///size in bytes of a compression block, 0 for uncompressed formats
+		uint32_t blockByteSize;
+
 		static const TexFormatInfo& getFor(PixelFormat format);
 
+		bool isCompressed() const {
+			return blockByteSize > 0;
+		}
+
 		bool isGPUFormat() const {
-			return glm::isPowerOfTwo(internalPixelSize);
+			return isCompressed() or glm::isPowerOfTwo(internalPixelSize);
+		}
+
+		///returns the bytes needed in VRAM by an image of the given size in this format
+		uint32_t getByteSizeFor(uint32_t width, uint32_t height) const {
+			if (isCompressed()) {
+				return ((width + blockWidth - 1) / blockWidth) * ((height + blockHeight - 1) / blockHeight) * blockByteSize;
+			}
+			return width * height * internalPixelSize;
 		}
 	};
 
@@ -15,6 +15,7 @@
 #include "Vector.h"
 #include "PixelFormat.h"
 #include "RenderSurface.h"
+#include "TextureStreamer.h"
 
 namespace Dojo {
 	class Mesh;
@@ -25,6 +26,22 @@ namespace Dojo {
 		public RenderSurface,
 		public Resource {
 	public:
+		///the levels of an image, as read by _readLevels
+		struct LevelData {
+			uint32_t width = 0, height = 0;
+			PixelFormat format = PixelFormat::Unknown;
+			bool transparency = false;
+			uint32_t levelCount = 0, firstLevel = 0;
+			///the data of the levels from firstLevel to the end of the chain
+			std::vector<std::vector<uint8_t>> levels;
+		};
+
+		///chooses the first level to read given the size and the level count of an image
+		typedef std::function<uint32_t(uint32_t width, uint32_t height, uint32_t levelCount)> FirstLevelSelector;
+
+		///internal - reads the mip chain of the image at path, starting from the level chosen by firstLevelFor; can be called from any thread
+		static bool _readLevels(utf::string_view path, const FirstLevelSelector& firstLevelFor, LevelData& out);
+
 		///Create a empty new texture
 		Texture(optional_ref<ResourceGroup> creator = {});
 
@@ -37,16 +54,38 @@ namespace Dojo {
 		bool loadEmpty(uint32_t width, uint32_t height, PixelFormat destFormat);
 
 		///loads the texture from a memory area with RGBA8 format
-		bool loadFromMemory(const uint8_t* imageData, uint32_t width, uint32_t height, PixelFormat sourceFormat);
+		/**
+		\param generateMipmaps builds the full mip chain on the CPU after uploading the image */
+		bool loadFromMemory(const uint8_t* imageData, uint32_t width, uint32_t height, PixelFormat sourceFormat, bool generateMipmaps = false);
+
+		///loads the texture and all its precomputed mip levels from the content of a .dtex TextureContainer
+		bool loadFromContainer(vec_view<uint8_t> containerData);
 
 		///loads the texture from the image pointed by the filename
 		bool loadFromFile(utf::string_view path);
 
+		///the area of an image in a Texture Atlas
+		struct AtlasTile {
+			///the position in the atlas and the size of the stored image, before any rotation
+			int x = 0, y = 0, width = 0, height = 0;
+			///the image is stored rotated 90 degrees clockwise, occupying a height * width rect
+			bool rotated = false;
+			///the position of the stored image in the original one, when its transparent borders were trimmed
+			int trimX = 0, trimY = 0;
+			///the size of the original image; 0 means not trimmed
+			int originalWidth = 0, originalHeight = 0;
+		};
+
 		///loads the texture from the given area in a Texture Atlas, without duplicating data
 		/**
 		a texture of this kind is loaded via an .atlasinfo and doesn't use VRAM in itself */
 		bool loadFromAtlas(Texture& tex, int x, int y, int sx, int sy);
 
+		///loads the texture from a possibly trimmed and rotated tile of a Texture Atlas
+		/**
+		the texture keeps the size of the original image, and its optimal billboard only covers the trimmed area */
+		bool loadFromAtlas(Texture& tex, const AtlasTile& tile);
+
 		///loads the texture with the given parameters
 		virtual bool onLoad();
 
@@ -87,6 +126,16 @@ namespace Dojo {
 		uint32_t getInternalHeight()  const {
 			return internalHeight;
 		}
+
+		///returns how many mip levels are allocated for this texture
+		uint32_t getMipLevelCount() const {
+			return mMipLevels;
+		}
+
+		///returns the biggest mip level currently on the GPU; it's only different from 0 for streamed textures
+		uint32_t getResidentLevel() const {
+			return mResidentLevel;
+		}
 		
 		///Returns a parent atlas Texture if this texture is a "fake" tile atlas
 		optional_ref<Texture> getParentAtlas() {
@@ -121,15 +170,33 @@ namespace Dojo {
 
 		void _addAsAttachment(uint32_t index, uint32_t width, uint32_t height, uint8_t miplevel);
 
+		///internal - sets the size and format of a texture whose levels are managed by a TextureStreamer
+		void _setupStreamed(const LevelData& data, TextureStreamer::Entry& entry);
+
+		///internal - replaces the GPU storage with the given levels, from firstLevel to the end of the chain
+		void _uploadLevels(uint32_t firstLevel, const std::vector<std::vector<uint8_t>>& levels);
+
+		optional_ref<TextureStreamer::Entry> _getStreamingEntry() const {
+			return mStreamingEntry;
+		}
+
+		void _clearStreamingEntry() {
+			mStreamingEntry = {};
+		}
+
 	private:
 
 		bool mTransparency = false;
 		uint32_t internalWidth, internalHeight;
+		uint32_t mMipLevels = 1;
+		uint32_t mResidentLevel = 0;
+		bool mBilinear = true, mTiling = true;
+		optional_ref<TextureStreamer::Entry> mStreamingEntry;
 		Vector UVSize, UVOffset;
 
 		optional_ref<Texture> parentAtlas;
 		optional_ref<FrameSet> ownerFrameSet;
-		int mAtlasOriginX, mAtlasOriginY;
+		AtlasTile mAtlasTile;
 
 		std::unique_ptr<Mesh> OBB;
 
@@ -141,6 +208,8 @@ namespace Dojo {
 		void _rebuildOptimalBillboard();
 
 		bool _setupAtlas();
-		bool _createStorage(uint32_t w, uint32_t h, PixelFormat formatID);
+		bool _createStorage(uint32_t w, uint32_t h, PixelFormat formatID, uint32_t levels = 1);
+		void _setupSampling();
+		void _applySamplingState();
 	};
 }
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "PixelFormat.h"
+
+namespace Dojo {
+	///TextureContainer reads .dtex files, GPU-ready images that store a precomputed mip chain
+	/**
+	The layout is a fixed Header followed by levelCount LevelEntries, then the level data.
+	Each level is stored exactly as glCompressedTexSubImage2D (or glTexSubImage2D) expects it, so loading doesn't decode anything.
+	The container doesn't own its memory: the views it returns point into the buffer it was parsed from.
+	.dtex files are created offline by make_dtex.py */
+	class TextureContainer {
+	public:
+		static const utf::string_view Extension;
+		static const uint32_t Version = 1;
+
+		struct Header {
+			char magic[4]; //"DTEX"
+			uint32_t version;
+			uint32_t format; //a PixelFormat
+			uint32_t width, height;
+			uint32_t levelCount;
+			uint32_t flags;
+			uint32_t reserved;
+		};
+
+		struct LevelEntry {
+			uint64_t byteOffset, byteSize;
+		};
+
+		enum Flags {
+			///the image has alpha values that aren't fully opaque
+			FLAG_TRANSPARENT = 1 << 0,
+		};
+
+		struct Level {
+			uint32_t width, height;
+			vec_view<uint8_t> data;
+		};
+
+		///parses the container in data; returns false if the data isn't a valid container
+		bool parse(vec_view<uint8_t> data);
+
+		PixelFormat getFormat() const {
+			return mFormat;
+		}
+
+		uint32_t getWidth() const {
+			return mWidth;
+		}
+
+		uint32_t getHeight() const {
+			return mHeight;
+		}
+
+		bool hasTransparency() const {
+			return mTransparent;
+		}
+
+		const std::vector<Level>& getLevels() const {
+			return mLevels;
+		}
+
+	private:
+		PixelFormat mFormat = PixelFormat::Unknown;
+		uint32_t mWidth = 0, mHeight = 0;
+		bool mTransparent = false;
+		std::vector<Level> mLevels;
+	};
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "Vector.h"
+
+namespace Dojo {
+	class Texture;
+
+	///TextureStreamer keeps only the low mips of streamed Textures resident, and loads higher mips when they're needed on screen
+	/**
+	Textures are streamed when their ResourceGroup has streamTextures set.
+	The Renderer reports the on-screen size of each visible Texture, and at the end of each frame the streamer
+	requests the levels that match it; levels are read and decoded on the background WorkerPool and uploaded on the main thread.
+	When loading a level would exceed the budget, the least recently seen Textures are dropped back to their base level. */
+	class TextureStreamer {
+	public:
+		///the streaming state of a single Texture
+		struct Entry {
+			Texture& texture;
+			uint32_t levelCount;
+			///the smallest level, always resident
+			uint32_t baseLevel;
+			///the biggest level currently on the GPU
+			uint32_t residentLevel;
+			///the biggest level the Renderer asked for this frame
+			uint32_t requestedLevel;
+			uint64_t lastSeenFrame = 0;
+			bool loading = false;
+			///a CPU copy of the levels from baseLevel on, to evict without reading the file again
+			std::vector<std::vector<uint8_t>> baseLevels;
+
+			Entry(Texture& texture) :
+				texture(texture) {
+
+			}
+		};
+
+		///the biggest side a base level can have
+		static const uint32_t DefaultBaseLevelSize = 64;
+		///how many level loads can be in flight at the same time
+		static const uint32_t MaxLoadsInFlight = 4;
+
+		///creates a streamer with the given budget in bytes; 0 means no budget
+		explicit TextureStreamer(int64_t budget);
+
+		~TextureStreamer();
+
+		///sets how many bytes of VRAM the streamed textures can use; 0 means no budget
+		void setBudget(int64_t bytes) {
+			mBudget = bytes;
+		}
+
+		int64_t getBudget() const {
+			return mBudget;
+		}
+
+		///returns the VRAM currently used by streamed textures
+		int64_t getResidentBytes() const {
+			return mResidentBytes;
+		}
+
+		///returns how many textures were dropped to their base level to stay in budget
+		int getEvictionCount() const {
+			return mEvictionCount;
+		}
+
+		///loads the base levels of the Texture synchronously and starts streaming it
+		bool load(Texture& texture);
+
+		///stops streaming the Texture
+		void remove(Texture& texture);
+
+		///reports that texture was drawn this frame covering the given amount of pixels
+		void notifyVisible(Texture& texture, const Vector& screenPixels);
+
+		///reports that texture was drawn this frame at an unknown size, so it needs full resolution
+		void notifyVisible(Texture& texture);
+
+		///requests and evicts levels based on this frame's visibility
+		void update();
+
+	private:
+		int64_t mBudget;
+		int64_t mResidentBytes = 0;
+		uint64_t mFrame = 1;
+		uint32_t mLoadsInFlight = 0;
+		int mEvictionCount = 0;
+
+		std::vector<std::shared_ptr<Entry>> mEntries;
+
+		optional_ref<Entry> _getEntry(Texture& texture);
+
+		void _upload(Entry& entry, uint32_t firstLevel, const std::vector<std::vector<uint8_t>>& levels);
+		int64_t _getByteSizeFor(const Entry& entry, uint32_t level) const;
+		bool _makeRoomFor(const Entry& entry, int64_t bytes);
+		void _request(const std::shared_ptr<Entry>& entry, uint32_t level);
+	};
+}
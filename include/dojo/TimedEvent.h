@@ -2,16 +2,35 @@
 
 #include "dojo_common_header.h"
 
+#include "TimingWheel.h"
+
 namespace Dojo {
 	class WorkerPool;
 	class TimedEventImpl;
 
+	///A task that runs periodically, plus the static API to run one-shot tasks in the future
+	/**
+	all the events are kept in a single TimingWheel that is advanced once per frame by the Platform, on the main thread */
 	class TimedEvent {
 		friend class EventManager;
 	public:
+		typedef TimingWheel::Handle Handle;
+
 		static void runTimedEvents(TimePoint now);
 
-		static void delay(TimePoint t, AsyncTask task);
+		///runs task on the main thread once t has passed, returns a handle to cancel it
+		static Handle delay(TimePoint t, AsyncTask task);
+
+		///like delay, but the task runs in targetPool and the callback is sent back; tasks that expire together go in a single job
+		static Handle delay(TimePoint t, AsyncTask task, AsyncCallback callback, WorkerPool& targetPool);
+
+		///cancels a delayed task, returns false if it already ran
+		static bool cancel(Handle handle);
+
+#ifndef PUBLISH
+		///returns the statistics of the wheel that holds all the events
+		static const TimingWheel::Stats& getStats();
+#endif
 		
 		TimedEvent();
 		~TimedEvent();
@@ -29,6 +48,13 @@ namespace Dojo {
 			optional_ref<WorkerPool> targetPool = {}
 		);
 
+		///stops the event; a run that was already sent to its pool still completes
+		void stop();
+
+		bool isRunning() const {
+			return mImpl != nullptr;
+		}
+
 	private:
 		
 		std::unique_ptr<TimedEventImpl> mImpl;
@@ -38,11 +38,11 @@ namespace Dojo {
 		}
 
 		///get the time from the last "reset event"
-		double getElapsedTime() {
+		double getElapsedTime() const {
 			return (eventTime > 0) ? currentTime() - eventTime : 0;
 		}
 
-		bool isEnabled() {
+		bool isEnabled() const {
 			return eventTime > 0;
 		}
 
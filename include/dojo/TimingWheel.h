@@ -0,0 +1,129 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "AsyncJob.h"
+
+namespace Dojo {
+	class WorkerPool;
+
+	///A hierarchical timing wheel that schedules tasks in O(1)
+	/**
+	Time is split in ticks of a fixed resolution; the first level has a slot for each of the next 256 ticks,
+	and each further level has 256 slots that are 256 times as long as the ones of the level below.
+	Scheduling and cancelling only link or unlink a pooled node in a slot, and advancing the wheel expires a whole slot per tick,
+	moving the nodes of a coarser slot to the finer levels when the time comes.
+
+	Tasks without a target pool run on the thread that calls advance(); all the tasks that expire in the same advance()
+	for the same WorkerPool are coalesced in a single job, with a single callback that calls all of theirs. */
+	class TimingWheel {
+	public:
+		static constexpr uint32_t SlotBits = 8;
+		static constexpr uint32_t SlotCount = 1 << SlotBits;
+		static constexpr uint32_t LevelCount = 4;
+
+		///identifies a scheduled task, it stays safe to use after the task has run or has been cancelled
+		struct Handle {
+			uint32_t index = UINT32_MAX;
+			uint32_t generation = 0;
+
+			bool isValid() const {
+				return index != UINT32_MAX;
+			}
+		};
+
+		explicit TimingWheel(Duration resolution = std::chrono::milliseconds(1), TimePoint start = std::chrono::high_resolution_clock::now());
+
+		TimingWheel(const TimingWheel&) = delete;
+		TimingWheel& operator=(const TimingWheel&) = delete;
+
+		///schedules task to run at deadline, or as soon as possible if it has already passed
+		/**
+		\param period if not zero the task runs again every period, counting from the deadline and not from when it actually ran,
+		so that it doesn't drift. A periodic task that is still running in its pool when it expires skips that period. */
+		Handle schedule(TimePoint deadline, AsyncTask task, Duration period = Duration::zero(), AsyncCallback callback = {}, WorkerPool* targetPool = nullptr);
+
+		///removes a scheduled task, returns false if it already ran or was cancelled
+		bool cancel(Handle handle);
+
+		bool isScheduled(Handle handle) const;
+
+		///returns the status of the last job sent to a pool for this task
+		AsyncJob::StatusPtr getStatus(Handle handle) const;
+
+		///runs all the tasks with a deadline before now
+		void advance(TimePoint now);
+
+		///returns the number of scheduled tasks
+		uint32_t getScheduledCount() const {
+			return mScheduledCount;
+		}
+
+		Duration getResolution() const {
+			return mResolution;
+		}
+
+#ifndef PUBLISH
+		struct Stats {
+			///the most tasks that were scheduled at the same time
+			uint32_t peakScheduledCount = 0;
+			uint64_t expiredCount = 0;
+			uint64_t advanceCount = 0;
+			///the time spent in advance() going through the ticks and the expired slots, without running the tasks
+			double advanceTime = 0;
+		};
+
+		const Stats& getStats() const {
+			return mStats;
+		}
+#endif
+
+	private:
+		static constexpr uint32_t Nil = UINT32_MAX;
+
+		struct Node {
+			uint64_t tick = 0;
+			TimePoint deadline;
+			Duration period = Duration::zero();
+			AsyncTask task;
+			AsyncCallback callback;
+			WorkerPool* pool = nullptr;
+			///the job that is running this task in its pool
+			AsyncJob::StatusPtr status;
+
+			uint32_t generation = 0;
+			uint32_t prev = Nil, next = Nil;
+			uint32_t slot = Nil;
+		};
+
+		Duration mResolution;
+		TimePoint mStart;
+		uint64_t mCurrentTick = 0;
+
+		std::vector<Node> mNodes;
+		uint32_t mFreeList = Nil;
+		uint32_t mScheduledCount = 0;
+
+		///the first node of each slot of each level
+		std::vector<uint32_t> mSlots;
+
+		///the nodes expired by the current advance(), in order
+		std::vector<uint32_t> mExpired;
+
+#ifndef PUBLISH
+		Stats mStats;
+#endif
+
+		uint64_t _getTick(TimePoint t) const;
+
+		uint32_t _allocNode();
+		void _freeNode(uint32_t idx);
+
+		void _link(uint32_t idx);
+		void _unlink(uint32_t idx);
+
+		void _cascade(uint32_t level);
+		void _expireSlot(uint32_t slot);
+		void _dispatchExpired(TimePoint now);
+	};
+}
@@ -18,8 +18,21 @@ namespace Dojo {
 		void sync();
 
 		bool runOneCallback();
+
+#ifndef PUBLISH
+		struct Stats {
+			uint64_t queuedJobs = 0;
+			///the total time spent by the producers queueing jobs, waiting for each other included
+			double queueTime = 0;
+			///how many times a worker was woken up by a job, and the total time between queueing those jobs and running them
+			uint64_t wakeups = 0;
+			double wakeTime = 0;
+		};
+
+		Stats getStats() const;
+#endif
 	private:
-		uint32_t mNextWorker = 0;
+		std::atomic<uint32_t> mNextWorker = { 0 };
 		std::vector<std::unique_ptr<BackgroundWorker>> mWorkers;
 	private:
 	};
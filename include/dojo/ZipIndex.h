@@ -0,0 +1,70 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "MappedFile.h"
+
+namespace Dojo {
+	///The directory of a zip archive, parsed once from its central directory and then shared by all the streams that read from it
+	/**
+	The archive is memory mapped for its whole lifetime and the index is never modified after it's built, so it can be
+	read from any number of threads at the same time; keep it in a shared_ptr as long as some content of the archive is in use.
+	Only stored and deflated entries can be read, encrypted and multi-disk archives are not supported. */
+	class ZipIndex {
+	public:
+		enum class Method : uint16_t {
+			Stored = 0,
+			Deflated = 8
+		};
+
+		struct Entry {
+			///the offset of the local header of the entry, its data starts after it
+			uint64_t headerOffset = 0;
+			uint64_t compressedSize = 0;
+			uint64_t size = 0;
+			uint32_t crc = 0;
+			uint16_t method = 0;
+			bool encrypted = false;
+		};
+
+		explicit ZipIndex(utf::string_view archivePath);
+
+		ZipIndex(const ZipIndex&) = delete;
+		ZipIndex& operator=(const ZipIndex&) = delete;
+
+		///true if the archive could be opened and its directory was parsed
+		bool isValid() const {
+			return mValid;
+		}
+
+		///returns the entry with this path relative to the root of the archive, if any
+		optional_ref<const Entry> find(utf::string_view path) const;
+
+		///returns the compressed data of an entry, pointing straight in the archive
+		vec_view<uint8_t> getData(const Entry& entry) const;
+
+		///adds the paths of all the files directly inside folder, relative to the root of the archive
+		void getFiles(utf::string_view folder, std::vector<utf::string>& out) const;
+
+		size_t getEntryCount() const {
+			return mEntries.size();
+		}
+
+		const MappedFile& getArchive() const {
+			return mArchive;
+		}
+
+	private:
+		MappedFile mArchive;
+		bool mValid = false;
+
+		std::vector<Entry> mEntries;
+		std::unordered_map<std::string, uint32_t> mEntryByPath;
+		///the entries contained in each folder, by the folder path without the trailing /
+		std::unordered_map<std::string, std::vector<uint32_t>> mEntriesByFolder;
+		std::vector<std::string> mPaths;
+
+		bool _parse();
+		void _add(std::string path, const Entry& entry);
+	};
+}
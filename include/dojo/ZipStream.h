@@ -0,0 +1,72 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "FileStream.h"
+#include "ZipIndex.h"
+
+#include <zlib.h>
+
+namespace Dojo {
+	///ZipStream reads a file contained in a zip archive
+	/**
+	Stored entries are read straight from the memory mapped archive; deflated entries are inflated on demand while reading,
+	so only the part of the file that is read is ever decompressed. Seeking forward skips the data in between, and seeking
+	backwards restarts the decompression from the beginning, so deflated entries are best read sequentially.
+	Each ZipStream has its own state, so different streams on the same archive can be read from different threads. */
+	class ZipStream : public FileStream {
+	public:
+
+		///creates a stream for the file at internalPath in the archive
+		/**
+		\param path the full path of the file, including the archive
+		\param archive the index of the archive, kept alive by the stream */
+		ZipStream(utf::string_view path, std::shared_ptr<const ZipIndex> archive, utf::string_view internalPath);
+		virtual ~ZipStream();
+
+		///opens the file, it can only be read
+		virtual bool open(Access accessType) override;
+
+		virtual int64_t getSize() override;
+
+		virtual Access getAccess() override;
+
+		virtual int64_t getCurrentPosition() override;
+
+		virtual int seek(int64_t offset, int64_t fromWhere = SEEK_SET) override;
+
+		virtual int64_t read(uint8_t* buf, int64_t number) override;
+
+		virtual void close() override;
+
+		///creates a new ZipStream to read the same file. Does not copy reading status
+		virtual std::unique_ptr<Stream> copy() const override;
+
+		///true if the file is not compressed, and its content can be used in place
+		bool isStored() const;
+
+		///returns the content of a stored file, which points in the archive
+		virtual vec_view<uint8_t> getContentInPlace(std::shared_ptr<const void>& owner) override;
+
+		const std::shared_ptr<const ZipIndex>& getArchive() const {
+			return mArchive;
+		}
+
+	private:
+
+		std::shared_ptr<const ZipIndex> mArchive;
+		utf::string mInternalPath;
+
+		optional_ref<const ZipIndex::Entry> mEntry;
+		vec_view<uint8_t> mData;
+		int64_t mPosition = 0;
+
+		Access mAccess = Access::BadFile;
+
+		z_stream mInflate;
+		bool mInflating = false;
+
+		bool _restartInflate();
+		int64_t _inflate(uint8_t* buf, int64_t number);
+	};
+}
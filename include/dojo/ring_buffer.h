@@ -1,9 +1,117 @@
 #pragma once
 
 namespace Dojo {
+	///a fixed-size buffer that overwrites its oldest element when full; elements are visited from the oldest to the newest
 	template<class T>
 	class ring_buffer {
 	public:
+		template<class RB, class V>
+		class iterator_base {
+		public:
+			typedef std::random_access_iterator_tag iterator_category;
+			typedef V value_type;
+			typedef ptrdiff_t difference_type;
+			typedef V* pointer;
+			typedef V& reference;
+
+			iterator_base(RB& buffer, size_t idx) :
+				m_buffer(&buffer),
+				m_idx(idx) {
+
+			}
+
+			reference operator*() const {
+				return (*m_buffer)[m_idx];
+			}
+
+			pointer operator->() const {
+				return &(*m_buffer)[m_idx];
+			}
+
+			iterator_base& operator++() {
+				++m_idx;
+				return self;
+			}
+
+			iterator_base operator++(int) {
+				auto prev = self;
+				++m_idx;
+				return prev;
+			}
+
+			iterator_base& operator--() {
+				--m_idx;
+				return self;
+			}
+
+			iterator_base operator--(int) {
+				auto prev = self;
+				--m_idx;
+				return prev;
+			}
+
+			iterator_base& operator+=(difference_type n) {
+				m_idx += n;
+				return self;
+			}
+
+			iterator_base& operator-=(difference_type n) {
+				m_idx -= n;
+				return self;
+			}
+
+			iterator_base operator+(difference_type n) const {
+				return{ *m_buffer, m_idx + n };
+			}
+
+			friend iterator_base operator+(difference_type n, const iterator_base& it) {
+				return it + n;
+			}
+
+			iterator_base operator-(difference_type n) const {
+				return{ *m_buffer, m_idx - n };
+			}
+
+			difference_type operator-(const iterator_base& other) const {
+				return static_cast<difference_type>(m_idx) - static_cast<difference_type>(other.m_idx);
+			}
+
+			reference operator[](difference_type n) const {
+				return (*m_buffer)[m_idx + n];
+			}
+
+			bool operator==(const iterator_base& other) const {
+				return m_idx == other.m_idx;
+			}
+
+			bool operator!=(const iterator_base& other) const {
+				return m_idx != other.m_idx;
+			}
+
+			bool operator<(const iterator_base& other) const {
+				return m_idx < other.m_idx;
+			}
+
+			bool operator>(const iterator_base& other) const {
+				return m_idx > other.m_idx;
+			}
+
+			bool operator<=(const iterator_base& other) const {
+				return m_idx <= other.m_idx;
+			}
+
+			bool operator>=(const iterator_base& other) const {
+				return m_idx >= other.m_idx;
+			}
+
+		private:
+			RB* m_buffer;
+			size_t m_idx;
+		};
+
+		typedef iterator_base<ring_buffer, T> iterator;
+		typedef iterator_base<const ring_buffer, const T> const_iterator;
+
 		explicit ring_buffer(size_t maxSize) : m_max_size(maxSize) {
 			m_buffer.reserve(maxSize);
 		}
@@ -16,6 +124,11 @@ namespace Dojo {
 			return m_buffer.size();
 		}
 
+		bool empty() const {
+			return m_buffer.empty();
+		}
+
+		///returns the element that the next emplace will overwrite, in storage order
 		auto peek_next() const {
 			if(m_write_idx < m_buffer.size()) {
 				return m_buffer.begin() + m_write_idx;
@@ -23,12 +136,41 @@ namespace Dojo {
 			return m_buffer.end();
 		}
 
-		auto begin() {
-			return m_buffer.begin();
+		///the i-th oldest element
+		T& operator[](size_t i) {
+			return m_buffer[_index(i)];
 		}
 
-		auto end() {
-			return m_buffer.end();
+		const T& operator[](size_t i) const {
+			return m_buffer[_index(i)];
+		}
+
+		T& front() {
+			return self[0];
+		}
+
+		T& back() {
+			return self[size() - 1];
+		}
+
+		const T& back() const {
+			return self[size() - 1];
+		}
+
+		iterator begin() {
+			return{ self, 0 };
+		}
+
+		iterator end() {
+			return{ self, size() };
+		}
+
+		const_iterator begin() const {
+			return{ self, 0 };
+		}
+
+		const_iterator end() const {
+			return{ self, size() };
 		}
 
 		template <class... Args>
@@ -43,10 +185,19 @@ namespace Dojo {
 			m_write_idx = (m_write_idx + 1) % max_size();
 		}
 
+		void clear() {
+			m_buffer.clear();
+			m_write_idx = 0;
+		}
+
 	private:
 		std::vector<T> m_buffer;
 		size_t m_write_idx = 0;
 		size_t m_max_size;
+
+		size_t _index(size_t i) const {
+			//once full, the oldest element is the one that will be overwritten next
+			return m_buffer.size() < m_max_size ? i : (m_write_idx + i) % m_max_size;
+		}
 	};
 }
-
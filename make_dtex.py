@@ -0,0 +1,120 @@
+#converts an image to a .dtex TextureContainer with a precomputed mip chain
+#usage: python make_dtex.py input.png output.dtex [--format rgba8|astc4x4|astc8x8|etc2|etc2a|bc1|bc3|bc7] [--srgb] [--no-mips]
+#--srgb marks the image as sRGB encoded, and stores it in the matching sRGB format
+#rgba8 is encoded directly; compressed formats run an external encoder on each level:
+#astc uses astcenc, the others need --encoder "<command with {input} and {output}>" writing raw blocks (--skip N skips a file header)
+
+import argparse
+import os
+import struct
+import subprocess
+import tempfile
+
+from PIL import Image
+
+#must match the order of Dojo::PixelFormat
+FORMATS = {
+	'rgba8':	(0, 1, 1, 0),
+	'rgba8_srgb':	(4, 1, 1, 0),
+	'etc2':		(10, 4, 4, 8),
+	'etc2a':	(11, 4, 4, 16),
+	'astc4x4':	(12, 4, 4, 16),
+	'astc8x8':	(13, 8, 8, 16),
+	'bc1':		(14, 4, 4, 8),
+	'bc3':		(15, 4, 4, 16),
+	'bc7':		(16, 4, 4, 16),
+	'etc2_srgb':	(17, 4, 4, 8),
+	'etc2a_srgb':	(18, 4, 4, 16),
+	'astc4x4_srgb':	(19, 4, 4, 16),
+	'astc8x8_srgb':	(20, 8, 8, 16),
+	'bc1_srgb':	(21, 4, 4, 8),
+	'bc3_srgb':	(22, 4, 4, 16),
+	'bc7_srgb':	(23, 4, 4, 16),
+}
+
+FLAG_TRANSPARENT = 1
+HEADER_SIZE = 32
+LEVEL_ENTRY_SIZE = 16
+ALIGNMENT = 16
+
+def make_levels(image, mips):
+	levels = [image]
+	while mips and (levels[-1].width > 1 or levels[-1].height > 1):
+		prev = levels[-1]
+		size = (max(prev.width // 2, 1), max(prev.height // 2, 1))
+		levels.append(prev.resize(size, Image.BOX))
+	return levels
+
+def run_encoder(command, level, skip):
+	with tempfile.TemporaryDirectory() as folder:
+		src = os.path.join(folder, 'level.png')
+		dst = os.path.join(folder, 'level.out')
+		level.save(src)
+		subprocess.check_call(command.format(input = src, output = dst), shell = True)
+		with open(dst, 'rb') as f:
+			return f.read()[skip:]
+
+def encode_level(args, level):
+	if args.format == 'rgba8':
+		return level.tobytes()
+
+	command, skip = args.encoder, args.skip
+	if command is None and args.format.startswith('astc'):
+		block = args.format[4:]
+		command = 'astcenc ' + ('-cs' if args.srgb else '-cl') + ' {input} {output} ' + block + ' -medium'
+		skip = 16 #.astc header
+
+	if command is None:
+		raise SystemExit('format ' + args.format + ' needs an --encoder command')
+
+	return run_encoder(command, level, skip)
+
+def expected_size(fmt, width, height):
+	_, bw, bh, block_bytes = fmt
+	if block_bytes == 0:
+		return width * height * 4
+	return ((width + bw - 1) // bw) * ((height + bh - 1) // bh) * block_bytes
+
+def main():
+	parser = argparse.ArgumentParser()
+	parser.add_argument('input')
+	parser.add_argument('output')
+	parser.add_argument('--format', default = 'rgba8', choices = [f for f in FORMATS if not f.endswith('_srgb')])
+	parser.add_argument('--srgb', action = 'store_true')
+	parser.add_argument('--no-mips', action = 'store_true')
+	parser.add_argument('--encoder', default = None)
+	parser.add_argument('--skip', type = int, default = 0)
+	args = parser.parse_args()
+
+	image = Image.open(args.input).convert('RGBA')
+	transparent = image.getextrema()[3][0] < 250
+
+	#the container must be tagged with the color space the blocks were encoded in, or the GPU decodes them wrong
+	key = args.format + '_srgb' if args.srgb else args.format
+	fmt = FORMATS[key]
+
+	levels = make_levels(image, not args.no_mips)
+	data = [encode_level(args, level) for level in levels]
+
+	for level, blob in zip(levels, data):
+		if len(blob) != expected_size(fmt, level.width, level.height):
+			raise SystemExit('the encoder output for a ' + str(level.size) + ' level has the wrong size')
+
+	offset = HEADER_SIZE + LEVEL_ENTRY_SIZE * len(levels)
+	entries = []
+	for blob in data:
+		offset = (offset + ALIGNMENT - 1) // ALIGNMENT * ALIGNMENT
+		entries.append((offset, len(blob)))
+		offset += len(blob)
+
+	with open(args.output, 'wb') as out:
+		flags = FLAG_TRANSPARENT if transparent else 0
+		out.write(struct.pack('<4s7I', b'DTEX', 1, fmt[0], image.width, image.height, len(levels), flags, 0))
+		for entry in entries:
+			out.write(struct.pack('<2Q', *entry))
+		for (start, _), blob in zip(entries, data):
+			out.write(b'\0' * (start - out.tell()))
+			out.write(blob)
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,230 @@
+#packs a data folder in a .dpak AssetPack
+#usage: python make_pack.py data_folder output.dpak [--compression lz4|deflate|none] [--page-size 4096]
+#the files of each folder are laid out contiguously and in the order in which ResourceGroup::addFolder loads them;
+#files that are already compressed, or that don't shrink enough, are stored so that they can be used in place.
+#lz4 uses the lz4 module when it's installed, otherwise a slower built-in compressor
+
+import argparse
+import os
+import struct
+import zlib
+
+VERSION = 1
+HEADER_SIZE = 64
+ENTRY_SIZE = 24
+FOLDER_SIZE = 32
+ENTRY_ALIGNMENT = 16
+EMPTY_SLOT = 0xffffffff
+
+#must match Dojo::AssetPack::Compression
+COMPRESSIONS = {
+	'none':		0,
+	'lz4':		1,
+	'deflate':	2,
+}
+
+#the order of ResourceGroup::addFolderSimple, so that a folder is read front to back while it loads
+LOAD_ORDER = ['png', 'jpg', 'dds', 'dtex', 'atlasinfo', 'font', 'ttf', 'otf', 'mesh', 'ogg', 'ds', 'vertex', 'fragment', 'material']
+
+STORED_TYPES = {'png', 'jpg', 'ogg', 'ttf', 'otf'}
+
+#compressed files are stored instead if they don't save at least this much
+MIN_SAVING = 0.1
+
+MASK = 0xffffffffffffffff
+
+def hash_name(name, seed):
+	#FNV-1a with the finalizer of AssetPack.cpp
+	h = 0xcbf29ce484222325 ^ seed
+	for b in name:
+		h ^= b
+		h = (h * 0x100000001b3) & MASK
+
+	h ^= h >> 33
+	h = (h * 0xff51afd7ed558ccd) & MASK
+	h ^= h >> 33
+	return h
+
+def build_perfect_hash(names):
+	#hash and displace: the names are split in small buckets, then each bucket looks for a seed that puts all of its names in free slots
+	bucket_count = max(1, (len(names) + 3) // 4)
+	slot_count = max(1, len(names) * 5 // 4)
+
+	buckets = [[] for _ in range(bucket_count)]
+	for idx, name in enumerate(names):
+		buckets[hash_name(name, 0) % bucket_count].append(idx)
+
+	seeds = [0] * bucket_count
+	slots = [EMPTY_SLOT] * slot_count
+
+	for bucket in sorted(range(bucket_count), key = lambda b: -len(buckets[b])):
+		entries = buckets[bucket]
+		if not entries:
+			break
+
+		seed = 1
+		while True:
+			positions = [hash_name(names[idx], seed) % slot_count for idx in entries]
+			if len(set(positions)) == len(positions) and all(slots[p] == EMPTY_SLOT for p in positions):
+				break
+			seed += 1
+			if seed > 0xffffffff:
+				raise SystemExit('cannot build the name table')
+
+		seeds[bucket] = seed
+		for idx, p in zip(entries, positions):
+			slots[p] = idx
+
+	return seeds, slots
+
+def write_length(out, value):
+	while value >= 255:
+		out.append(255)
+		value -= 255
+	out.append(value)
+
+def write_sequence(out, literals, offset = 0, match_length = 0):
+	token_match = min(match_length - 4, 15) if match_length else 0
+	out.append((min(len(literals), 15) << 4) | token_match)
+	if len(literals) >= 15:
+		write_length(out, len(literals) - 15)
+	out += literals
+
+	if match_length:
+		out += struct.pack('<H', offset)
+		if match_length - 4 >= 15:
+			write_length(out, match_length - 4 - 15)
+
+def compress_lz4(data):
+	try:
+		import lz4.block
+		return lz4.block.compress(data, mode = 'high_compression', store_size = False)
+	except ImportError:
+		pass
+
+	#greedy LZ4 block compressor; the last match must start 12 bytes before the end and the last 5 bytes must be literals
+	out = bytearray()
+	table = {}
+	anchor = 0
+	i = 0
+	limit = len(data) - 12
+	while i < limit:
+		key = data[i:i + 4]
+		candidate = table.get(key)
+		table[key] = i
+
+		if candidate is None or i - candidate > 0xffff:
+			i += 1
+			continue
+
+		length = 4
+		max_length = len(data) - 5 - i
+		while length < max_length and data[candidate + length] == data[i + length]:
+			length += 1
+
+		write_sequence(out, data[anchor:i], i - candidate, length)
+		i += length
+		anchor = i
+
+	write_sequence(out, data[anchor:])
+	return bytes(out)
+
+def compress(data, ext, method):
+	if method == 'none' or ext in STORED_TYPES or not data:
+		return 'none', data
+
+	packed = compress_lz4(data) if method == 'lz4' else zlib.compress(data, 9)
+	if len(packed) > len(data) * (1 - MIN_SAVING):
+		return 'none', data
+	return method, packed
+
+def load_rank(name):
+	ext = os.path.splitext(name)[1][1:].lower()
+	return (LOAD_ORDER.index(ext) if ext in LOAD_ORDER else len(LOAD_ORDER), name)
+
+def align(value, alignment):
+	return (value + alignment - 1) // alignment * alignment
+
+def main():
+	parser = argparse.ArgumentParser()
+	parser.add_argument('input')
+	parser.add_argument('output')
+	parser.add_argument('--compression', default = 'lz4', choices = list(COMPRESSIONS))
+	parser.add_argument('--page-size', type = int, default = 4096)
+	args = parser.parse_args()
+
+	folders = {}
+	for root, _, files in os.walk(args.input):
+		folder = os.path.relpath(root, args.input).replace(os.sep, '/')
+		if folder == '.':
+			folder = ''
+		if files:
+			folders[folder] = sorted(files, key = load_rank)
+
+	#entries are sorted by folder, so that each folder is a contiguous range of entries and of data
+	entries = []
+	folder_ranges = []
+	for folder in sorted(folders):
+		first = len(entries)
+		for file in folders[folder]:
+			with open(os.path.join(args.input, folder, file), 'rb') as f:
+				data = f.read()
+			name = (folder + '/' + file if folder else file).encode('utf-8')
+			method, packed = compress(data, os.path.splitext(file)[1][1:].lower(), args.compression)
+			entries.append({'name': name, 'size': len(data), 'method': method, 'data': packed})
+		folder_ranges.append((folder.encode('utf-8'), first, len(entries) - first))
+
+	names = [e['name'] for e in entries]
+	seeds, slots = build_perfect_hash(names)
+
+	#the name blob has the entry names and then the folder names
+	blob = bytearray()
+	for e in entries:
+		e['name_offset'] = len(blob)
+		blob += e['name']
+	folder_name_offsets = []
+	for folder, _, _ in folder_ranges:
+		folder_name_offsets.append(len(blob))
+		blob += folder
+
+	seeds_offset = HEADER_SIZE
+	slots_offset = seeds_offset + 4 * len(seeds)
+	entries_offset = align(slots_offset + 4 * len(slots), 8)
+	folders_offset = entries_offset + ENTRY_SIZE * len(entries)
+	names_offset = folders_offset + FOLDER_SIZE * len(folder_ranges)
+
+	#each folder starts on a new page, the files in it are packed
+	offset = align(names_offset + len(blob), args.page_size)
+	folder_data = []
+	for folder, first, count in folder_ranges:
+		offset = align(offset, args.page_size)
+		start = offset
+		for e in entries[first:first + count]:
+			offset = align(offset, ENTRY_ALIGNMENT)
+			e['offset'] = offset
+			offset += len(e['data'])
+		folder_data.append((start, offset - start))
+
+	with open(args.output, 'wb') as out:
+		out.write(struct.pack('<4s12I12x', b'DPAK', VERSION, args.page_size, len(entries), len(slots), len(seeds), len(folder_ranges), len(blob),
+			seeds_offset, slots_offset, entries_offset, folders_offset, names_offset))
+		out.write(struct.pack('<%dI' % len(seeds), *seeds))
+		out.write(struct.pack('<%dI' % len(slots), *slots))
+		out.write(b'\0' * (entries_offset - out.tell()))
+		for e in entries:
+			out.write(struct.pack('<Q3IHBx', e['offset'], len(e['data']), e['size'], e['name_offset'], len(e['name']), COMPRESSIONS[e['method']]))
+		for (folder, first, count), name_offset, (start, size) in zip(folder_ranges, folder_name_offsets, folder_data):
+			out.write(struct.pack('<2Q3IH2x', start, size, first, count, name_offset, len(folder)))
+		out.write(blob)
+
+		for e in entries:
+			out.write(b'\0' * (e['offset'] - out.tell()))
+			out.write(e['data'])
+
+	stored = sum(1 for e in entries if e['method'] == 'none')
+	total = sum(e['size'] for e in entries)
+	packed = sum(len(e['data']) for e in entries)
+	print('%d files in %d folders, %d stored, %d -> %d bytes' % (len(entries), len(folder_ranges), stored, total, packed))
+
+if __name__ == '__main__':
+	main()
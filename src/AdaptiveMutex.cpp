@@ -0,0 +1,52 @@
+#include "AdaptiveMutex.h"
+
+#include "SpinLock.h"
+
+using namespace Dojo;
+
+void AdaptiveMutex::lock() {
+	Backoff backoff;
+	while (backoff.isSpinning()) {
+		if (mState.load(std::memory_order_relaxed) == 0 and try_lock()) {
+			return;
+		}
+		backoff.pause();
+	}
+
+	//register as a waiter; if the lock was taken, sleep until unlock() hands it over
+	if (mState.fetch_add(1, std::memory_order_acquire) > 0) {
+		mWaiters.wait();
+	}
+}
+
+void EventCount::wait(Key key) {
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		while (static_cast<Key>(mState.load(std::memory_order_acquire) >> EpochShift) == key) {
+			mCondition.wait(lock);
+		}
+	}
+	mState.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void EventCount::_notify(bool all) {
+	//pairs with the RMW in prepareWait: either the waiter sees the new data, or this sees the waiter
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if ((mState.load(std::memory_order_relaxed) & WaiterMask) == 0) {
+		return;
+	}
+
+	mState.fetch_add(1ull << EpochShift, std::memory_order_seq_cst);
+
+	//taking the mutex makes sure that a waiter is either already sleeping or will see the new epoch
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+	}
+
+	if (all) {
+		mCondition.notify_all();
+	}
+	else {
+		mCondition.notify_one();
+	}
+}
@@ -0,0 +1,393 @@
+#include "AssetPack.h"
+
+#include "WorkerPool.h"
+
+#include <zlib.h>
+
+using namespace Dojo;
+
+const utf::string_view AssetPack::Extension = "dpak";
+
+namespace {
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t pageSize;
+		uint32_t entryCount;
+		uint32_t slotCount;
+		uint32_t bucketCount;
+		uint32_t folderCount;
+		uint32_t namesSize;
+		uint32_t seedsOffset;
+		uint32_t slotsOffset;
+		uint32_t entriesOffset;
+		uint32_t foldersOffset;
+		uint32_t namesOffset;
+		uint32_t reserved[3];
+	};
+
+	//the tables are used in place, so their layout must match make_pack.py exactly
+	static_assert(sizeof(Header) == 64, "Wrong pack header layout");
+	static_assert(sizeof(AssetPack::Entry) == 24, "Wrong pack entry layout");
+	static_assert(sizeof(AssetPack::Folder) == 32, "Wrong pack folder layout");
+
+	const uint32_t EmptySlot = UINT32_MAX;
+
+	///files are grouped in prefetch jobs of about this size
+	const size_t PrefetchJobSize = 1024 * 1024;
+
+	uint64_t hashName(const char* str, size_t size, uint32_t seed) {
+		//FNV-1a, then a finalizer because the table index uses the low bits, which FNV mixes poorly
+		uint64_t h = 0xcbf29ce484222325ull ^ seed;
+		for (size_t i = 0; i < size; ++i) {
+			h ^= (uint8_t)str[i];
+			h *= 0x100000001b3ull;
+		}
+
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	std::string normalize(utf::string_view path) {
+		auto begin = path.data();
+		auto end = begin + path.byte_size();
+
+		//the paths in the pack are relative to its root
+		while (begin != end and (*begin == '/' or (*begin == '.' and begin + 1 != end and begin[1] == '/'))) {
+			begin += *begin == '/' ? 1 : 2;
+		}
+		while (begin != end and end[-1] == '/') {
+			--end;
+		}
+
+		return{ begin, end };
+	}
+
+	bool decompressLZ4(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+		auto ip = src, iend = src + srcSize;
+		auto op = dst, oend = dst + dstSize;
+
+		auto readLength = [&](size_t& length) {
+			uint8_t b;
+			do {
+				if (ip == iend) {
+					return false;
+				}
+				b = *ip++;
+				length += b;
+			} while (b == 255);
+			return true;
+		};
+
+		while (ip < iend) {
+			auto token = *ip++;
+
+			size_t literals = token >> 4;
+			if (literals == 15 and not readLength(literals)) {
+				return false;
+			}
+			if (literals > (size_t)(iend - ip) or literals > (size_t)(oend - op)) {
+				return false;
+			}
+			memcpy(op, ip, literals);
+			ip += literals;
+			op += literals;
+
+			//the last sequence has no match
+			if (ip == iend) {
+				break;
+			}
+
+			if (iend - ip < 2) {
+				return false;
+			}
+			size_t offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+			if (offset == 0 or offset > (size_t)(op - dst)) {
+				return false;
+			}
+
+			size_t length = token & 15;
+			if (length == 15 and not readLength(length)) {
+				return false;
+			}
+			length += 4;
+			if (length > (size_t)(oend - op)) {
+				return false;
+			}
+
+			//a match closer than its length repeats the bytes that it is writing, so it has to be copied forward
+			auto match = op - offset;
+			if (offset >= length) {
+				memcpy(op, match, length);
+			}
+			else {
+				for (size_t i = 0; i < length; ++i) {
+					op[i] = match[i];
+				}
+			}
+			op += length;
+		}
+
+		return op == oend;
+	}
+}
+
+AssetPack::AssetPack(utf::string_view path) :
+	mFile(path, MappedFile::AccessHint::Random) {
+
+	mValid = mFile.isOpen() and _parse();
+	DEBUG_ASSERT_INFO(mValid, "Cannot read the asset pack", path.copy());
+}
+
+bool AssetPack::_parse() {
+	auto data = mFile.data();
+	auto size = mFile.size();
+
+	if (size < sizeof(Header) or (uintptr_t)data % alignof(Entry) != 0) {
+		return false;
+	}
+
+	auto& header = *(const Header*)data;
+	if (memcmp(header.magic, "DPAK", 4) != 0 or header.version != Version) {
+		return false;
+	}
+
+	auto fits = [&](uint64_t offset, uint64_t count, uint64_t elementSize, size_t alignment) {
+		return offset % alignment == 0 and offset + count * elementSize <= size;
+	};
+
+	if (header.slotCount < header.entryCount or header.bucketCount == 0 or header.slotCount == 0
+		or not fits(header.seedsOffset, header.bucketCount, sizeof(uint32_t), alignof(uint32_t))
+		or not fits(header.slotsOffset, header.slotCount, sizeof(uint32_t), alignof(uint32_t))
+		or not fits(header.entriesOffset, header.entryCount, sizeof(Entry), alignof(Entry))
+		or not fits(header.foldersOffset, header.folderCount, sizeof(Folder), alignof(Folder))
+		or not fits(header.namesOffset, header.namesSize, 1, 1)) {
+		return false;
+	}
+
+	mEntryCount = header.entryCount;
+	mSlotCount = header.slotCount;
+	mBucketCount = header.bucketCount;
+	mFolderCount = header.folderCount;
+	mSeeds = (const uint32_t*)(data + header.seedsOffset);
+	mSlots = (const uint32_t*)(data + header.slotsOffset);
+	mEntries = (const Entry*)(data + header.entriesOffset);
+	mFolders = (const Folder*)(data + header.foldersOffset);
+	mNames = (const char*)(data + header.namesOffset);
+	mNamesSize = header.namesSize;
+
+	//check everything that lookups will index once, so that a corrupt pack can't make them read out of the mapping
+	for (uint32_t i = 0; i < mSlotCount; ++i) {
+		if (mSlots[i] != EmptySlot and mSlots[i] >= mEntryCount) {
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < mEntryCount; ++i) {
+		auto& entry = mEntries[i];
+		if (entry.offset + entry.compressedSize > size or (uint64_t)entry.nameOffset + entry.nameLength > mNamesSize
+			or entry.compression > Compression::Deflate
+			or (entry.compression == Compression::None and entry.compressedSize != entry.size)) {
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < mFolderCount; ++i) {
+		auto& folder = mFolders[i];
+		if ((uint64_t)folder.firstEntry + folder.entryCount > mEntryCount or folder.dataOffset + folder.dataSize > size
+			or (uint64_t)folder.nameOffset + folder.nameLength > mNamesSize) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+utf::string_view AssetPack::_getName(uint32_t nameOffset, uint16_t nameLength) const {
+	auto name = mNames + nameOffset;
+	return{ utf::string::const_iterator(name), utf::string::const_iterator(name + nameLength) };
+}
+
+optional_ref<const AssetPack::Entry> AssetPack::find(utf::string_view path) const {
+	if (not mValid) {
+		return{};
+	}
+
+	auto name = normalize(path);
+	auto bucket = hashName(name.data(), name.size(), 0) % mBucketCount;
+	auto slot = hashName(name.data(), name.size(), mSeeds[bucket]) % mSlotCount;
+
+	//the perfect hash sends every name in the pack to its own slot, but a name that is not in the pack can land anywhere
+	auto idx = mSlots[slot];
+	if (idx == EmptySlot) {
+		return{};
+	}
+
+	auto& entry = mEntries[idx];
+	if (entry.nameLength != name.size() or memcmp(mNames + entry.nameOffset, name.data(), name.size()) != 0) {
+		return{};
+	}
+	return entry;
+}
+
+optional_ref<const AssetPack::Folder> AssetPack::_findFolder(utf::string_view path) const {
+	auto name = normalize(path);
+
+	//there are few folders compared to the files
+	for (uint32_t i = 0; i < mFolderCount; ++i) {
+		auto& folder = mFolders[i];
+		if (folder.nameLength == name.size() and memcmp(mNames + folder.nameOffset, name.data(), name.size()) == 0) {
+			return folder;
+		}
+	}
+	return{};
+}
+
+void AssetPack::getFiles(utf::string_view path, std::vector<utf::string>& out) const {
+	auto folder = _findFolder(path);
+	if (folder.is_none()) {
+		return;
+	}
+
+	auto& f = folder.unwrap();
+	for (auto idx = f.firstEntry; idx < f.firstEntry + f.entryCount; ++idx) {
+		out.emplace_back(_getName(mEntries[idx].nameOffset, mEntries[idx].nameLength).copy());
+	}
+}
+
+vec_view<uint8_t> AssetPack::_getData(const Entry& entry) const {
+	auto data = mFile.data() + entry.offset;
+	return{ data, data + entry.compressedSize };
+}
+
+AssetPack::Buffer AssetPack::_decompress(const Entry& entry) const {
+	auto src = _getData(entry);
+	auto buffer = make_shared<std::vector<uint8_t>>(entry.size);
+
+	bool ok = false;
+	switch (entry.compression) {
+	case Compression::LZ4:
+		ok = decompressLZ4(src.data(), src.size(), buffer->data(), buffer->size());
+		break;
+	case Compression::Deflate: {
+		uLongf size = (uLongf)buffer->size();
+		ok = uncompress(buffer->data(), &size, src.data(), (uLong)src.size()) == Z_OK and size == buffer->size();
+		break;
+	}
+	default:
+		FAIL("Stored entries are not decompressed");
+	}
+
+	DEBUG_ASSERT_INFO(ok, "Corrupt asset pack entry", _getName(entry.nameOffset, entry.nameLength).copy());
+	return ok ? buffer : nullptr;
+}
+
+vec_view<uint8_t> AssetPack::getContent(const Entry& entry, std::shared_ptr<const void>& owner) {
+	if (entry.compression == Compression::None) {
+		owner = shared_from_this();
+		return _getData(entry);
+	}
+
+	auto idx = (uint32_t)(&entry - mEntries);
+	DEBUG_ASSERT(idx < mEntryCount, "The entry is not in this pack");
+
+	Buffer buffer;
+	{
+		std::lock_guard<std::mutex> lock(mPrefetchedMutex);
+		auto elem = mPrefetched.find(idx);
+		if (elem != mPrefetched.end()) {
+			//if the prefetch is still running, drop it and decompress here rather than waiting for the pool
+			buffer = std::move(elem->second);
+			mPrefetched.erase(elem);
+			mPrefetchedSize -= entry.size;
+		}
+	}
+
+	if (not buffer) {
+		buffer = _decompress(entry);
+		if (not buffer) {
+			return{};
+		}
+	}
+
+	owner = buffer;
+	return{ buffer->data(), buffer->data() + buffer->size() };
+}
+
+void AssetPack::prefetch(utf::string_view path, WorkerPool& pool) {
+	auto folder = _findFolder(path);
+	if (folder.is_none()) {
+		return;
+	}
+
+	//a single request for the whole folder, that the OS can serve as one sequential read
+	auto& f = folder.unwrap();
+	mFile.prefetch((size_t)f.dataOffset, (size_t)f.dataSize);
+
+	std::vector<std::vector<uint32_t>> jobs(1);
+	size_t jobSize = 0;
+	{
+		std::lock_guard<std::mutex> lock(mPrefetchedMutex);
+		for (auto idx = f.firstEntry; idx < f.firstEntry + f.entryCount; ++idx) {
+			auto& entry = mEntries[idx];
+
+			if (entry.compression != Compression::None) {
+				if (mPrefetched.count(idx) or mPrefetchedSize + entry.size > MaxPrefetchedSize) {
+					continue;
+				}
+
+				//an empty buffer marks the entries that are being decompressed
+				mPrefetched.emplace(idx, nullptr);
+				mPrefetchedSize += entry.size;
+			}
+
+			jobs.back().push_back(idx);
+			jobSize += entry.size;
+			if (jobSize >= PrefetchJobSize) {
+				jobs.emplace_back();
+				jobSize = 0;
+			}
+		}
+	}
+
+	for (auto&& job : jobs) {
+		if (job.empty()) {
+			continue;
+		}
+
+		pool.queue([pack = shared_from_this(), entries = std::move(job)]{
+			for (auto&& idx : entries) {
+				auto& entry = pack->mEntries[idx];
+
+				//stored files are used in place, only fault their pages in here instead of on the thread that loads them
+				if (entry.compression == Compression::None) {
+					auto data = pack->_getData(entry);
+					volatile uint8_t sink = 0;
+					for (size_t i = 0; i < data.size(); i += 4096) {
+						sink += data[i];
+					}
+					continue;
+				}
+
+				auto buffer = pack->_decompress(entry);
+
+				std::lock_guard<std::mutex> lock(pack->mPrefetchedMutex);
+				auto elem = pack->mPrefetched.find(idx);
+				if (elem == pack->mPrefetched.end()) {
+					continue; //it was already opened
+				}
+
+				if (buffer) {
+					elem->second = std::move(buffer);
+				}
+				else {
+					pack->mPrefetched.erase(elem);
+					pack->mPrefetchedSize -= entry.size;
+				}
+			}
+		});
+	}
+}
@@ -0,0 +1,451 @@
+#include "AtlasPacker.h"
+
+#include "Platform.h"
+#include "Path.h"
+#include "Table.h"
+
+using namespace Dojo;
+
+PixelFormat AtlasPacker::readImage(utf::string_view path, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height) {
+	std::vector<uint8_t> data;
+	int pixelSize = 0;
+	auto format = Platform::singleton().loadImageFile(data, path, width, height, pixelSize);
+
+	if (format == PixelFormat::Unknown or width == 0 or height == 0) {
+		return PixelFormat::Unknown;
+	}
+
+	//rows can be padded
+	auto pitch = data.size() / height;
+
+	rgba.resize(width * height * 4);
+	for (uint32_t y = 0; y < height; ++y) {
+		auto in = data.data() + y * pitch;
+		auto out = rgba.data() + y * width * 4;
+
+		for (uint32_t x = 0; x < width; ++x, in += pixelSize, out += 4) {
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+			out[3] = pixelSize == 4 ? in[3] : 255;
+		}
+	}
+
+	switch (format) {
+	case PixelFormat::RGB_8_8_8:
+		return PixelFormat::RGBA_8_8_8_8;
+	case PixelFormat::RGB_8_8_8_SRGB:
+		return PixelFormat::RGBA_8_8_8_8_SRGB;
+	default:
+		return format;
+	}
+}
+
+AtlasPacker::AtlasPacker() :
+	AtlasPacker(Settings()) {
+
+}
+
+AtlasPacker::AtlasPacker(const Settings& settings) :
+	mSettings(settings) {
+	DEBUG_ASSERT(settings.pageSize > settings.padding * 2, "The pages are too small for this padding");
+}
+
+uint32_t AtlasPacker::add(std::vector<uint8_t> rgba, uint32_t width, uint32_t height, int group) {
+	DEBUG_ASSERT(width > 0 and height > 0, "Invalid image size");
+	DEBUG_ASSERT(rgba.size() == width * height * 4, "The image data should be tightly packed RGBA8");
+
+	Image image = { std::move(rgba), width, height, group };
+	mImages.emplace_back(std::move(image));
+	return static_cast<uint32_t>(mImages.size() - 1);
+}
+
+void AtlasPacker::_trim(Image& image) const {
+	auto& p = image.placement;
+	p.originalWidth = image.width;
+	p.originalHeight = image.height;
+	p.trimX = p.trimY = 0;
+	p.rotated = false;
+	p.width = image.width;
+	p.height = image.height;
+
+	if (not mSettings.trim) {
+		return;
+	}
+
+	uint32_t minX = image.width, minY = image.height, maxX = 0, maxY = 0;
+	for (uint32_t y = 0; y < image.height; ++y) {
+		auto row = image.rgba.data() + y * image.width * 4;
+		for (uint32_t x = 0; x < image.width; ++x) {
+			if (row[x * 4 + 3] > 0) {
+				minX = std::min(minX, x);
+				maxX = std::max(maxX, x);
+				minY = std::min(minY, y);
+				maxY = std::max(maxY, y);
+			}
+		}
+	}
+
+	//keep a single pixel of completely transparent images
+	if (minX > maxX) {
+		p.width = p.height = 1;
+		return;
+	}
+
+	p.trimX = minX;
+	p.trimY = minY;
+	p.width = maxX - minX + 1;
+	p.height = maxY - minY + 1;
+}
+
+AtlasPacker::Page AtlasPacker::_makePage(uint32_t width, uint32_t height) const {
+	Page page;
+	page.width = width;
+	page.height = height;
+	page.freeRects.push_back({ 0, 0, width, height });
+	return page;
+}
+
+bool AtlasPacker::_findPosition(const Page& page, uint32_t width, uint32_t height, Rect& best, bool& rotated) const {
+	//best short side fit: choose the free rect that leaves the smallest leftover on its shortest side
+	uint32_t bestShort = UINT32_MAX, bestLong = UINT32_MAX;
+
+	auto tryFit = [&](const Rect& free, uint32_t w, uint32_t h, bool rotate) {
+		if (w > free.width or h > free.height) {
+			return;
+		}
+
+		auto leftoverX = free.width - w, leftoverY = free.height - h;
+		auto shortSide = std::min(leftoverX, leftoverY), longSide = std::max(leftoverX, leftoverY);
+
+		if (shortSide < bestShort or (shortSide == bestShort and longSide < bestLong)) {
+			bestShort = shortSide;
+			bestLong = longSide;
+			best = { free.x, free.y, w, h };
+			rotated = rotate;
+		}
+	};
+
+	for (auto&& free : page.freeRects) {
+		tryFit(free, width, height, false);
+
+		if (mSettings.allowRotation and width != height) {
+			tryFit(free, height, width, true);
+		}
+	}
+
+	return bestShort != UINT32_MAX;
+}
+
+void AtlasPacker::_place(Page& page, const Rect& used) {
+	//split all the free rects that overlap the new one in the maximal rects around it
+	std::vector<Rect> split;
+	for (size_t i = 0; i < page.freeRects.size();) {
+		auto free = page.freeRects[i];
+		if (not free.intersects(used)) {
+			++i;
+			continue;
+		}
+
+		if (used.x > free.x) {
+			split.push_back({ free.x, free.y, used.x - free.x, free.height });
+		}
+		if (used.x + used.width < free.x + free.width) {
+			split.push_back({ used.x + used.width, free.y, free.x + free.width - used.x - used.width, free.height });
+		}
+		if (used.y > free.y) {
+			split.push_back({ free.x, free.y, free.width, used.y - free.y });
+		}
+		if (used.y + used.height < free.y + free.height) {
+			split.push_back({ free.x, used.y + used.height, free.width, free.y + free.height - used.y - used.height });
+		}
+
+		page.freeRects[i] = page.freeRects.back();
+		page.freeRects.pop_back();
+	}
+
+	page.freeRects.insert(page.freeRects.end(), split.begin(), split.end());
+
+	//remove the free rects contained in other ones
+	for (size_t i = 0; i < page.freeRects.size(); ++i) {
+		for (size_t j = i + 1; j < page.freeRects.size();) {
+			if (page.freeRects[i].contains(page.freeRects[j])) {
+				page.freeRects.erase(page.freeRects.begin() + j);
+			}
+			else if (page.freeRects[j].contains(page.freeRects[i])) {
+				page.freeRects.erase(page.freeRects.begin() + i);
+				--i;
+				break;
+			}
+			else {
+				++j;
+			}
+		}
+	}
+
+	page.usedWidth = std::max(page.usedWidth, used.x + used.width);
+	page.usedHeight = std::max(page.usedHeight, used.y + used.height);
+}
+
+bool AtlasPacker::_insertGroup(Page& page, const std::vector<uint32_t>& images) {
+	auto padding = mSettings.padding;
+
+	for (auto&& index : images) {
+		//the placement could be left over by a failed attempt on another page
+		auto& p = mImages[index].placement;
+		auto w = p.rotated ? p.height : p.width;
+		auto h = p.rotated ? p.width : p.height;
+
+		Rect rect;
+		bool rotated;
+		if (not _findPosition(page, w + padding * 2, h + padding * 2, rect, rotated)) {
+			return false;
+		}
+
+		_place(page, rect);
+
+		p.x = rect.x + padding;
+		p.y = rect.y + padding;
+		p.rotated = rotated;
+		p.width = rect.width - padding * 2;
+		p.height = rect.height - padding * 2;
+	}
+	return true;
+}
+
+bool AtlasPacker::pack() {
+	mPages.clear();
+
+	std::map<int, std::vector<uint32_t>> groups;
+	std::vector<std::vector<uint32_t>> sorted;
+	for (uint32_t i = 0; i < mImages.size(); ++i) {
+		_trim(mImages[i]);
+
+		if (mImages[i].group < 0) {
+			sorted.push_back({ i });
+		}
+		else {
+			groups[mImages[i].group].push_back(i);
+		}
+	}
+
+	for (auto&& group : groups) {
+		sorted.emplace_back(std::move(group.second));
+	}
+
+	auto maxSide = [&](uint32_t index) {
+		auto& p = mImages[index].placement;
+		return std::max(p.width, p.height);
+	};
+
+	auto area = [&](const std::vector<uint32_t>& group) {
+		uint64_t total = 0;
+		for (auto&& index : group) {
+			auto& p = mImages[index].placement;
+			total += (uint64_t)p.width * p.height;
+		}
+		return total;
+	};
+
+	//big things first, they are the hardest to place
+	for (auto&& group : sorted) {
+		std::sort(group.begin(), group.end(), [&](uint32_t a, uint32_t b) {
+			return maxSide(a) > maxSide(b);
+		});
+	}
+
+	std::sort(sorted.begin(), sorted.end(), [&](const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+		return area(a) > area(b);
+	});
+
+	auto tryPages = [&](const std::vector<uint32_t>& group) {
+		for (uint32_t i = 0; i < mPages.size(); ++i) {
+			auto page = mPages[i];
+			if (_insertGroup(page, group)) {
+				mPages[i] = std::move(page);
+				return i;
+			}
+		}
+
+		auto page = _makePage(mSettings.pageSize, mSettings.pageSize);
+		if (_insertGroup(page, group)) {
+			mPages.emplace_back(std::move(page));
+			return static_cast<uint32_t>(mPages.size() - 1);
+		}
+		return UINT32_MAX;
+	};
+
+	bool allGroupsFit = true;
+	for (auto&& group : sorted) {
+		auto page = tryPages(group);
+
+		if (page == UINT32_MAX) {
+			allGroupsFit &= group.size() == 1;
+
+			if (group.size() > 1 and not mSettings.splitGroups) {
+				for (auto&& index : group) {
+					mImages[index].placement.page = Placement::NotPlaced;
+				}
+				continue;
+			}
+
+			//place the images one by one, giving the ones too big for a page a page of their own
+			for (auto&& index : group) {
+				page = tryPages({ index });
+
+				if (page == UINT32_MAX) {
+					auto& p = mImages[index].placement;
+					auto big = _makePage(p.width + mSettings.padding * 2, p.height + mSettings.padding * 2);
+					_insertGroup(big, { index });
+					mPages.emplace_back(std::move(big));
+					page = static_cast<uint32_t>(mPages.size() - 1);
+				}
+				mImages[index].placement.page = page;
+			}
+		}
+		else {
+			for (auto&& index : group) {
+				mImages[index].placement.page = page;
+			}
+		}
+	}
+
+	//pages are cropped to their used area, rounded to a multiple of 4 for the GPU
+	for (auto&& page : mPages) {
+		page.usedWidth = (page.usedWidth + 3) & ~3u;
+		page.usedHeight = (page.usedHeight + 3) & ~3u;
+	}
+
+	return allGroupsFit;
+}
+
+float AtlasPacker::getEfficiency() const {
+	uint64_t used = 0, total = 0;
+	for (auto&& image : mImages) {
+		if (image.placement.page != Placement::NotPlaced) {
+			used += (uint64_t)image.placement.width * image.placement.height;
+		}
+	}
+	for (auto&& page : mPages) {
+		total += (uint64_t)page.usedWidth * page.usedHeight;
+	}
+	return total > 0 ? (float)((double)used / total) : 0.f;
+}
+
+std::vector<uint8_t> AtlasPacker::renderPage(uint32_t pageIdx) const {
+	auto& page = mPages.at(pageIdx);
+	std::vector<uint8_t> pixels(page.usedWidth * page.usedHeight * 4, 0);
+
+	const int padding = mSettings.padding;
+
+	for (auto&& image : mImages) {
+		auto& p = image.placement;
+		if (p.page != pageIdx) {
+			continue;
+		}
+
+		const int w = p.width, h = p.height;
+
+		//fill the padding too by clamping to the border of the image
+		for (int dy = -padding; dy < h + padding; ++dy) {
+			auto cy = std::min(std::max(dy, 0), h - 1);
+			auto out = pixels.data() + ((p.y + dy) * page.usedWidth + p.x - padding) * 4;
+
+			for (int dx = -padding; dx < w + padding; ++dx, out += 4) {
+				auto cx = std::min(std::max(dx, 0), w - 1);
+
+				//rotated images are stored turned clockwise
+				auto u = p.rotated ? cy : cx;
+				auto v = p.rotated ? w - 1 - cx : cy;
+
+				auto in = image.rgba.data() + ((p.trimY + v) * image.width + p.trimX + u) * 4;
+				memcpy(out, in, 4);
+			}
+		}
+	}
+
+	return pixels;
+}
+
+bool AtlasPacker::packFolder(utf::string_view folder, utf::string_view outputFolder, utf::string_view outputName, const Settings& settings) {
+	DEBUG_ASSERT(folder.not_empty() and outputFolder.not_empty() and outputName.not_empty(), "Invalid paths");
+
+	std::vector<utf::string> paths;
+	Platform::singleton().getFilePathsForType("png", folder, paths);
+	Platform::singleton().getFilePathsForType("jpg", folder, paths);
+
+	AtlasPacker packer(settings);
+	std::vector<utf::string_view> setNames;
+	utf::string_view lastName;
+
+	for (auto&& path : paths) {
+		auto name = Path::getFileName(path);
+
+		if (Path::getVersion(name) != 0) {
+			continue;
+		}
+
+		//same sequence rules as ResourceGroup::addSets
+		if (lastName.empty() or not Path::arePathsInSequence(lastName, name)) {
+			setNames.push_back(Path::removeTags(name));
+		}
+		lastName = name;
+
+		std::vector<uint8_t> rgba;
+		uint32_t width, height;
+		if (readImage(path, rgba, width, height) == PixelFormat::Unknown) {
+			DEBUG_MESSAGE("Cannot read " + path);
+			return false;
+		}
+
+		packer.add(std::move(rgba), width, height, static_cast<int>(setNames.size() - 1));
+	}
+
+	if (not packer.pack()) {
+		DEBUG_MESSAGE("Some sequences in " + folder + " don't fit in a single page, use a bigger pageSize");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < packer.getPageCount(); ++i) {
+		//no _N suffix, or addSets would take the pages for a sequence
+		auto pagePath = outputFolder + '/' + outputName + "_page" + utf::to_string(i) + ".png";
+		if (not Platform::singleton().saveImageFile(pagePath, packer.renderPage(i), packer.getPageWidth(i), packer.getPageHeight(i))) {
+			DEBUG_MESSAGE("Cannot write " + pagePath);
+			return false;
+		}
+	}
+
+	Table def;
+	for (size_t set = 0; set < setNames.size(); ++set) {
+		auto& sub = def.createTable();
+		sub.set("name", setNames[set]);
+
+		auto& tiles = sub.createTable("tiles");
+		for (uint32_t i = 0; i < packer.getImageCount(); ++i) {
+			if (packer.mImages[i].group != static_cast<int>(set)) {
+				continue;
+			}
+
+			auto& p = packer.getPlacement(i);
+			sub.set("texture", outputName + "_page" + utf::to_string(p.page));
+
+			//x y width height [rotated trimX trimY originalWidth originalHeight], see FrameSet::setAtlas
+			auto& tile = tiles.createTable();
+			tile.push((int)p.x);
+			tile.push((int)p.y);
+			tile.push((int)(p.rotated ? p.height : p.width));
+			tile.push((int)(p.rotated ? p.width : p.height));
+			tile.push(p.rotated);
+			tile.push((int)p.trimX);
+			tile.push((int)p.trimY);
+			tile.push((int)p.originalWidth);
+			tile.push((int)p.originalHeight);
+		}
+	}
+
+	Platform::singleton().save(def, outputFolder + '/' + outputName + ".atlasinfo");
+
+	DEBUG_MESSAGE(outputName + ": " + utf::to_string(packer.getImageCount()) + " images in " + utf::to_string(packer.getPageCount()) + " pages, "
+		+ utf::to_string((int)(packer.getEfficiency() * 100)) + "% efficiency");
+	return true;
+}
@@ -1,16 +1,22 @@
 #include "BackgroundWorker.h"
 
 #include "Platform.h"
+#include "SpinLock.h"
 
 using namespace Dojo;
 
 BackgroundWorker::BackgroundWorker(bool async, bool allowMultipleProducers) :
 	mRunning(false),
 	mCompletedQueue(make_unique<SPSCQueue<AsyncJob>>()),
-	mQueue(make_unique<SPSCQueue<AsyncJob>>()),
 	isAsync(async),
-	allowMultipleProducers(allowMultipleProducers),
-	mAvailableTasksSemaphore(0) {
+	allowMultipleProducers(allowMultipleProducers) {
+
+	if (allowMultipleProducers) {
+		mSharedQueue = make_unique<MPSCQueue<AsyncJob>>();
+	}
+	else {
+		mQueue = make_unique<SPSCQueue<AsyncJob>>();
+	}
 
 	if (isAsync) {
 		startAsync();
@@ -26,28 +32,56 @@ BackgroundWorker::~BackgroundWorker() {
 	}
 }
 
+bool BackgroundWorker::_tryDequeue(AsyncJob& job) {
+	return mSharedQueue ? mSharedQueue->try_dequeue(job) : mQueue->try_dequeue(job);
+}
+
 AsyncJob BackgroundWorker::_waitForNextTask() {
 	AsyncJob job;
 
 	if (isAsync) {
 		//TODO try work-stealing here
-	// 	if(not mQueue->try_dequeue(job)) {
-	//      teek jerbs
-	// 	}
 
-		do {
-			mAvailableTasksSemaphore.wait();
+		//spin for a short while before sleeping, tasks tend to come in bursts
+		Backoff backoff;
+		bool parked = false;
+		while (mRunning) {
+			if (_tryDequeue(job)) {
+#ifndef PUBLISH
+				//measure how long the job that woke up this thread waited for it
+				if (parked) {
+					auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+					mWakeNanoseconds.fetch_add(std::max<int64_t>(now - mLastQueueTime.load(std::memory_order_relaxed), 0), std::memory_order_relaxed);
+					mWakeups.fetch_add(1, std::memory_order_relaxed);
+				}
+#endif
+				return job;
+			}
 
-			//the thread was killed while sleeping, return nothing
-			if (not mRunning) {
-				return{};
+			if (backoff.isSpinning()) {
+				backoff.pause();
+				continue;
 			}
 
-		} while (not mQueue->try_dequeue(job)); //it's not sure that a job will be there, condition_variable has spurious wakeups
+			//check again after announcing the wait, so that a job queued in the meantime isn't missed
+			auto key = mAvailableTasksEvent.prepareWait();
+			if (_tryDequeue(job)) {
+				mAvailableTasksEvent.cancelWait();
+				return job;
+			}
 
-		return job;
+			//the thread was killed, return nothing
+			if (not mRunning) {
+				mAvailableTasksEvent.cancelWait();
+				break;
+			}
+
+			mAvailableTasksEvent.wait(key);
+			parked = true;
+		}
+		return{};
 	}
-	else if(mQueue->try_dequeue(job)) { //just try to get one and return
+	else if(_tryDequeue(job)) { //just try to get one and return
 		return job;
 	}
 
@@ -76,23 +110,41 @@ void BackgroundWorker::startAsync() {
 	mThread = std::thread([this] {
 		while(mRunning) {
 			runNextTask();
-
-			std::this_thread::yield(); //go easy on the CPU, these tasks aren't priority anyway
 		}
 	});
 }
 
 void BackgroundWorker::queueJob(AsyncJob&& job) {
-	if (not allowMultipleProducers) {
-		mQueueLock.lock();
+#ifndef PUBLISH
+	auto startTime = std::chrono::high_resolution_clock::now();
+	mLastQueueTime.store(std::chrono::duration_cast<std::chrono::nanoseconds>(startTime.time_since_epoch()).count(), std::memory_order_relaxed);
+#endif
+
+	if (mSharedQueue) {
+		mSharedQueue->enqueue(std::move(job));
 	}
-	mQueue->enqueue(std::move(job));
-	mAvailableTasksSemaphore.notifyOne();
-	
-	if(not allowMultipleProducers) {
-		mQueueLock.unlock();
+	else {
+		//jobs can be queued from any thread, even by other jobs, but the SPSCQueue only takes one producer at a time
+		std::lock_guard<AdaptiveMutex> lock(mQueueLock);
+		mQueue->enqueue(std::move(job));
 	}
+	mAvailableTasksEvent.notifyOne();
+
+#ifndef PUBLISH
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - startTime);
+	mQueueNanoseconds.fetch_add(elapsed.count(), std::memory_order_relaxed);
+	mQueuedJobs.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+#ifndef PUBLISH
+void BackgroundWorker::_addStats(WorkerPool::Stats& stats) const {
+	stats.queuedJobs += mQueuedJobs.load(std::memory_order_relaxed);
+	stats.queueTime += mQueueNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+	stats.wakeups += mWakeups.load(std::memory_order_relaxed);
+	stats.wakeTime += mWakeNanoseconds.load(std::memory_order_relaxed) * 1e-9;
 }
+#endif
 
 void BackgroundWorker::stop() {
 	DEBUG_ASSERT(isAsync, "Cannot stop a synchronous worker");
@@ -103,7 +155,7 @@ void BackgroundWorker::stop() {
 		mRunning = false;
 
 		//wake up the thread so it can kill itself (muahah)
-		mAvailableTasksSemaphore.notifyOne();
+		mAvailableTasksEvent.notifyAll();
 
 		mThread.join();
 	}
@@ -0,0 +1,154 @@
+#include "DirectoryCache.h"
+
+#include "Path.h"
+#include "Timer.h"
+#include "File.h"
+
+using namespace Dojo;
+
+namespace {
+	const char* ManifestHeader = "dojo-manifest 1";
+
+	std::string toKey(utf::string_view str) {
+		return{ str.data(), str.byte_size() };
+	}
+}
+
+DirectoryCache::DirectoryCache(Scanner scanner) :
+	mScanner(std::move(scanner)) {
+	DEBUG_ASSERT(mScanner, "Invalid scanner");
+}
+
+DirectoryCache::FilesByExtension& DirectoryCache::_add(std::string folder) {
+	mFolderOrder.emplace_back(folder);
+	return mFolders[std::move(folder)];
+}
+
+void DirectoryCache::_addFile(FilesByExtension& folder, utf::string path) {
+	auto name = Path::getFileName(path);
+	auto version = Path::getVersion(name);
+	auto tag = Path::getTag(name);
+
+	auto& files = folder[toKey(Path::getFileExtension(path))];
+	files.push_back({ std::move(path), version, tag });
+}
+
+void DirectoryCache::getFiles(utf::string_view folder, utf::string_view extension, std::vector<File>& out) {
+	auto key = toKey(Path::makeCanonical(folder));
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	++mStats.queries;
+
+	auto elem = mFolders.find(key);
+	if (elem == mFolders.end()) {
+		Timer timer;
+
+		std::vector<utf::string> paths;
+		mScanner(folder, paths);
+
+		auto& files = _add(key);
+		for (auto&& path : paths) {
+			_addFile(files, std::move(path));
+		}
+
+		++mStats.scannedFolders;
+		mStats.scannedFiles += (uint32_t)paths.size();
+		mStats.scanTime += (float)timer.getElapsedTime();
+
+		elem = mFolders.find(key);
+	}
+
+	auto files = elem->second.find(toKey(extension));
+	if (files != elem->second.end()) {
+		out.insert(out.end(), files->second.begin(), files->second.end());
+	}
+}
+
+bool DirectoryCache::loadManifest(utf::string_view path, utf::string_view root) {
+	Timer timer;
+
+	Dojo::File file(path);
+	if (not file.open(Stream::Access::Read)) {
+		return false;
+	}
+
+	std::string content((size_t)file.getSize(), 0);
+	file.readToFill(content);
+	file.close();
+
+	std::istringstream lines(content);
+	std::string line;
+	if (not std::getline(lines, line) or line != ManifestHeader) {
+		return false;
+	}
+
+	auto prefix = Path::makeCanonical(root);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	//each folder is a line starting with > followed by the paths of its files relative to the root
+	FilesByExtension* current = nullptr;
+	while (std::getline(lines, line)) {
+		if (line.empty()) {
+			continue;
+		}
+
+		if (line[0] == '>') {
+			auto folder = line.substr(1);
+			if (mFolders.count(folder)) {
+				current = nullptr; //already scanned in this run, the manifest could be older
+				continue;
+			}
+
+			current = &_add(std::move(folder));
+			++mStats.manifestFolders;
+		}
+		else if (current) {
+			_addFile(*current, prefix + utf::string{ line.data() });
+		}
+	}
+
+	mStats.manifestTime += (float)timer.getElapsedTime();
+	return true;
+}
+
+bool DirectoryCache::saveManifest(utf::string_view path, utf::string_view root) const {
+	auto prefix = toKey(Path::makeCanonical(root));
+
+	std::string content = ManifestHeader;
+	content += '\n';
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		for (auto&& folder : mFolderOrder) {
+			content += '>' + folder + '\n';
+			for (auto&& extension : mFolders.at(folder)) {
+				for (auto&& f : extension.second) {
+					auto filePath = toKey(Path::makeCanonical(f.path, true));
+					DEBUG_ASSERT(filePath.compare(0, prefix.size(), prefix) == 0, "The file is not inside the root");
+					content += filePath.substr(prefix.size()) + '\n';
+				}
+			}
+		}
+	}
+
+	Dojo::File file(path);
+	if (not file.open(Stream::Access::WriteOnly)) {
+		return false;
+	}
+
+	file.write((uint8_t*)content.data(), (int)content.size());
+	file.close();
+	return true;
+}
+
+void DirectoryCache::clear() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mFolders.clear();
+	mFolderOrder.clear();
+}
+
+DirectoryCache::Stats DirectoryCache::getStats() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
@@ -32,13 +32,14 @@ FT_Stroker FontSystem::getStroker(float width) {
 }
 
 FT_Face FontSystem::_createFaceForFile(utf::string_view fileName) {
-	auto buf = Platform::singleton().loadFileContent(fileName);
+	//FreeType reads glyphs on demand, so the font is accessed randomly for its whole life
+	auto file = make_unique<MappedFile>(fileName, MappedFile::AccessHint::Random);
 
 	//create new face from memory - loading from memory is needed for zip loading
 	FT_Face face;
-	auto err = FT_New_Memory_Face(freeType, (FT_Byte*)buf.data(), static_cast<FT_Long>(buf.size()), 0, &face);
+	auto err = FT_New_Memory_Face(freeType, (const FT_Byte*)file->data(), static_cast<FT_Long>(file->size()), 0, &face);
 	faceMap.emplace(fileName.copy(), face);
-	ownedBuffers.emplace_back(std::move(buf)); //keep the memory
+	ownedFiles.emplace_back(std::move(file)); //keep the memory
 
 	DEBUG_ASSERT_INFO(err == 0, "FreeType could not load a Font file", "path = " + fileName);
 
@@ -35,19 +35,27 @@ void FrameSet::setAtlas(const Table& atlasTable, ResourceGroup& atlasTextureProv
 
 	auto& tiles = atlasTable.getTable("tiles");
 
-	int x, y, sx, sy;
-
 	for (int i = 0; i < tiles.getArrayLength(); ++i) {
 		auto& tile = tiles.getTable(i);
 
-		x = tile.getInt(0);
-		y = tile.getInt(1);
-		sx = tile.getInt(2);
-		sy = tile.getInt(3);
+		//{x y width height} optionally followed by {rotated trimX trimY originalWidth originalHeight}
+		Texture::AtlasTile area;
+		area.x = tile.getInt(0);
+		area.y = tile.getInt(1);
+		area.width = tile.getInt(2);
+		area.height = tile.getInt(3);
+
+		if (tile.getArrayLength() >= 9) {
+			area.rotated = tile.getBool(4);
+			area.trimX = tile.getInt(5);
+			area.trimY = tile.getInt(6);
+			area.originalWidth = tile.getInt(7);
+			area.originalHeight = tile.getInt(8);
+		}
 
 		auto tiletex = make_unique<Texture>();
 
-		tiletex->loadFromAtlas(atlas, x, y, sx, sy);
+		tiletex->loadFromAtlas(atlas, area);
 
 		addTexture(std::move(tiletex));
 	}
@@ -77,8 +85,14 @@ bool FrameSet::onLoad() {
 void FrameSet::onUnload(bool soft) {
 	DEBUG_ASSERT(loaded, "onUnload: this FrameSet is not loaded");
 
+	size = 0;
 	for (auto&& f : ownedFrames) {
 		f->onUnload(soft);
+
+		//non-reloadable frames survive a soft unload
+		if (f->isLoaded()) {
+			size += f->getByteSize();
+		}
 	}
 
 	loaded = false;
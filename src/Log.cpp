@@ -2,28 +2,189 @@
 #include "Platform.h"
 #include "BackgroundWorker.h"
 #include "LogListener.h"
+#include "SpinLock.h"
 
 using namespace Dojo;
 
-void Dojo::Log::_append(utf::string_view message, LogEntry::Level level) {
-	mOutput.emplace_back(LogEntry(message.copy(), level));
+Log::Log(uint32_t maxLines /*= 1024*/) :
+	mOutput(maxLines),
+	mRunning(true) {
+	DEBUG_ASSERT(maxLines > 0, "Cannot create a Log with 0 or less lines");
 
-	if (mOutput.size() == mMaxLines) {
-		mOutput.erase(mOutput.begin());
-	}
+	mThread = std::thread([this] {
+		_run();
+	});
+}
+
+Log::~Log() {
+	flush();
 
-	_fireOnLogUpdated(getLastMessage());
+	mRunning = false;
+	mRecordsEvent.notifyAll();
+	mThread.join();
 }
 
 ///appends another message to the log, with an optional severity level
 void Dojo::Log::append(utf::string_view message, LogEntry::Level level /*= LogEntry::EL_WARNING*/) {
-	std::lock_guard<std::mutex> lock(mAppendMutex);
+	Record record(level);
+	if (message.byte_size() <= InlineTextSize) {
+		memcpy(record.inlineText, message.data(), message.byte_size());
+		record.inlineLength = static_cast<uint16_t>(message.byte_size());
+	}
+	else {
+		record.text = message.copy();
+	}
+	_push(std::move(record));
+}
+
+void Log::_push(Record&& record) {
+	auto level = record.level;
+
+	mRecords.enqueue(std::move(record));
+	mRecordsEvent.notifyOne();
+
+	//make sure that errors are out before the program has a chance to die
+	if (level >= LogEntry::EL_ERROR) {
+		flush();
+	}
+}
+
+void Log::flush() {
+	//a listener that logs would wait for itself
+	if (std::this_thread::get_id() == mThread.get_id()) {
+		return;
+	}
+
+	Semaphore flushed(0);
+	Record marker;
+	marker.flushed = &flushed;
+	mRecords.enqueue(std::move(marker));
+	mRecordsEvent.notifyOne();
+
+	flushed.wait();
+}
+
+void Log::addListener(LogListener& l) {
+	std::lock_guard<AdaptiveMutex> lock(mListenersMutex);
+	pListeners.emplace(&l);
+}
+
+void Log::removeListener(LogListener& l) {
+	std::lock_guard<AdaptiveMutex> lock(mListenersMutex);
+	pListeners.erase(&l);
+}
+
+LogEntry Log::getLastMessage() {
+	std::lock_guard<AdaptiveMutex> lock(mOutputMutex);
+	DEBUG_ASSERT(not mOutput.empty(), "The Log is empty");
+
+	auto& last = mOutput.back();
+	return{ last.text, last.level, last.timestamp };
+}
+
+std::vector<LogEntry> Log::getHistory() {
+	std::lock_guard<AdaptiveMutex> lock(mOutputMutex);
 
-	_append(message, level);
+	std::vector<LogEntry> history;
+	history.reserve(mOutput.size());
+	for (auto&& entry : mOutput) {
+		history.emplace_back(entry.text, entry.level, entry.timestamp);
+	}
+	return history;
 }
 
-void Log::_fireOnLogUpdated(const LogEntry& e) {
+void Log::_run() {
+	Record record;
+	Backoff backoff;
+	while (true) {
+		if (mRecords.try_dequeue(record)) {
+			_dispatch(record);
+			backoff.reset();
+			continue;
+		}
+
+		if (backoff.isSpinning()) {
+			backoff.pause();
+			continue;
+		}
+
+		auto key = mRecordsEvent.prepareWait();
+		if (mRecords.try_dequeue(record)) {
+			mRecordsEvent.cancelWait();
+			_dispatch(record);
+			backoff.reset();
+			continue;
+		}
+
+		if (not mRunning) {
+			mRecordsEvent.cancelWait();
+			break;
+		}
+
+		mRecordsEvent.wait(key);
+	}
+}
+
+void Log::_dispatch(Record& record) {
+	if (record.flushed) {
+		//the queue is only ordered per thread, so records of other threads appended before the flush might still be queued
+		auto flushed = record.flushed;
+		record.flushed = nullptr;
+		while (mRecords.try_dequeue(record)) {
+			_dispatch(record);
+		}
+
+		flushed->notifyOne();
+		return;
+	}
+
+	utf::string text;
+	if (record.format) {
+		text = _format(record);
+	}
+	else if (record.inlineLength > 0) {
+		text = utf::string(record.inlineText, record.inlineLength);
+	}
+	else {
+		text = std::move(record.text);
+	}
+
+	LogEntry* entry;
+	{
+		std::lock_guard<AdaptiveMutex> lock(mOutputMutex);
+		mOutput.emplace(std::move(text), record.level, record.timestamp);
+		entry = &mOutput.back();
+	}
+
+	//the entry can't be overwritten while the listeners run, only this thread writes the history
+	std::lock_guard<AdaptiveMutex> lock(mListenersMutex);
 	for (auto&& listener : pListeners) {
-		listener->onLogUpdated(self, getLastMessage());
+		listener->onLogUpdated(self, *entry);
+	}
+}
+
+utf::string Log::_format(const Record& record) {
+	std::string result;
+	uint8_t nextArg = 0;
+	for (auto c = record.format; *c; ++c) {
+		if (c[0] == '{' and c[1] == '}' and nextArg < record.argCount) {
+			auto& arg = record.args[nextArg++];
+			switch (arg.type) {
+			case Arg::Type::Int:
+				result += std::to_string(arg.i);
+				break;
+			case Arg::Type::UInt:
+				result += std::to_string(arg.u);
+				break;
+			case Arg::Type::Float:
+				result += std::to_string(arg.f);
+				break;
+			}
+			++c;
+		}
+		else {
+			result += *c;
+		}
 	}
+	return utf::string{ result.data() };
 }
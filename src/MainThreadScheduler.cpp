@@ -0,0 +1,149 @@
+#include "MainThreadScheduler.h"
+
+using namespace Dojo;
+
+const float MainThreadScheduler::MinimumBudget = 0.001f;
+
+void MainThreadScheduler::addSource(const void* owner, Priority priority, const char* site, Source source) {
+	DEBUG_ASSERT(owner, "A source needs an owner");
+	DEBUG_ASSERT(site, "A source needs a site");
+	DEBUG_ASSERT(source, "Invalid source");
+
+	SourceEntry entry;
+	entry.owner = owner;
+	entry.priority = priority;
+	entry.site = site;
+	entry.source = std::move(source);
+	entry.lastPolledFrame = mFrame;
+	mSources.emplace_back(std::move(entry));
+}
+
+void MainThreadScheduler::removeSource(const void* owner) {
+	for (auto&& entry : mSources) {
+		if (entry.owner == owner) {
+			//sources can be removed by a callback while the scheduler is running, so they are only erased at the end of run()
+			entry.owner = nullptr;
+			entry.source = {};
+		}
+	}
+
+	if (not mRunning) {
+		_eraseRemovedSources();
+	}
+}
+
+void MainThreadScheduler::_eraseRemovedSources() {
+	mSources.erase(std::remove_if(mSources.begin(), mSources.end(), [](const SourceEntry& e) {
+		return e.owner == nullptr;
+	}), mSources.end());
+}
+
+void MainThreadScheduler::schedule(Priority priority, const char* site, AsyncCallback callback) {
+	DEBUG_ASSERT(callback, "Cannot schedule an empty callback");
+	mScheduled[(int)priority].push_back({ site, std::move(callback), mFrame });
+}
+
+float MainThreadScheduler::getEstimatedCost(const char* site) const {
+	auto elem = mSiteCosts.find(site);
+	return elem != mSiteCosts.end() ? elem->second.average : 0.f;
+}
+
+void MainThreadScheduler::_runScheduled(Priority priority, float budget, const Timer& timer) {
+	auto p = (int)priority;
+	auto& queue = mScheduled[p];
+
+	while (queue.size()) {
+		auto& next = queue.front();
+		auto& estimate = mSiteCosts[next.site];
+
+		auto remaining = budget - (float)timer.getElapsedTime();
+		if (priority != Priority::Urgent and mFrame - next.frame < MaxDeferredFrames and estimate.average > remaining) {
+			mStats.deferred[p] += static_cast<uint32_t>(queue.size());
+			mStats.maxWaitFrames[p] = static_cast<uint32_t>(mFrame - next.frame);
+			return;
+		}
+
+		auto callback = std::move(next.callback);
+		queue.pop_front();
+
+		Timer cost;
+		callback();
+		estimate.add((float)cost.getElapsedTime());
+
+		++mStats.executed[p];
+	}
+}
+
+void MainThreadScheduler::_runSources(Priority priority, float budget, const Timer& timer) {
+	auto p = (int)priority;
+
+	//round robin between the sources until none of them has anything that fits
+	bool ranAny = true;
+	while (ranAny) {
+		ranAny = false;
+
+		//sources can be added while running, only visit the ones that were there at the start
+		auto count = mSources.size();
+		for (size_t i = 0; i < count; ++i) {
+			if (mSources[i].priority != priority or not mSources[i].source) {
+				continue;
+			}
+
+			auto& estimate = mSiteCosts[mSources[i].site];
+			auto remaining = budget - (float)timer.getElapsedTime();
+			if (priority != Priority::Urgent and mFrame - mSources[i].lastPolledFrame < MaxDeferredFrames and estimate.average > remaining) {
+				//the round robin visits the same source again after each pass that ran something
+				if (mSources[i].lastDeferredFrame != mFrame) {
+					mSources[i].lastDeferredFrame = mFrame;
+					++mStats.deferred[p];
+				}
+				continue;
+			}
+
+			mSources[i].lastPolledFrame = mFrame;
+
+			Timer cost;
+			auto source = mSources[i].source; //the source can be removed by its own callback
+			if (source()) {
+				estimate.add((float)cost.getElapsedTime());
+				++mStats.executed[p];
+				ranAny = true;
+			}
+		}
+	}
+}
+
+void MainThreadScheduler::run(float availableTime) {
+	DEBUG_ASSERT(not mRunning, "The scheduler can't be run recursively");
+
+	++mFrame;
+
+	//give more time to each frame in a row that couldn't finish its work, until the backlog clears
+	auto minimum = MinimumBudget * (1 << std::min(mStats.starvedFrames, 4u));
+	auto budget = std::max(availableTime, minimum);
+
+	auto starved = mStats.starvedFrames;
+	auto totalStarved = mStats.totalStarvedFrames;
+	mStats = {};
+	mStats.budget = budget;
+
+	mRunning = true;
+	Timer timer;
+
+	for (uint32_t p = 0; p < PriorityCount; ++p) {
+		_runScheduled((Priority)p, budget, timer);
+		_runSources((Priority)p, budget, timer);
+	}
+
+	mRunning = false;
+	_eraseRemovedSources();
+
+	mStats.used = (float)timer.getElapsedTime();
+
+	bool leftover = false;
+	for (auto&& deferred : mStats.deferred) {
+		leftover |= deferred > 0;
+	}
+	mStats.starvedFrames = leftover ? starved + 1 : 0;
+	mStats.totalStarvedFrames = totalStarved + (leftover ? 1 : 0);
+}
@@ -0,0 +1,152 @@
+#ifdef PLATFORM_WIN32
+#include "dojo_win_header.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+#include "Platform.h"
+#include "FileStream.h"
+#include "dojostring.h"
+
+using namespace Dojo;
+
+MappedFile::MappedFile(utf::string_view path, AccessHint hint /*= AccessHint::Sequential*/) {
+	mOpen = _map(path, hint) or _readBuffered(path);
+}
+
+MappedFile::~MappedFile() {
+	_unmap();
+}
+
+bool MappedFile::_readBuffered(utf::string_view path) {
+	auto file = Platform::singleton().getFile(path);
+	if (not file or not file->open(Stream::Access::Read)) {
+		return false;
+	}
+
+	//files that an archive already has in memory don't need to be read at all
+	auto content = file->getContentInPlace(mContentOwner);
+	if (mContentOwner) {
+		mData = content.data();
+		mSize = content.size();
+		return true;
+	}
+
+	mBuffer.resize((size_t)file->getSize());
+	mBuffer.resize((size_t)file->read(mBuffer.data(), mBuffer.size()));
+
+	mData = mBuffer.data();
+	mSize = mBuffer.size();
+	return true;
+}
+
+#ifdef PLATFORM_WIN32
+
+bool MappedFile::_map(utf::string_view path, AccessHint hint) {
+	auto flags = hint == AccessHint::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+	auto file = CreateFileW(String::toUTF16(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (not GetFileSizeEx(file, &size) or (uint64_t)size.QuadPart < MinMappedSize or (uint64_t)size.QuadPart > SIZE_MAX) {
+		CloseHandle(file);
+		return false;
+	}
+
+	auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (not mapping) {
+		CloseHandle(file);
+		return false;
+	}
+
+	auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (not view) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFileHandle = file;
+	mMappingHandle = mapping;
+	mMapping = view;
+	mData = (const uint8_t*)view;
+	mSize = (size_t)size.QuadPart;
+	return true;
+}
+
+void MappedFile::_unmap() {
+	if (mMapping) {
+		UnmapViewOfFile(mMapping);
+		CloseHandle(mMappingHandle);
+		CloseHandle(mFileHandle);
+		mMapping = mMappingHandle = mFileHandle = nullptr;
+	}
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const {
+	//FILE_FLAG_SEQUENTIAL_SCAN already reads ahead, and PrefetchVirtualMemory isn't available on every supported Windows
+}
+
+#else
+
+bool MappedFile::_map(utf::string_view path, AccessHint hint) {
+	auto fd = open(path.copy().bytes().c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 or (uint64_t)info.st_size < MinMappedSize) {
+		close(fd);
+		return false;
+	}
+
+	auto view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	//the mapping keeps the file alive on its own
+	close(fd);
+
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	madvise(view, (size_t)info.st_size, hint == AccessHint::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+
+	mMapping = view;
+	mData = (const uint8_t*)view;
+	mSize = (size_t)info.st_size;
+
+	//sequential loads are going to read everything right away
+	if (hint == AccessHint::Sequential) {
+		prefetch(0, mSize);
+	}
+	return true;
+}
+
+void MappedFile::_unmap() {
+	if (mMapping) {
+		munmap(mMapping, mSize);
+		mMapping = nullptr;
+	}
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const {
+	if (not mMapping or offset >= mSize) {
+		return;
+	}
+
+	//madvise wants a page-aligned address
+	static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	auto start = offset & ~(pageSize - 1);
+	auto end = std::min(offset + size, mSize);
+	madvise((uint8_t*)mMapping + start, end - start, MADV_WILLNEED);
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "Mesh.h"
 
 #include "Platform.h"
+#include "MappedFile.h"
 #include "Shader.h"
 #include "dojomath.h"
 #include "PrimitiveMode.h"
@@ -183,7 +184,7 @@ Mesh::IndexType Mesh::vertex(const Vector& v) {
 	return getVertexCount() - 1;
 }
 
-void Mesh::appendRawVertexData(void* data, IndexType count) {
+void Mesh::appendRawVertexData(const void* data, IndexType count, const AABB& newBounds /*= AABB::Invalid*/) {
 	int blobSize = count * vertexSize;
 	auto oldSize = vertices.size();
 
@@ -192,11 +193,21 @@ void Mesh::appendRawVertexData(void* data, IndexType count) {
 	auto start = vertices.data() + oldSize;
 	memcpy(start, data, blobSize);
 
-	//TODO max and min??
+	bounds = bounds.expandToFit(newBounds);
 
 	vertexCount += count;
 }
 
+void Mesh::appendRawIndexData(const void* data, int count) {
+	DEBUG_ASSERT(isEditing(), "appendRawIndexData: this Mesh is not in Edit mode");
+
+	auto oldSize = indices.size();
+	indices.resize(oldSize + count * indexSize);
+	memcpy(indices.data() + oldSize, data, count * indexSize);
+
+	indexCount += count;
+}
+
 int Mesh::getPrimitiveCount() const {
 	auto elemCount = isIndexed() ? getIndexCount() : getVertexCount();
 
@@ -340,12 +351,12 @@ bool Mesh::onLoad() {
 		return false;
 	}
 
-	//load binary mesh
-	auto buf = Platform::singleton().loadFileContent(filePath);
+	//load binary mesh, reading straight from the mapped file
+	MappedFile file(filePath);
 
-	DEBUG_ASSERT_INFO(buf.size() > 0, "onLoad: cannot find or read file", "path = " + filePath);
+	DEBUG_ASSERT_INFO(file.size() > 0, "onLoad: cannot find or read file", "path = " + filePath);
 
-	uint8_t* ptr = buf.data();
+	auto ptr = file.data();
 
 	//index size
 	setIndexByteSize(*ptr++);
@@ -370,11 +381,11 @@ bool Mesh::onLoad() {
 	ptr += sizeof(Vector);
 
 	//vertex count
-	IndexType vc = *((IndexType*)ptr);
+	IndexType vc = *((const IndexType*)ptr);
 	ptr += sizeof(IndexType);
 
 	//index count
-	uint32_t ic = *((uint32_t*)ptr);
+	uint32_t ic = *((const uint32_t*)ptr);
 	ptr += sizeof(uint32_t);
 
 	setDynamic(false);
@@ -0,0 +1,69 @@
+#include "MipGenerator.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define DOJO_MIPGEN_SSE2
+	#include <emmintrin.h>
+#endif
+
+using namespace Dojo;
+
+uint32_t MipGenerator::getLevelCount(uint32_t width, uint32_t height) {
+	uint32_t levels = 1;
+	for (auto size = std::max(width, height); size > 1; size >>= 1) {
+		++levels;
+	}
+	return levels;
+}
+
+static void _boxFilterPixel(const uint8_t* a, const uint8_t* b, const uint8_t* c, const uint8_t* d, uint8_t* out) {
+	for (int i = 0; i < 4; ++i) {
+		out[i] = (uint8_t)((a[i] + b[i] + c[i] + d[i] + 2) >> 2);
+	}
+}
+
+void MipGenerator::downsampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dest) {
+	DEBUG_ASSERT(src and dest, "Invalid image buffers");
+	DEBUG_ASSERT(srcWidth > 1 or srcHeight > 1, "This image is already the smallest level");
+
+	const auto destWidth = getLevelSize(srcWidth, 1);
+	const auto destHeight = getLevelSize(srcHeight, 1);
+	const auto srcStride = srcWidth * 4;
+
+	for (uint32_t y = 0; y < destHeight; ++y) {
+		//odd sizes just drop the last row/column; 1-pixel sides sample the same row/column twice
+		auto row0 = src + std::min(y * 2, srcHeight - 1) * srcStride;
+		auto row1 = src + std::min(y * 2 + 1, srcHeight - 1) * srcStride;
+		auto out = dest + y * destWidth * 4;
+
+		uint32_t x = 0;
+
+		if (srcWidth > 1) {
+#ifdef DOJO_MIPGEN_SSE2
+			//2 destination pixels per iteration, summing the 4 source pixels in 16 bit lanes
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i round = _mm_set1_epi16(2);
+			for (; x + 2 <= destWidth and (x + 2) * 2 <= srcWidth; x += 2) {
+				__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+				__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+				lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+				hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+				__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+				_mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(sum, zero));
+			}
+#endif
+			for (; x < destWidth; ++x) {
+				auto x0 = x * 2 * 4;
+				auto x1 = std::min(x * 2 + 1, srcWidth - 1) * 4;
+				_boxFilterPixel(row0 + x0, row0 + x1, row1 + x0, row1 + x1, out + x * 4);
+			}
+		}
+		else {
+			_boxFilterPixel(row0, row0, row1, row1, out);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#include "PackStream.h"
+
+#include "AssetPack.h"
+
+using namespace Dojo;
+
+PackStream::PackStream(utf::string_view path, std::shared_ptr<AssetPack> pack, utf::string_view internalPath) :
+	FileStream(path),
+	mPack(std::move(pack)),
+	mInternalPath(internalPath.copy()) {
+	DEBUG_ASSERT(mPack, "Invalid pack");
+}
+
+PackStream::~PackStream() {
+	if (isOpen()) {
+		close();
+	}
+}
+
+Stream::Access PackStream::getAccess() {
+	return mAccess;
+}
+
+bool PackStream::open(Access accessType) {
+	DEBUG_ASSERT(not isOpen(), "The file was already open");
+
+	if (accessType != Access::Read) {
+		return false;
+	}
+
+	auto entry = mPack->find(mInternalPath);
+	if (entry.is_none()) {
+		return false;
+	}
+
+	mContent = mPack->getContent(entry.unwrap(), mContentOwner);
+	if (not mContentOwner) {
+		return false;
+	}
+
+	mPosition = 0;
+	mAccess = Access::Read;
+	return true;
+}
+
+void PackStream::close() {
+	mContent = {};
+	mContentOwner = {};
+	mPosition = 0;
+	mAccess = Access::BadFile;
+}
+
+int64_t PackStream::getSize() {
+	DEBUG_ASSERT(isReadable(), "The file must be readable to get its size");
+
+	return (int64_t)mContent.size();
+}
+
+int64_t PackStream::getCurrentPosition() {
+	DEBUG_ASSERT(isOpen(), "The file must be open");
+
+	return mPosition;
+}
+
+int PackStream::seek(int64_t offset, int64_t fromWhere /*= SEEK_SET*/) {
+	DEBUG_ASSERT(isOpen(), "The file must be open");
+
+	int64_t target;
+	switch (fromWhere) {
+	case SEEK_SET:
+		target = offset;
+		break;
+	case SEEK_CUR:
+		target = mPosition + offset;
+		break;
+	case SEEK_END:
+		target = getSize() + offset;
+		break;
+	default:
+		FAIL("Invalid seek origin");
+	}
+
+	if (target < 0 or target > getSize()) {
+		return -1;
+	}
+
+	mPosition = target;
+	return 0;
+}
+
+int64_t PackStream::read(uint8_t* buf, int64_t number) {
+	DEBUG_ASSERT(isReadable(), "The file must be open and readable");
+	DEBUG_ASSERT(number >= 0, "Invalid read size");
+
+	number = std::min(number, getSize() - mPosition);
+	memcpy(buf, mContent.data() + mPosition, (size_t)number);
+	mPosition += number;
+	return number;
+}
+
+vec_view<uint8_t> PackStream::getContentInPlace(std::shared_ptr<const void>& owner) {
+	DEBUG_ASSERT(isOpen(), "The file must be open");
+
+	owner = mContentOwner;
+	return mContent;
+}
+
+std::unique_ptr<Stream> PackStream::copy() const {
+	return make_unique<PackStream>(mPath, mPack, mInternalPath);
+}
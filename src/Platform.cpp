@@ -1,9 +1,13 @@
 #include "Platform.h"
 
 #include <tinydir.h>
+#include <FreeImage.h>
 
-#include "ZipArchive.h"
+#include "ZipStream.h"
+#include "PackStream.h"
+#include "AssetPack.h"
 #include "File.h"
+#include "MappedFile.h"
 #include "dojomath.h"
 #include "ApplicationListener.h"
 #include "WorkerPool.h"
@@ -36,13 +40,14 @@
 
 #include "LogListener.h"
 #include "TimedEvent.h"
-#include "Random.h"
 #include "InputSystem.h"
 
 using namespace Dojo;
 
 std::unique_ptr<Platform> Platform::gSingletonPtr;
 
+const utf::string_view Platform::DirectoryManifestName = "directories.manifest";
+
 Platform& Platform::create(const Table& config /*= Table::EMPTY_TABLE */) {
 #if defined (PLATFORM_WIN32)
 	gSingletonPtr = make_unique<Win32Platform>(config);
@@ -87,54 +92,69 @@ Platform::Platform(const Table& configTable) :
 	addZipFormat(".zip");
 	addZipFormat(".dpk");
 
+	//packs are found in the paths like zips, then they're opened as AssetPacks
+	addZipFormat("." + AssetPack::Extension);
+
+	mDirectoryCache = make_unique<DirectoryCache>([this](utf::string_view folder, std::vector<utf::string>& out) {
+		_scanFolder(folder, out);
+	});
+
 	mLog = make_unique<Log>();
 	gp_log = mLog.get();
 
 	mLogWriter = make_unique<StdoutLog>();
 	mLog->addListener(*mLogWriter);
 
+	mScheduler = make_unique<MainThreadScheduler>();
+
 	//create thread pools
 	//map the main thread to the thread pool system
 	mPools.push_back(make_unique<WorkerPool>(1, false, true)); 
 
 	//allocate cpus-1 threads
 	//TODO handle asymmetric processors such as BIG.little that should use half the cores
-	mPools.push_back(make_unique<WorkerPool>(std::thread::hardware_concurrency() - 1));
+	//every thread can queue background jobs, so its workers use the lock-free queues
+	mPools.push_back(make_unique<WorkerPool>(std::thread::hardware_concurrency() - 1, true, true));
 
 	for(auto&& p : mPools) {
-		mAllPools.emplace(p.get());
+		addWorkerPool(*p);
 	}
 }
 
 Platform::~Platform() {
+#ifndef PUBLISH
+	for (auto&& pool : mPools) {
+		auto stats = pool->getStats();
+		if (stats.queuedJobs > 0) {
+			mLog->appendFormat(LogEntry::EL_INFO, "Worker pool: {} jobs queued, {} ns per job",
+				stats.queuedJobs, (int64_t)(stats.queueTime / stats.queuedJobs * 1e9));
+		}
+		if (stats.wakeups > 0) {
+			mLog->appendFormat(LogEntry::EL_INFO, "Worker pool: {} wakeups, {} us of latency on average",
+				stats.wakeups, (int64_t)(stats.wakeTime / stats.wakeups * 1e6));
+		}
+	}
 
-}
+	auto& timerStats = TimedEvent::getStats();
+	if (timerStats.advanceCount > 0) {
+		mLog->appendFormat(LogEntry::EL_INFO, "Timed events: {} expired, at most {} scheduled at once, {} us per frame to advance",
+			timerStats.expiredCount, timerStats.peakScheduledCount, timerStats.advanceTime / timerStats.advanceCount * 1e6);
+	}
 
-void Platform::_runASyncTasks(float elapsedTime) {
-	auto availableTime = game->getNativeFrameLength();
+	//by now every folder that the game ever listed was scanned or loaded from the manifest
+	_logDirectoryStats();
+#endif
 
-	Timer timer;
+	//the log writer is destroyed before the Log, so it must not receive anything else
+	mLog->flush();
+	mLog->removeListener(*mLogWriter);
+}
 
+void Platform::_runASyncTasks(float elapsedTime) {
  	TimedEvent::runTimedEvents(std::chrono::high_resolution_clock::now());
 
-//TODO increase frame time if starved
-//TODO try to predict if the next task will kill the frame
-
-	bool runAnything = false;
-	size_t startFrom = Random::instance.getInt(static_cast<uint32_t>(mAllPools.size()));
-	size_t i = 0;
-	while(timer.getElapsedTime() < availableTime) {
-		runAnything |= mAllPools[(startFrom + i) % mAllPools.size()]->runOneCallback();
-		 
-		//if we've visited all the pools and nothing was run, return
-		if(++i == mAllPools.size()) {
-			if (not runAnything) {
-				break;
-			}
-			runAnything = false;
-			i = 0;
-		}
-	}
+	//only use the time that is left in this frame after the game and the rendering
+	mScheduler->run(game->getNativeFrameLength() - elapsedTime);
 }
 
 utf::string::const_iterator Platform::_findZipExtension(utf::string_view path) {
@@ -188,11 +208,11 @@ utf::string Platform::_replaceFoldersWithExistingZips(utf::string_view relPath)
 	return res;
 }
 
-const Dojo::Platform::ZipFoldersMap& Dojo::Platform::_getZipFileMap(utf::string_view path, utf::string_view& zipPath, utf::string_view& remainder) {
+void Platform::_splitArchivePath(utf::string_view path, utf::string_view& archivePath, utf::string_view& remainder) {
 	//find the innermost zip
 	auto idx = _findZipExtension(path);
 
-	zipPath = path.substr(path.begin(), idx);
+	archivePath = path.substr(path.begin(), idx);
 
 	if (idx != path.end()) {
 		remainder = {idx + 1, path.end()};
@@ -202,41 +222,51 @@ const Dojo::Platform::ZipFoldersMap& Dojo::Platform::_getZipFileMap(utf::string_
 	}
 
 	DEBUG_ASSERT( remainder.find( ".zip" ) == remainder.end(), "Error: nested zips are not supported!" );
+}
+
+bool Platform::_isAssetPack(utf::string_view archivePath) {
+	return Path::getFileExtension(archivePath) == AssetPack::Extension;
+}
+
+std::shared_ptr<const ZipIndex> Platform::_getZipIndex(utf::string_view zipPath) {
+	std::lock_guard<std::mutex> lock(mArchivesMutex);
 
 	//has this zip been already loaded?
-	ZipFileMapping::const_iterator elem = mZipFileMaps.find(zipPath);
+	auto& index = mZipIndices[{ zipPath.data(), zipPath.byte_size() }];
+	if (not index) {
+		index = make_shared<ZipIndex>(zipPath);
+	}
+
+	return index;
+}
+
+std::shared_ptr<AssetPack> Platform::_getAssetPack(utf::string_view packPath) {
+	std::lock_guard<std::mutex> lock(mArchivesMutex);
 
-	if (elem != mZipFileMaps.end()) {
-		return elem->second;
+	auto& pack = mAssetPacks[{ packPath.data(), packPath.byte_size() }];
+	if (not pack) {
+		pack = make_shared<AssetPack>(packPath);
 	}
-	else {
-		mZipFileMaps.emplace(zipPath.copy(), ZipFoldersMap());
-		ZipFoldersMap& map = mZipFileMaps.find(zipPath)->second;
-
-		ZipArchive zip(zipPath);
-		std::vector<utf::string> zip_files;
-		zip.getListAllFiles(".", zip_files);
-
-		for (auto&& zip_file : zip_files) {
-			auto parentPath = Path::getParentDirectory(zip_file);
-			auto parent = map.find(parentPath);
-			if (parent == map.end()) {
-				map.emplace(
-					parentPath.copy(),
-					PathList{std::move(zip_file)}
-				);
-			}
-			else {
-				parent->second.emplace_back(std::move(zip_file));
-			}
-		}
 
+	return pack;
+}
+
+void Platform::prefetchFolder(utf::string_view folder) {
+	utf::string absPath = getResourcesPath() + _replaceFoldersWithExistingZips(folder) + '/';
 
-		return map;
+	if (_findZipExtension(absPath) == absPath.cend()) {
+		return;
+	}
+
+	utf::string_view packPath, internalPath;
+	_splitArchivePath(absPath, packPath, internalPath);
+
+	if (_isAssetPack(packPath)) {
+		_getAssetPack(packPath)->prefetch(internalPath, getBackgroundPool());
 	}
 }
 
-void Platform::getFilePathsForType(utf::string_view type, utf::string_view wpath, std::vector<utf::string>& out) {
+void Platform::_scanFolder(utf::string_view wpath, std::vector<utf::string>& out) {
 	//check if any part of the path has been replaced by a zip file, so that we're in fact in a zip file
 	utf::string absPath = getResourcesPath() + _replaceFoldersWithExistingZips(wpath) + '/';
 
@@ -246,19 +276,18 @@ void Platform::getFilePathsForType(utf::string_view type, utf::string_view wpath
 		//now, get the file/folder mapping in memory for the zip
 		//it is cached because parsing the header from disk each time is TOO SLOW
 		utf::string_view zipInternalPath, zipPath;
-		const ZipFoldersMap& map = _getZipFileMap(absPath, zipPath, zipInternalPath);
-
-		//do we have a folder named "zipInternalPath"?
-		auto folderItr = map.find(zipInternalPath);
-
-		if (folderItr != map.end()) {
-			//add all the files with the needed extension
-			for (utf::string filePath : folderItr->second) {
-				if (Path::getFileExtension(filePath) == type) {
-					utf::string path = zipPath + '/' + filePath;
-					out.emplace_back(path);
-				}
-			}
+		_splitArchivePath(absPath, zipPath, zipInternalPath);
+
+		std::vector<utf::string> files;
+		if (_isAssetPack(zipPath)) {
+			_getAssetPack(zipPath)->getFiles(zipInternalPath, files);
+		}
+		else {
+			_getZipIndex(zipPath)->getFiles(zipInternalPath, files);
+		}
+
+		for (auto&& filePath : files) {
+			out.emplace_back(zipPath + '/' + filePath);
 		}
 	}
 	else {
@@ -270,10 +299,8 @@ void Platform::getFilePathsForType(utf::string_view type, utf::string_view wpath
 			tinydir_file file;
 			tinydir_readfile(&dir, &file);
 
-			auto fullPath = utf::string_view(file.path);
-
-			if (not file.is_dir and Path::getFileExtension(fullPath) == type) {
-				out.emplace_back(Path::makeCanonical(fullPath, true));
+			if (not file.is_dir) {
+				out.emplace_back(Path::makeCanonical(utf::string_view(file.path), true));
 			}
 
 			tinydir_next(&dir);
@@ -283,6 +310,43 @@ void Platform::getFilePathsForType(utf::string_view type, utf::string_view wpath
 	}
 }
 
+utf::string Platform::_getDirectoryManifestPath() {
+	return Path::makeCanonical(getResourcesPath()) + DirectoryManifestName;
+}
+
+void Platform::getFilesForType(utf::string_view type, utf::string_view path, std::vector<DirectoryCache::File>& out) {
+	//the resources path is only known once the platform is initialized
+	if (not mDirectoryManifestChecked.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(mDirectoryManifestMutex);
+		if (not mDirectoryManifestChecked.load(std::memory_order_relaxed)) {
+			mDirectoryCache->loadManifest(_getDirectoryManifestPath(), getResourcesPath());
+			mDirectoryManifestChecked.store(true, std::memory_order_release);
+		}
+	}
+
+	mDirectoryCache->getFiles(path, type, out);
+}
+
+void Platform::getFilePathsForType(utf::string_view type, utf::string_view wpath, std::vector<utf::string>& out) {
+	std::vector<DirectoryCache::File> files;
+	getFilesForType(type, wpath, files);
+
+	for (auto&& file : files) {
+		out.emplace_back(std::move(file.path));
+	}
+}
+
+bool Platform::saveDirectoryManifest() {
+	return mDirectoryCache->saveManifest(_getDirectoryManifestPath(), getResourcesPath());
+}
+
+void Platform::_logDirectoryStats() {
+	auto stats = mDirectoryCache->getStats();
+	mLog->appendFormat(LogEntry::EL_INFO, "Resource folders: {} scanned with {} files in {} ms, {} from the manifest in {} ms, {} queries",
+		stats.scannedFolders, stats.scannedFiles, (int)(stats.scanTime * 1000),
+		stats.manifestFolders, (int)(stats.manifestTime * 1000), stats.queries);
+}
+
 std::unique_ptr<FileStream> Platform::getFile(utf::string_view path) {
 	using namespace std;
 
@@ -292,13 +356,59 @@ std::unique_ptr<FileStream> Platform::getFile(utf::string_view path) {
 		return make_unique<File>(path);
 	}
 
-	else { //open a file from a zip
-		DEBUG_TODO;
-		//TODO use a ZipStream
-		return nullptr;
+	else { //open a file from a zip or a pack
+		utf::string_view archivePath, internalPath;
+		_splitArchivePath(path, archivePath, internalPath);
+
+		if (_isAssetPack(archivePath)) {
+			return make_unique<PackStream>(path, _getAssetPack(archivePath), internalPath);
+		}
+		return make_unique<ZipStream>(path, _getZipIndex(archivePath), internalPath);
 	}
 }
 
+bool Platform::saveImageFile(utf::string_view path, const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height) {
+	DEBUG_ASSERT(rgba.size() == width * height * 4, "The image data should be tightly packed RGBA8");
+
+#ifdef PLATFORM_WIN32
+	auto nativePath = String::toUTF16(path);
+	FREE_IMAGE_FORMAT fif = FreeImage_GetFIFFromFilenameU(nativePath.c_str());
+#else
+	auto nativePath = path.copy();
+	FREE_IMAGE_FORMAT fif = FreeImage_GetFIFFromFilename(nativePath.bytes().c_str());
+#endif
+
+	if (fif == FIF_UNKNOWN or not FreeImage_FIFSupportsWriting(fif)) {
+		return false;
+	}
+
+	FIBITMAP* dib = FreeImage_Allocate(width, height, 32);
+	if (not dib) {
+		return false;
+	}
+
+	//FreeImage stores the rows bottom-up and in the channel order of the platform
+	for (uint32_t i = 0; i < height; ++i) {
+		auto out = FreeImage_GetScanLine(dib, height - i - 1);
+		auto in = rgba.data() + i * width * 4;
+
+		for (uint32_t j = 0; j < width; ++j, in += 4, out += 4) {
+			out[FI_RGBA_RED] = in[0];
+			out[FI_RGBA_GREEN] = in[1];
+			out[FI_RGBA_BLUE] = in[2];
+			out[FI_RGBA_ALPHA] = in[3];
+		}
+	}
+
+#ifdef PLATFORM_WIN32
+	bool saved = FreeImage_SaveU(fif, dib, nativePath.c_str()) == TRUE;
+#else
+	bool saved = FreeImage_Save(fif, dib, nativePath.bytes().c_str()) == TRUE;
+#endif
+	FreeImage_Unload(dib);
+	return saved;
+}
+
 void Platform::run(std::unique_ptr<Game> game) {
 	initialize(std::move(game));
 
@@ -308,16 +418,8 @@ void Platform::run(std::unique_ptr<Game> game) {
 }
 
 std::vector<uint8_t> Platform::loadFileContent(utf::string_view path) {
-	auto file = getFile(path);
-
-	if (file->open(Stream::Access::Read)) {
-		std::vector<uint8_t> buf((size_t)file->getSize());
-
-		file->read(buf.data(), buf.size());
-
-		return buf;
-	}
-	return{};
+	MappedFile file(path);
+	return{ file.data(), file.data() + file.size() };
 }
 
 utf::string Platform::_getTablePath(utf::string_view absPathOrName) {
@@ -401,9 +503,18 @@ void Dojo::Platform::removeApplicationListener(ApplicationListener& f) {
 void Dojo::Platform::addWorkerPool(WorkerPool& pool) {
 	DEBUG_ASSERT(not mAllPools.contains(&pool), "Already registered");
 	mAllPools.emplace(&pool);
+
+	//the background pool mostly sends back bulk loading work
+	bool background = mPools.size() > 1 and &pool == mPools[1].get();
+	auto priority = background ? MainThreadScheduler::Priority::Background : MainThreadScheduler::Priority::Normal;
+	mScheduler->addSource(&pool, priority, background ? "background pool callbacks" : "worker pool callbacks", [&pool] {
+		return pool.runOneCallback();
+	});
 }
 
 void Dojo::Platform::removeWorkerPool(WorkerPool& pool) {
 	DEBUG_ASSERT(mAllPools.contains(&pool), "Already registered");
 	mAllPools.erase(&pool);
+
+	mScheduler->removeSource(&pool);
 }
@@ -10,6 +10,8 @@
 
 #include "Game.h"
 #include "Texture.h"
+#include "TextureStreamer.h"
+#include "TexFormatInfo.h"
 
 #include <glad/glad.h>
 
@@ -17,6 +19,18 @@ using namespace Dojo;
 
 GLuint gDefaultVAO = 0;
 
+static bool hasGLExtension(const char* name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		auto extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension and strcmp(extension, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 
 const char* _errorToString(GLenum errorType) {
 	switch (errorType)
@@ -130,10 +144,34 @@ Dojo::Renderer::Renderer(RenderSurface backbuffer, Orientation renderOrientation
 
 	setInterfaceOrientation(Platform::singleton().getGame().getNativeOrientation());
 
+	int64_t textureBudgetMB = Platform::singleton().getUserConfiguration().getInt("texture_budget_MB", 0);
+	mTextureStreamer = make_unique<TextureStreamer>(textureBudgetMB * 1024 * 1024);
+
 	//HACK GL core doesn't work without a VAO bound... but ain't nobody got time fo' dat
 	glGenVertexArrays(1, &gDefaultVAO);
 	glBindVertexArray(gDefaultVAO);
 
+	//the extension is looked up at runtime because the GL loader might not know it; the driver then picks how many threads to use
+	mParallelShaderCompile = hasGLExtension("GL_KHR_parallel_shader_compile") or hasGLExtension("GL_ARB_parallel_shader_compile");
+	DEBUG_MESSAGE(mParallelShaderCompile ? "parallel shader compilation: yes" : "parallel shader compilation: no, shaders block when loaded");
+
+	GLint compressedFormatCount = 0;
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &compressedFormatCount);
+	std::vector<GLint> compressedFormats(compressedFormatCount);
+	if (compressedFormatCount > 0) {
+		glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, compressedFormats.data());
+	}
+	mCompressedFormats.assign(compressedFormats.begin(), compressedFormats.end());
+
+	//the per-frame and per-view uniforms are shared by all the Shaders that declare their blocks
+	glGenBuffers(1, &mFrameUniformBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, mFrameUniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformBlock), nullptr, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &mViewUniformBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, mViewUniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewUniformBlock), nullptr, GL_DYNAMIC_DRAW);
+
 #ifdef PUBLISH
 	bool shouldLog = false;
 #else
@@ -160,6 +198,9 @@ Dojo::Renderer::Renderer(RenderSurface backbuffer, Orientation renderOrientation
 Renderer::~Renderer() {
 	clearLayers();
 
+	glDeleteBuffers(1, &mFrameUniformBuffer);
+	glDeleteBuffers(1, &mViewUniformBuffer);
+
 	if(gDefaultVAO) {
 		glDeleteVertexArrays(1, &gDefaultVAO);
 		gDefaultVAO = 0;
@@ -297,6 +338,42 @@ void Dojo::Renderer::_renderElement(const RenderLayer& layer, const RenderState&
 	lastRenderState = renderState;
 }
 
+void Renderer::_notifyVisibleTextures(const RenderLayer& layer, const Viewport& viewport, const Renderable& renderable) {
+	//orthographic layers know how many pixels an element covers, perspective ones just ask for the full resolution
+	Vector pixels = renderable.getGraphicsAABB().getSize() / viewport.getPixelSide();
+
+	for (int i = 0; i < DOJO_MAX_TEXTURES; ++i) {
+		if (auto texture = renderable.getTexture(i).to_ref()) {
+			if (layer.orthographic) {
+				mTextureStreamer->notifyVisible(texture.get(), pixels);
+			}
+			else {
+				mTextureStreamer->notifyVisible(texture.get());
+			}
+		}
+	}
+}
+
+void Renderer::_uploadViewUniforms() {
+	ViewUniformBlock block;
+	block.view = globalUniforms.view;
+	block.projection = globalUniforms.projection;
+	block.viewDirection = glm::vec4(globalUniforms.viewDirection, 0);
+	block.targetDimension = {
+		globalUniforms.targetDimension.x,
+		globalUniforms.targetDimension.y,
+		globalUniforms.targetDimensionInv.x,
+		globalUniforms.targetDimensionInv.y
+	};
+
+	//layers sharing the same projection don't need a new upload
+	if (memcmp(&block, &mLastViewBlock, sizeof(block)) != 0) {
+		glBindBuffer(GL_UNIFORM_BUFFER, mViewUniformBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+		mLastViewBlock = block;
+	}
+}
+
 bool _cull(const RenderLayer& layer, const Viewport& viewport, const Renderable& r) {
 	return layer.orthographic ? viewport.isInViewRect(r) : viewport.isContainedInFrustum(r);
 }
@@ -319,9 +396,11 @@ void Renderer::_renderLayer(Viewport& viewport, const RenderLayer& layer) {
 
 	//set projection state
 	globalUniforms.projection = mRenderRotation * (layer.orthographic ? viewport.getOrthoProjectionTransform() : viewport.getPerspectiveProjectionTransform());
+	_uploadViewUniforms();
 
 	for (auto&& r : layer.elements) {
 		if (r->canBeRendered() and _cull(layer, viewport, *r)) {
+			_notifyVisibleTextures(layer, viewport, *r);
 			_renderElement(layer, *r);
 		}
 	}
@@ -337,8 +416,16 @@ void Renderer::_renderViewport(Viewport& viewport) {
 		(float)viewport.getFramebuffer().getHeight()
 	};
 
+	globalUniforms.targetDimensionInv = {
+		1.f / globalUniforms.targetDimension.x,
+		1.f / globalUniforms.targetDimension.y
+	};
+
 	glViewport(0, 0, (GLsizei) globalUniforms.targetDimension.x, (GLsizei)globalUniforms.targetDimension.y);
 
+	glBindBufferBase(GL_UNIFORM_BUFFER, Shader::FrameBlockBinding, mFrameUniformBuffer);
+	glBindBufferBase(GL_UNIFORM_BUFFER, Shader::ViewBlockBinding, mViewUniformBuffer);
+
 	//clear the viewport
 	GLuint clearFlags = 0;
 	if (viewport.getColorClearEnabled()) {
@@ -410,8 +497,18 @@ void Renderer::renderFrame(float dt) {
 	DEBUG_ASSERT(not frameStarted, "Tried to start rendering but the frame was already started" );
 
 	frameVertexCount = frameTriCount = frameBatchCount = 0;
+#ifndef PUBLISH
+	Shader::sUniformStats = {};
+#endif
 	frameStarted = true;
 
+	mTime += dt;
+	globalUniforms.time = mTime;
+
+	FrameUniformBlock frameBlock = { mTime };
+	glBindBuffer(GL_UNIFORM_BUFFER, mFrameUniformBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frameBlock), &frameBlock);
+
 	//update all the renderables
 	_updateRenderables(layers, dt);
 
@@ -420,9 +517,28 @@ void Renderer::renderFrame(float dt) {
 		_renderViewport(*viewport);
 	}
 
+	mTextureStreamer->update();
+
 	frameStarted = false;
 }
 
+int Renderer::getLastFrameUniformCount() {
+	return Shader::sUniformStats.issued;
+}
+
+int Renderer::getLastFrameSkippedUniformCount() {
+	return Shader::sUniformStats.skipped;
+}
+
+bool Renderer::supportsFormat(PixelFormat format) const {
+	auto& info = TexFormatInfo::getFor(format);
+	if (not info.isCompressed()) {
+		return true;
+	}
+
+	return std::find(mCompressedFormats.begin(), mCompressedFormats.end(), info.internalFormat) != mCompressedFormats.end();
+}
+
 void Renderer::endFrame() {
 	submitter.get().submitFrame();
 }
@@ -10,7 +10,9 @@
 #include "SoundBuffer.h"
 
 #include "Texture.h"
+#include "TextureContainer.h"
 #include "Path.h"
+#include "WorkerPool.h"
 
 using namespace Dojo;
 
@@ -64,24 +66,26 @@ void ResourceGroup::addSets(utf::string_view subdirectory, int version) {
 	DEBUG_ASSERT( subdirectory.not_empty(), "addSets: folder path is empty" );
 	DEBUG_ASSERT( version >= 0, "addSets: negative versions are invalid" );
 
-	std::vector<utf::string> paths;
+	std::vector<DirectoryCache::File> files;
 	utf::string_view name, lastName;
 
 	FrameSet* currentSet = nullptr;
 
 	//find pngs and jpgs
-	Platform::singleton().getFilePathsForType("png", subdirectory, paths);
-	Platform::singleton().getFilePathsForType("jpg", subdirectory, paths);
-	Platform::singleton().getFilePathsForType("dds", subdirectory, paths);
-
-	for(auto&& path : paths) {
-		name = Path::getFileName(path);
+	Platform::singleton().getFilesForType("png", subdirectory, files);
+	Platform::singleton().getFilesForType("jpg", subdirectory, files);
+	Platform::singleton().getFilesForType("dds", subdirectory, files);
+	Platform::singleton().getFilesForType(TextureContainer::Extension, subdirectory, files);
 
+	for(auto&& file : files) {
 		//skip wrong versions
-		if (Path::getVersion(name) != version) {
+		if (file.version != version) {
 			continue;
 		}
 
+		auto& path = file.path;
+		name = Path::getFileName(path);
+
 		if (lastName.empty() or not Path::arePathsInSequence(lastName, name)) {
 			auto setPrefix = Path::removeTags(name);
 
@@ -90,31 +94,47 @@ void ResourceGroup::addSets(utf::string_view subdirectory, int version) {
 		}
 
 		//create a new buffer
-		currentSet->addTexture(make_unique<Texture>(self, path));
+		auto texture = make_unique<Texture>(self, path);
+
+		auto extension = Path::getFileExtension(path);
+		if (autoAtlas and not streamTextures and (extension == "png" or extension == "jpg")) {
+			mAtlasTiles.push_back(texture.get());
+			mPendingAtlasTiles.push_back(texture.get());
+		}
+
+		currentSet->addTexture(std::move(texture));
 
 		lastName = name;
 	}
 
-	paths.clear();
-	Platform::singleton().getFilePathsForType("atlasinfo", subdirectory, paths);
+	std::vector<DirectoryCache::File> atlases;
+	Platform::singleton().getFilesForType("atlasinfo", subdirectory, atlases);
 
 	//now add atlases!
 	Table def;
 
-	for(auto&& path : paths) {
-		name = Path::getFileName(path);
-
+	for(auto&& file : atlases) {
 		//skip wrong versions
-		if (Path::getVersion(name) != version) {
+		if (file.version != version) {
 			continue;
 		}
 
-		name = Path::removeVersion(name);
+		auto& path = file.path;
+		name = Path::removeVersion(Path::getFileName(path));
 
 		def = Platform::singleton().load(path);
 
+		//the textures used by atlases can't be packed again
+		auto excludeFromAtlas = [&](const Table& atlasDef) {
+			if (auto atlasSet = getFrameSet(atlasDef.getString("texture")).to_ref()) {
+				_removeFromAtlas(atlasSet.get());
+			}
+		};
+
 		//standard flat atlasinfo
 		if (def.getArrayLength() == 0) {
+			excludeFromAtlas(def);
+
 			auto set = make_unique<FrameSet>(self);
 			set->setAtlas(def, self);
 
@@ -123,6 +143,7 @@ void ResourceGroup::addSets(utf::string_view subdirectory, int version) {
 		else
 			for (int j = 0; j < def.getArrayLength(); ++j) {
 				auto& sub = def.getTable(j);
+				excludeFromAtlas(sub);
 
 				auto set = make_unique<FrameSet>(self);
 				set->setAtlas(sub, self);
@@ -139,23 +160,20 @@ void ResourceGroup::addFonts(utf::string_view subdirectory, int version) {
 	DEBUG_ASSERT( subdirectory.not_empty(), "addFonts: folder path is empty" );
 	DEBUG_ASSERT( version >= 0, "addFonts: negative versions are invalid" );
 
-	utf::string_view name;
-	std::vector<utf::string> paths;
+	std::vector<DirectoryCache::File> files;
 
-	Platform::singleton().getFilePathsForType("font", subdirectory, paths);
+	Platform::singleton().getFilesForType("font", subdirectory, files);
 
 	///just add a Font for any .ttf file found
-	for (auto&& path : paths) {
-		name = Path::getFileName(path);
-
+	for (auto&& file : files) {
 		//skip wrong versions
-		if (Path::getVersion(name) != version) {
+		if (file.version != version) {
 			continue;
 		}
 
-		name = Path::removeTags(name);
+		auto name = Path::removeTags(Path::getFileName(file.path));
 
-		addFont(make_unique<Font>(self, path), name);
+		addFont(make_unique<Font>(self, file.path), name);
 	}
 }
 
@@ -231,28 +249,325 @@ void ResourceGroup::addShaders(utf::string_view folder) {
 	}
 }
 
+void ResourceGroup::_removeFromAtlas(FrameSet& set) {
+	auto isInSet = [&](Texture* t) {
+		return t->getOwnerFrameSet().to_raw_ptr() == &set;
+	};
+	mAtlasTiles.erase(std::remove_if(mAtlasTiles.begin(), mAtlasTiles.end(), isInSet), mAtlasTiles.end());
+	mPendingAtlasTiles.erase(std::remove_if(mPendingAtlasTiles.begin(), mPendingAtlasTiles.end(), isInSet), mPendingAtlasTiles.end());
+}
+
+void ResourceGroup::_packAtlas() {
+	if (mPendingAtlasTiles.empty()) {
+		return;
+	}
+
+	struct Image {
+		std::vector<uint8_t> rgba;
+		uint32_t width = 0, height = 0;
+		PixelFormat format = PixelFormat::Unknown;
+	};
+
+	//decode all the images in parallel
+	std::vector<Image> images(mPendingAtlasTiles.size());
+	auto& pool = Platform::singleton().getBackgroundPool();
+	for (size_t i = 0; i < images.size(); ++i) {
+		auto path = mPendingAtlasTiles[i]->getFilePath();
+		auto image = &images[i];
+		pool.queue([path, image] {
+			image->format = AtlasPacker::readImage(path, image->rgba, image->width, image->height);
+		});
+	}
+	pool.sync();
+
+	//a sequence is packed only if all of its frames can be, so that it is never split between the atlas and loose files
+	std::map<FrameSet*, std::vector<size_t>> sequences;
+	for (size_t i = 0; i < images.size(); ++i) {
+		sequences[mPendingAtlasTiles[i]->getOwnerFrameSet().to_raw_ptr()].push_back(i);
+	}
+
+	//images can only share pages with images of the same format
+	std::map<PixelFormat, std::vector<size_t>> formats;
+	std::vector<int> groups(images.size(), -1);
+	int groupCount = 0;
+	for (auto&& sequence : sequences) {
+		auto format = images[sequence.second.front()].format;
+
+		//big images don't gain anything from being packed and get loaded from their file
+		auto maxSize = atlasSettings.pageSize / 2;
+		bool packable = format != PixelFormat::Unknown;
+		for (auto&& i : sequence.second) {
+			packable &= images[i].format == format and images[i].width <= maxSize and images[i].height <= maxSize;
+		}
+
+		if (packable) {
+			auto& indices = formats[format];
+			indices.insert(indices.end(), sequence.second.begin(), sequence.second.end());
+			for (auto&& i : sequence.second) {
+				groups[i] = groupCount;
+			}
+			++groupCount;
+		}
+	}
+
+	//the sequences that can't fit a single page stay loose, too
+	auto settings = atlasSettings;
+	settings.splitGroups = false;
+
+	uint32_t packed = 0, pageCount = 0;
+	float efficiency = 0;
+	for (auto&& format : formats) {
+		AtlasPacker packer(settings);
+		for (auto&& i : format.second) {
+			packer.add(std::move(images[i].rgba), images[i].width, images[i].height, groups[i]);
+		}
+		packer.pack();
+
+		auto firstPage = mAtlasPages.size();
+		for (uint32_t i = 0; i < packer.getPageCount(); ++i) {
+			auto page = make_unique<Texture>(self);
+			page->loadFromMemory(packer.renderPage(i).data(), packer.getPageWidth(i), packer.getPageHeight(i), format.first, not disableMipmaps);
+			mAtlasPages.emplace_back(std::move(page));
+		}
+
+		for (uint32_t i = 0; i < packer.getImageCount(); ++i) {
+			if (not packer.isPlaced(i)) {
+				continue;
+			}
+
+			auto& placement = packer.getPlacement(i);
+
+			Texture::AtlasTile tile;
+			tile.x = placement.x;
+			tile.y = placement.y;
+			tile.width = placement.rotated ? placement.height : placement.width;
+			tile.height = placement.rotated ? placement.width : placement.height;
+			tile.rotated = placement.rotated;
+			tile.trimX = placement.trimX;
+			tile.trimY = placement.trimY;
+			tile.originalWidth = placement.originalWidth;
+			tile.originalHeight = placement.originalHeight;
+
+			mPendingAtlasTiles[format.second[i]]->loadFromAtlas(*mAtlasPages[firstPage + placement.page], tile);
+			++packed;
+		}
+
+		pageCount += packer.getPageCount();
+		efficiency += packer.getEfficiency() * packer.getPageCount();
+	}
+
+	if (logchanges and pageCount > 0) {
+		DEBUG_MESSAGE("Auto atlas: " + utf::to_string(packed) + " images in " + utf::to_string(pageCount) + " pages, "
+			+ utf::to_string((int)(efficiency / pageCount * 100)) + "% efficiency");
+	}
+
+	mPendingAtlasTiles.clear();
+}
+
+ResourceGroup::ShaderCompileReport ResourceGroup::_compileShaders() {
+	ShaderCompileReport report;
+	Timer timer;
+
+	std::vector<ShaderProgram*> pendingPrograms;
+	for (auto&& pair : programs) {
+		auto& program = *pair.second;
+		if (not program.isLoaded() and not program.isCompiling()) {
+			if (program._beginLoad()) {
+				pendingPrograms.push_back(&program);
+			}
+			else {
+				++report.failed;
+			}
+		}
+	}
+
+	std::vector<Shader*> pendingShaders;
+	for (auto&& pair : shaders) {
+		auto& shader = *pair.second;
+		if (not shader.isLoaded()) {
+			if (shader._beginLoad()) {
+				pendingShaders.push_back(&shader);
+			}
+			else {
+				++report.failed;
+			}
+		}
+	}
+
+	//poll the driver instead of blocking on each one in order
+	while (not pendingPrograms.empty() or not pendingShaders.empty()) {
+		bool progress = false;
+
+		for (size_t i = 0; i < pendingPrograms.size();) {
+			auto& program = *pendingPrograms[i];
+
+			//a shader could have finished it already
+			if (not program.isCompiling() or program._isCompileComplete()) {
+				if (program.isCompiling()) {
+					program._endLoad();
+				}
+
+				if (program.isLoaded()) {
+					++report.programs;
+				}
+				else {
+					++report.failed;
+				}
+
+				pendingPrograms[i] = pendingPrograms.back();
+				pendingPrograms.pop_back();
+				progress = true;
+			}
+			else {
+				++i;
+			}
+		}
+
+		for (size_t i = 0; i < pendingShaders.size();) {
+			auto& shader = *pendingShaders[i];
+
+			if (shader._isLinkComplete()) {
+				if (shader._endLoad()) {
+					++report.shaders;
+					report.cachedShaders += shader.isLoadedFromCache() ? 1 : 0;
+				}
+				else {
+					++report.failed;
+				}
+
+				pendingShaders[i] = pendingShaders.back();
+				pendingShaders.pop_back();
+				progress = true;
+			}
+			else {
+				++i;
+			}
+		}
+
+		if (not progress) {
+			std::this_thread::yield();
+		}
+	}
+
+	report.seconds = timer.getElapsedTime();
+	return report;
+}
+
+ResourceGroup::ShaderCompileReport ResourceGroup::precompileShaders(bool recursive) {
+	Timer timer;
+
+	auto report = _compileShaders();
+
+	//wait for the binaries to be written in the cache
+	Platform::singleton().getBackgroundPool().sync();
+
+	report.seconds = timer.getElapsedTime();
+
+	if (recursive) {
+		for (auto&& sub : subs) {
+			auto subReport = sub->precompileShaders(recursive);
+			report.programs += subReport.programs;
+			report.shaders += subReport.shaders;
+			report.cachedShaders += subReport.cachedShaders;
+			report.failed += subReport.failed;
+			report.seconds += subReport.seconds;
+		}
+	}
+
+	DEBUG_MESSAGE("Precompiled " + utf::to_string(report.programs) + " programs and " + utf::to_string(report.shaders) + " shaders ("
+		+ utf::to_string(report.cachedShaders) + " from cache, " + utf::to_string(report.failed) + " failed) in "
+		+ utf::to_string((int)(report.seconds * 1000)) + " ms");
+
+	return report;
+}
+
+void ResourceGroup::_decodeSounds() {
+	auto& pool = Platform::singleton().getBackgroundPool();
+
+	bool queued = false;
+	for (auto&& set : sounds) {
+		if (set.second->isLoaded()) {
+			continue;
+		}
+
+		for (size_t i = 0; i < set.second->getResourceNb(); ++i) {
+			auto buffer = &set.second->getBuffer((int)i);
+			if (not buffer->isLoaded()) {
+				pool.queue([buffer] {
+					buffer->predecode();
+				});
+				queued = true;
+			}
+		}
+	}
+
+	if (queued) {
+		pool.sync();
+	}
+}
+
 void ResourceGroup::loadResources(bool recursive) {
+	//the atlas pages need to be there before the sets that use them are loaded
+	_packAtlas();
+
 	_load<FrameSet>(frameSets);
 	_load<Font>(fonts);
 	_load<Mesh>(meshes);
+	_decodeSounds();
 	_load<SoundSet>(sounds);
 	_load<Table>(tables);
-	_load<ShaderProgram>(programs);
-	_load<Shader>(shaders);
+
+	auto shaderReport = _compileShaders();
+	if (logchanges and (shaderReport.programs > 0 or shaderReport.shaders > 0)) {
+		DEBUG_MESSAGE("Shaders: " + utf::to_string(shaderReport.programs) + " programs compiled, "
+			+ utf::to_string(shaderReport.shaders) + " linked (" + utf::to_string(shaderReport.cachedShaders) + " from cache) in "
+			+ utf::to_string((int)(shaderReport.seconds * 1000)) + " ms");
+	}
 
 	//load sets again to load missing atlases!
 	_load<FrameSet>(frameSets);
 
+	if (logchanges) {
+		DEBUG_MESSAGE("Texture memory: " + utf::to_string(getTextureMemory() / 1024) + " KB");
+	}
+
 	if (recursive)
 		for (auto&& sub : subs) {
 			sub->loadResources(recursive);
 		}
 }
 
+int64_t ResourceGroup::getTextureMemory(bool recursive) const {
+	int64_t bytes = 0;
+	for (auto&& set : frameSets) {
+		bytes += set.second->getByteSize();
+	}
+	for (auto&& page : mAtlasPages) {
+		bytes += page->getByteSize();
+	}
+
+	if (recursive) {
+		for (auto&& sub : subs) {
+			bytes += sub->getTextureMemory(recursive);
+		}
+	}
+	return bytes;
+}
+
 void ResourceGroup::unloadResources(bool recursive) {
 	//FONTS DEPEND ON SETS, DO NOT FREE BEFORE
 	_unload<Font>(fonts, false);
 	_unload<FrameSet>(frameSets, false);
+
+	//the auto atlas is packed again on the next load
+	for (auto&& page : mAtlasPages) {
+		if (page->isLoaded()) {
+			page->onUnload();
+		}
+	}
+	mAtlasPages.clear();
+	mPendingAtlasTiles = mAtlasTiles;
+
 	_unload<Mesh>(meshes, false);
 	_unload<SoundSet>(sounds, false);
 	_unload<Table>(tables, false);
@@ -286,6 +601,9 @@ void ResourceGroup::addFolderSimple(utf::string_view folder, int version) {
 		DEBUG_MESSAGE("[" + folder + "]");
 	}
 
+	//a packed folder is read and decompressed in the background while its resources are being created
+	Platform::singleton().prefetchFolder(folder);
+
 	addSets(folder, version);
 	addFonts(folder, version);
 	addMeshes(folder);
@@ -390,7 +708,9 @@ void ResourceGroup::removeAllSubgroups() {
 }
 
 void ResourceGroup::removeFrameSet(utf::string_view name) {
-	frameSets.erase(frameSets.find(name));
+	auto elem = frameSets.find(name);
+	_removeFromAtlas(*elem->second);
+	frameSets.erase(elem);
 }
 
 void ResourceGroup::removeFont(utf::string_view name) {
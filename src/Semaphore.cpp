@@ -1,22 +1,63 @@
 #include "Semaphore.h"
 
+#include "SpinLock.h"
+
 using namespace Dojo;
 
-Semaphore::Semaphore(uint32_t initialCount) : mCount(initialCount) {}
+Semaphore::Semaphore(uint32_t initialCount) :
+	mCount(static_cast<int32_t>(initialCount)) {
+
+}
 
-void Semaphore::notifyOne() {
-	++mCount;
-	mCondition.notify_one();
+bool Semaphore::tryWait() {
+	auto count = mCount.load(std::memory_order_relaxed);
+	while (count > 0) {
+		if (mCount.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+			return true;
+		}
+	}
+	return false;
 }
 
 void Semaphore::wait() {
-	auto lock = std::unique_lock<std::mutex>(mConditionMutex);
+	//spin for a little while, it's much cheaper than parking if the notification is about to come
+	Backoff backoff;
+	while (backoff.isSpinning()) {
+		if (tryWait()) {
+			return;
+		}
+		backoff.pause();
+	}
 
-	while (mCount <= 0) {
-		mCondition.wait(lock);
+	if (mCount.fetch_sub(1, std::memory_order_acquire) <= 0) {
+		_park();
 	}
+}
 
-	--mCount;
+void Semaphore::notify(uint32_t count) {
+	auto old = mCount.fetch_add(static_cast<int32_t>(count), std::memory_order_release);
+	if (old < 0) {
+		_unpark(std::min(static_cast<uint32_t>(-old), count));
+	}
 }
 
+void Semaphore::_park() {
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (mWakeups == 0) {
+		mCondition.wait(lock);
+	}
+	--mWakeups;
+}
+
+void Semaphore::_unpark(uint32_t count) {
+	//notify while holding the mutex: a waiter that returns could destroy the semaphore right after
+	std::lock_guard<std::mutex> lock(mMutex);
+	mWakeups += count;
 
+	if (count == 1) {
+		mCondition.notify_one();
+	}
+	else {
+		mCondition.notify_all();
+	}
+}
@@ -12,6 +12,7 @@
 #include "TinySHA1.h"
 #include "Base64.h"
 #include "FileStream.h"
+#include "MappedFile.h"
 #include "Path.h"
 
 using namespace Dojo;
@@ -19,6 +20,8 @@ using namespace Dojo;
 Shader::NameBuiltInUniformMap Shader::sBuiltiInUniformsNameMap; //TODO implement this with an initializer list when VS decides to work with it
 Shader::NameBuiltInAttributeMap Shader::sBuiltInAttributeNameMap; //TODO ^
 
+Shader::UniformStats Shader::sUniformStats;
+
 void Shader::_populateUniformNameMap() {
 	DEBUG_ASSERT(sBuiltiInUniformsNameMap.empty(), "The name-> builtinuniform map should be empty when populating");
 
@@ -68,6 +71,36 @@ Shader::BuiltInUniform Shader::_getUniformForName(const std::string& name) {
 	return (elem != sBuiltiInUniformsNameMap.end()) ? elem->second : BU_NONE;
 }
 
+uint32_t Shader::_getTypeByteSize(uint32_t glType) {
+	switch (glType) {
+	case GL_FLOAT:
+	case GL_INT:
+	case GL_BOOL:
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_CUBE:
+		return 4;
+	case GL_FLOAT_VEC2:
+	case GL_INT_VEC2:
+	case GL_BOOL_VEC2:
+		return 8;
+	case GL_FLOAT_VEC3:
+	case GL_INT_VEC3:
+	case GL_BOOL_VEC3:
+		return 12;
+	case GL_FLOAT_VEC4:
+	case GL_INT_VEC4:
+	case GL_BOOL_VEC4:
+	case GL_FLOAT_MAT2:
+		return 16;
+	case GL_FLOAT_MAT3:
+		return 36;
+	case GL_FLOAT_MAT4:
+		return 64;
+	default:
+		return 0;
+	}
+}
+
 VertexField Shader::_getAttributeForName(const std::string& name) {
 	if (sBuiltInAttributeNameMap.empty()) {
 		_populateAttributeNameMap();
@@ -127,16 +160,14 @@ void Shader::setUniformCallback(const std::string& name, const UniformCallback&
 }
 
 static int tempInt[2];
-static Vector tmpVec;
-static Matrix tmpMat;
 
 const void* Shader::_getUniformData(const GlobalUniformData& currentState, const Uniform& uniform, const RenderState& user) {
 	auto builtin = uniform.builtInUniform;
 
 	switch (builtin) {
 	case BU_NONE:
-		//TODO make global uniforms and remove this stuff
-		return uniform.customDataBinding(user); //call the user callback and be happy
+		//call the user callback if there's any
+		return uniform.customDataBinding ? uniform.customDataBinding(user) : nullptr;
 
 	case BU_WORLD:
 		return &currentState.world;
@@ -160,18 +191,14 @@ const void* Shader::_getUniformData(const GlobalUniformData& currentState, const
 		return &currentState.viewDirection;
 
 	case BU_TIME:
-		DEBUG_TODO;
-		return nullptr;
+		return &currentState.time;
 
 	case BU_TARGET_DIMENSION:
 		return &currentState.targetDimension;
 
 	case BU_TARGET_DIMENSION_INV:
-		tmpVec = {
-			1.f / currentState.targetDimension.x,
-			1.f / currentState.targetDimension.y
-		};
-		return &tmpVec;
+		return &currentState.targetDimensionInv;
+
 	default: { //texture stuff
 		if (builtin >= BU_TEXTURE_0 and builtin <= BU_TEXTURE_N) {
 			tempInt[0] = builtin - BU_TEXTURE_0;
@@ -204,9 +231,24 @@ void Shader::loadUniforms(const GlobalUniformData& currentState, const RenderSta
 		const void* ptr = _getUniformData(currentState, uniform, user);
 
 		if (ptr == nullptr) { //no data provided, skip
-			break;
+			continue;
+		}
+
+		//the program keeps its uniform values, so there's no need to upload the same value again
+		if (uniform.uploaded and memcmp(uniform.lastValue.data(), ptr, uniform.lastValue.size()) == 0) {
+#ifndef PUBLISH
+			++sUniformStats.skipped;
+#endif
+			continue;
 		}
 
+		memcpy(uniform.lastValue.data(), ptr, uniform.lastValue.size());
+		uniform.uploaded = not uniform.lastValue.empty();
+
+#ifndef PUBLISH
+		++sUniformStats.issued;
+#endif
+
 		//assign the data to the uniform
 		//yes, this code is ugly...but don't be scared, it's as fast as a single glUniform in release :)
 		//the types supported here are only the GLSL ES 2.0 types specified at
@@ -278,32 +320,38 @@ utf::string _getCachedBinaryPath(SHA1& sha) {
 	return Platform::singleton().getShaderCachePath() + digestStr;
 }
 
-Shader::Binary Shader::_getCachedBinary(utf::string_view path) {
-	auto file = Platform::singleton().getFile(path);
-	if (file->open(Stream::Access::Read)) {
-		std::string content((size_t)file->getSize(), 0);
-		file->readToFill(content);
-
-		return{ content.substr(4), *(uint32_t*)(content.data()) };
-	}
-	return{};
-}
-
 std::string Shader::Binary::toString() const {
 	return std::string((char*)&format, 4) + bytes;
 }
 
 void Shader::_storeCachedBinary(utf::string_view path, const Shader::Binary& binary) const {
-	auto file = Platform::singleton().getFile(path);
-	if (file->open(Stream::Access::WriteOnly)) {
-		file->write(binary.toString());
+	//writing the file doesn't need GL, so don't stall the loading for it
+	Platform::singleton().getBackgroundPool().queue([path = path.copy(), content = binary.toString()] {
+		auto file = Platform::singleton().getFile(path);
+		if (file->open(Stream::Access::WriteOnly)) {
+			file->write(content);
+		}
+	});
+}
+
+void Shader::_bindUniformBlock(const char* name, uint32_t byteSize, uint32_t binding) {
+	auto index = glGetUniformBlockIndex(mGLProgram, name);
+	if (index == GL_INVALID_INDEX) {
+		return;
 	}
+
+	GLint size = 0;
+	glGetActiveUniformBlockiv(mGLProgram, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+	DEBUG_ASSERT_INFO((uint32_t)size <= byteSize, "The uniform block doesn't match the layout provided by the Renderer", "name = " + utf::string(name));
+
+	glUniformBlockBinding(mGLProgram, index, binding);
 }
 
-bool Shader::onLoad() {
-	DEBUG_ASSERT(not isLoaded(), "cannot reload an already loaded Shader");
+bool Shader::_beginLoad() {
+	DEBUG_ASSERT(not isLoaded() and not mLinking, "cannot reload an already loaded Shader");
 
 	loaded = false;
+	mLoadedFromCache = false;
 
 	int linked = 0;
 
@@ -325,59 +373,111 @@ bool Shader::onLoad() {
 		auto& source = _assignProgram(desc, (ShaderProgramType)i).getSourceString();
 		sha.processBytes(source.data(), source.length());
 	}
-	auto cachedPath = _getCachedBinaryPath(sha);
+	mCachedBinaryPath = _getCachedBinaryPath(sha);
 
 	//link the shaders together in this high level shader
 	mGLProgram = glCreateProgram();
 
-	auto binary = _getCachedBinary(cachedPath);
-	if (binary) {
-		glProgramBinary(mGLProgram, binary.format, binary.bytes.data(), static_cast<GLsizei>(binary.bytes.length()));
+	//the binary goes to the driver straight from the mapped file: a 4 bytes format followed by the program
+	MappedFile cachedBinary(mCachedBinaryPath);
+	if (cachedBinary.size() > 4) {
+		uint32_t format;
+		memcpy(&format, cachedBinary.data(), 4);
+		glProgramBinary(mGLProgram, format, cachedBinary.data() + 4, static_cast<GLsizei>(cachedBinary.size() - 4));
 
 		glGetProgramiv(mGLProgram, GL_LINK_STATUS, &linked);
 	}
 
-	if (linked == 0) {
-		//ensure they're loaded
-		for (auto&& program : pProgram) {
-			if (not program.unwrap().isLoaded()) {
-				if (not program.unwrap().onLoad()) { //one program was not loaded, the shader can't work
-					return loaded;
-				}
+	if (linked) {
+		mLoadedFromCache = true;
+		return true;
+	}
+
+	//start compiling the programs that aren't being compiled already
+	for (auto&& program : pProgram) {
+		auto& p = program.unwrap();
+		if (not p.isLoaded() and not p.isCompiling()) {
+			if (not p._beginLoad()) { //one program can't be loaded, the shader can't work
+				glDeleteProgram(mGLProgram);
+				mGLProgram = 0;
+				return false;
 			}
 		}
+	}
 
-		for (auto&& program : pProgram) {
-			glAttachShader(mGLProgram, program.unwrap().getGLShader());
-		}
-		glLinkProgram(mGLProgram);
+	for (auto&& program : pProgram) {
+		glAttachShader(mGLProgram, program.unwrap().getGLShader());
+	}
+	glLinkProgram(mGLProgram);
 
-		//now as it was successful, store the compiled shader for next time
-		Binary obj;
-		GLsizei length;
+	mLinking = true;
+	return true;
+}
 
-		glGetProgramiv(mGLProgram, GL_PROGRAM_BINARY_LENGTH, &length);
-		obj.bytes.resize(length);
-		glGetProgramBinary(mGLProgram, length, nullptr, &obj.format, (char*)obj.bytes.data());
+bool Shader::_isLinkComplete() const {
+	if (not mLinking) {
+		return true;
+	}
+
+	if (Platform::singleton().getRenderer().supportsParallelShaderCompile()) {
+		GLint done = 0;
+		glGetProgramiv(mGLProgram, Renderer::GLCompletionStatus, &done);
+		return done != 0;
+	}
+	//without the extension there's no way to know, _endLoad will just block
+	return true;
+}
+
+bool Shader::_endLoad() {
+	int linked = 0;
+
+	if (mLinking) {
+		mLinking = false;
+
+		//finish the programs that were started with this shader
+		for (auto&& program : pProgram) {
+			auto& p = program.unwrap();
+			if (p.isCompiling()) {
+				p._endLoad();
+			}
+		}
 
 		//check if the linking went ok
 		glGetProgramiv(mGLProgram, GL_LINK_STATUS, &linked);
 
+		//now as it was successful, store the compiled shader for next time
 		if (linked) {
-			_storeCachedBinary(cachedPath, obj);
+			Binary obj;
+			GLsizei length;
+
+			glGetProgramiv(mGLProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+			obj.bytes.resize(length);
+			glGetProgramBinary(mGLProgram, length, nullptr, &obj.format, (char*)obj.bytes.data());
+
+			_storeCachedBinary(mCachedBinaryPath, obj);
 		}
 	}
-
+	else {
+		linked = mLoadedFromCache;
+	}
 
 	loaded = linked != 0;
 	DEBUG_ASSERT(linked, "Could not link a shader program");
 
 	if (linked) {
+		_bindUniformBlock("DojoFrame", sizeof(FrameUniformBlock), FrameBlockBinding);
+		_bindUniformBlock("DojoView", sizeof(ViewUniformBlock), ViewBlockBinding);
+
 		GLchar namebuf[1024];
 		int nameLength, size;
 		uint32_t type;
 		GLint elemCount;
 
+		//keep the user callbacks of a previous load, but not the values uploaded to the old program
+		auto previousUniforms = std::move(mUniforms);
+		mUniforms.clear();
+		mAttributes.clear();
+
 		//get uniforms and their locations
 		glGetProgramiv(mGLProgram, GL_ACTIVE_UNIFORMS, &elemCount);
 
@@ -396,6 +496,12 @@ bool Shader::onLoad() {
 			}
 		}
 
+		for (auto&& previous : previousUniforms) {
+			if (previous.customDataBinding) {
+				setUniformCallback(previous.name, previous.customDataBinding);
+			}
+		}
+
 		//get attributes and their locations
 		glGetProgramiv(mGLProgram, GL_ACTIVE_ATTRIBUTES, &elemCount);
 
@@ -412,6 +518,18 @@ bool Shader::onLoad() {
 			}
 		}
 	}
+	else {
+		glDeleteProgram(mGLProgram);
+		mGLProgram = 0;
+	}
+
+	return loaded;
+}
+
+bool Shader::onLoad() {
+	if (_beginLoad()) {
+		_endLoad();
+	}
 
 	return loaded;
 }
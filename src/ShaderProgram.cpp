@@ -1,6 +1,7 @@
 #include "ShaderProgram.h"
 
 #include "Platform.h"
+#include "Renderer.h"
 #include "FileStream.h"
 #include "Path.h"
 
@@ -35,7 +36,58 @@ ShaderProgram::ShaderProgram(ShaderProgramType type, std::string&& contents) :
 	DEBUG_ASSERT(mContentString.size(), "No shader code was defined (empty string)");
 }
 
-bool ShaderProgram::_load() {
+///finds the #version directive that starts a line outside of comments, or npos
+static size_t findVersionDirective(const std::string& source) {
+	const std::string directive = "#version";
+	bool inBlockComment = false;
+
+	for (size_t lineStart = 0; lineStart < source.size();) {
+		auto lineEnd = std::min(source.find('\n', lineStart), source.size());
+
+		auto i = lineStart;
+		bool lineStarted = false;
+		while (i < lineEnd) {
+			if (inBlockComment) {
+				auto end = source.find("*/", i);
+				if (end == std::string::npos or end >= lineEnd) {
+					break;
+				}
+				inBlockComment = false;
+				i = end + 2;
+			}
+			else if (source[i] == ' ' or source[i] == '\t' or source[i] == '\r') {
+				++i;
+			}
+			else if (source.compare(i, 2, "/*") == 0) {
+				inBlockComment = true;
+				i += 2;
+			}
+			else {
+				//a line comment or anything else that isn't a directive ends the search on this line
+				if (not lineStarted and source.compare(i, directive.size(), directive) == 0) {
+					return i;
+				}
+				lineStarted = true;
+
+				//a block comment could still open later in the line
+				auto open = source.find("/*", i);
+				auto comment = source.find("//", i);
+				if (open < lineEnd and open < comment) {
+					inBlockComment = true;
+					i = open + 2;
+				}
+				else {
+					break;
+				}
+			}
+		}
+
+		lineStart = lineEnd + 1;
+	}
+	return std::string::npos;
+}
+
+bool ShaderProgram::_compile() {
 	static const uint32_t typeGLTypeMap[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
 
 	loaded = false;
@@ -65,18 +117,70 @@ bool ShaderProgram::_load() {
 		file->read((uint8_t*)mContentString.data() + idx, size);
 	}
 
-	//finally, append the version in front
-	auto buildUnit = "#version 100\n" + mContentString;
+	//finally, append the version in front; sources can ask for a newer one (eg. to use uniform blocks), which has to be moved before the preprocessor header
+	std::string buildUnit;
+	auto versionIdx = findVersionDirective(mContentString);
+	if (versionIdx == std::string::npos) {
+		buildUnit = "#version 100\n" + mContentString;
+	}
+	else {
+		auto lineEnd = std::min(mContentString.find('\n', versionIdx), mContentString.size());
+		buildUnit = mContentString.substr(versionIdx, lineEnd - versionIdx) + "\n";
+		buildUnit += mContentString.substr(0, versionIdx);
+		buildUnit += mContentString.substr(lineEnd);
+	}
 
-	GLint compiled, sourceLength = static_cast<GLint>(buildUnit.size());
+	GLint sourceLength = static_cast<GLint>(buildUnit.size());
 	const char* src = buildUnit.c_str();
 
 	mGLShader = glCreateShader(typeGLTypeMap[(uint8_t)mType]);
 
 	glShaderSource(mGLShader, 1, &src, &sourceLength); //load the program source
 
+	//don't ask for the status here, so that the driver can compile in the background
 	glCompileShader(mGLShader);
+	return true;
+}
+
+bool ShaderProgram::_isCompileComplete() const {
+	DEBUG_ASSERT(mCompiling, "This program isn't being compiled");
+
+	if (Platform::singleton().getRenderer().supportsParallelShaderCompile()) {
+		GLint done = 0;
+		glGetShaderiv(mGLShader, Renderer::GLCompletionStatus, &done);
+		return done != 0;
+	}
+	//without the extension there's no way to know, _endLoad will just block
+	return true;
+}
+
+bool ShaderProgram::_beginLoad() {
+	DEBUG_ASSERT(not isLoaded() and not mCompiling, "Cannot reload an already loaded program");
+
+	if (getFilePath().not_empty()) { //try loading from file
+		auto file = Platform::singleton().getFile(filePath);
+
+		if (not file->open(Stream::Access::Read)) {
+			return false;
+		}
+
+		auto size = file->getSize();
+		mContentString.resize((size_t)size);
+
+		file->read((uint8_t*)mContentString.data(), size);
+		file->close(); //close as soon as possible to release the file if there's an error
+	}
+
+	mCompiling = _compile();
+	return mCompiling;
+}
 
+bool ShaderProgram::_endLoad() {
+	DEBUG_ASSERT(mCompiling, "This program isn't being compiled");
+
+	mCompiling = false;
+
+	GLint compiled;
 	glGetShaderiv(mGLShader, GL_COMPILE_STATUS, &compiled);
 
 	loaded = compiled != 0;
@@ -110,21 +214,8 @@ void ShaderProgram::onUnload(bool soft /* = false */) {
 bool ShaderProgram::onLoad() {
 	DEBUG_ASSERT(not isLoaded(), "Cannot reload an already loaded program");
 
-	if (getFilePath().not_empty()) { //try loading from file
-		auto file = Platform::singleton().getFile(filePath);
-
-		if (file->open(Stream::Access::Read)) {
-			auto size = file->getSize();
-			mContentString.resize((size_t)size);
-
-			file->read((uint8_t*)mContentString.data(), size);
-			file->close(); //close as soon as possible to release the file if there's an error
-
-			loaded = _load(); //load from the temp buffer
-		}
-	}
-	else { //load from the in-memory string
-		loaded = _load();
+	if (_beginLoad()) {
+		_endLoad();
 	}
 
 	DEBUG_ASSERT(loaded, "A shader program failed to compile!");
@@ -1,11 +1,8 @@
-#include <ogg/ogg.h>
-#include <vorbis/codec.h>
-#include <vorbis/vorbisfile.h>
-
 #include "SoundBuffer.h"
 #include "FileStream.h"
 #include "MemoryInputStream.h"
 #include "Platform.h"
+#include "SoundManager.h"
 #include "WorkerPool.h"
 #include "Path.h"
 
@@ -13,42 +10,6 @@
 
 using namespace Dojo;
 
-//STATIC CALLBACKS
-size_t _vorbisRead(void* out, size_t size, size_t count, void* userdata) {
-	Stream* source = (Stream*)userdata;
-
-	return (size_t)source->read((uint8_t*)out, size * count);
-}
-
-int _vorbisSeek(void* userdata, ogg_int64_t offset, int whence) {
-	Stream* source = (Stream*)userdata;
-
-	return source->seek(offset, whence);
-}
-
-int _vorbisClose(void* userdata) {
-	Stream* source = (Stream*)userdata;
-
-	source->close();
-	return 0;
-}
-
-auto _vorbisTell(void* userdata) {
-	return (long)((Stream*)userdata)->getCurrentPosition(); /*safe*/
-}
-
-
-#define OGG_ENDIAN 0
-
-//store the callbacks
-ov_callbacks VORBIS_CALLBACKS = {
-	_vorbisRead,
-	_vorbisSeek,
-	_vorbisClose,
-	_vorbisTell
-};
-
-
 SoundBuffer::Chunk::Chunk(SoundBuffer& parent, int64_t streamStartPosition, int64_t uncompressedSize) :
 	size(0),
 	alBuffer(AL_NONE),
@@ -111,11 +72,51 @@ bool SoundBuffer::onLoad() {
 
 	DEBUG_ASSERT( ext == "ogg", "Sound file extension is not ogg" );
 
-	_loadOggFromFile();
+	if (mSpans.empty()) {
+		predecode();
+	}
+
+	for (auto&& span : mSpans) {
+		mChunks.emplace_back(make_unique<Chunk>(self, span.startPosition, span.size));
+	}
+
+	mSpans.clear();
+
+	if (mChunks.empty()) {
+		return false;
+	}
+
+	mChunks[0]->setDecoded(std::move(mFirstChunk));
+
+	if (not isStreaming()) {
+		mChunks[0]->get();    //get() it to avoid that it is unloaded by the sources, and load synchronously
+	}
 
 	return CHECK_AL_ERROR;
 }
 
+void SoundBuffer::predecode() {
+	DEBUG_ASSERT(not isLoaded(), "The SoundBuffer is already loaded");
+
+	mFile = Platform::singleton().getFile(filePath);
+	mSource = *mFile;
+
+	mSpans.clear();
+	bool valid = SoundDecoder::readLayout(*mFile, MAX_UNSTREAMED_SIZE, Chunk::MAX_SIZE, mSpans, mDuration);
+
+	DEBUG_ASSERT_INFO(valid, "Cannot load an ogg from the file", "path = " + filePath);
+
+	if (valid) {
+		//short sounds are decoded whole, streams only decode their first chunk so that they can start right away
+		auto& span = mSpans.front();
+		mFirstChunk = Platform::singleton().getSoundManager().getDecoder().decode(*mFile->copy(), _getCacheKey(span.startPosition), span);
+	}
+}
+
+utf::string SoundBuffer::_getCacheKey(int64_t startPosition) const {
+	return filePath + "#" + utf::to_string(startPosition);
+}
+
 
 void SoundBuffer::onUnload(bool soft) {
 	DEBUG_ASSERT( isLoaded(), "SoundBuffer is not loaded" );
@@ -135,70 +136,28 @@ void SoundBuffer::onUnload(bool soft) {
 bool SoundBuffer::Chunk::onLoad() {
 	DEBUG_ASSERT(not isLoaded(), "The Chunk is already loaded" );
 
-	alGenBuffers(1, &alBuffer); //gen the buffer if it didn't exist
-
-	CHECK_AL_ERROR;
-
-	//copy the source to avoid side-effects
-	auto source = pParent.mSource.unwrap().copy();
-
-	source->open(Stream::Access::Read);
-
-	DEBUG_ASSERT( source->isReadable(), "The data source for the Ogg stream could not be open, or isn't readable" );
-
-	std::vector<char> uncompressed((size_t)mUncompressedSize);
-
-	OggVorbis_File file;
-	vorbis_info* info;
-	ALenum format;
-	ALsizei totalRead = 0;
-	ALsizei read = 0;
-
-	int error = ov_open_callbacks(source.get(), &file, nullptr, 0, VORBIS_CALLBACKS);
-
-	DEBUG_ASSERT( error == 0, "Cannot load an ogg from the memory buffer" );
-
-	info = ov_info(&file, -1);
-
-	int wordSize = 2;
-	format = (info->channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
-
-	int bitrate = info->rate * 10; //wtf, why * 10 //HACK
-
-	//seek to the start of the file segment
-	error = ov_raw_seek(&file, mStartPosition);
-	DEBUG_ASSERT( error == 0, "Cannot seek into file" );
-
-	bool corrupt = false;
-
-	do {
-		int section = -1;
-		read = (ALsizei)ov_read(&file, uncompressed.data() + totalRead, (ALsizei)mUncompressedSize - totalRead, 0, wordSize, 1, &section);
-
-		if (read == OV_HOLE or read == OV_EBADLINK or read == OV_EINVAL) {
-			corrupt = true;
-		}
-
-		else if (read == 0) {
-			break;
-		}
+	auto pcm = std::move(mDecoded);
+	if (not pcm) {
+		//copy the source to avoid side-effects
+		auto source = pParent.mSource.unwrap().copy();
+		pcm = Platform::singleton().getSoundManager().getDecoder().decode(*source, pParent._getCacheKey(mStartPosition), { mStartPosition, mUncompressedSize });
+	}
 
-		else {
-			totalRead += read;
-		}
+	if (not pcm) {
+		return false;
+	}
 
-		DEBUG_ASSERT( totalRead <= mUncompressedSize, "Total read bytes overflow the buffer" ); //this should always be true
+	alGenBuffers(1, &alBuffer); //gen the buffer if it didn't exist
 
-	}
-	while (not corrupt and totalRead < mUncompressedSize);
+	CHECK_AL_ERROR;
 
-	ov_clear(&file);
+	ALenum format = (pcm->channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
 
-	DEBUG_ASSERT(not corrupt, "an ogg vorbis stream was corrupt and could not be read" );
-	DEBUG_ASSERT( totalRead > 0, "no data was read from the stream" );
+	int bitrate = pcm->rate * 10; //wtf, why * 10 //HACK
 
-	alBufferData(alBuffer, format, uncompressed.data(), totalRead, bitrate);
+	alBufferData(alBuffer, format, pcm->samples.data(), (ALsizei)pcm->samples.size(), bitrate);
 
+	size = (uint32_t)pcm->samples.size();
 	loaded = CHECK_AL_ERROR;
 
 	return loaded;
@@ -212,8 +171,6 @@ void SoundBuffer::Chunk::loadAsync() {
 	//async load
 	Platform::singleton().getBackgroundPool().queue([this] {
 		onLoad();
-
-		std::this_thread::sleep_for(std::chrono::milliseconds(20)); //HACK
 	},
 	[&] { //then,
 		release();
@@ -236,76 +193,6 @@ void SoundBuffer::Chunk::onUnload(bool soft /* = false */) {
 	}
 }
 
-bool SoundBuffer::_loadOgg(Stream& source) {
-	if (not source.open(Stream::Access::Read)) {
-		DEBUG_ASSERT(source.isReadable(), "The data source for the Ogg stream could not be open, or isn't readable" );
-
-		return false;
-	}
-
-	OggVorbis_File file;
-	vorbis_info* info;
-
-	int error = ov_open_callbacks(&source, &file, nullptr, 0, VORBIS_CALLBACKS);
-
-	DEBUG_ASSERT( error == 0, "Cannot load an ogg from the memory buffer" );
-
-	info = ov_info(&file, -1);
-
-	int wordSize = 2;
-	
-	ogg_int64_t totalPCM = ov_pcm_total(&file, -1);
-
-	//find the number of chunks that we want
-	int chunkN = 1;
-	//HACK for( ; uncompressedSize / chunkN > Chunk::MAX_SIZE; chunkN++ );
-	ogg_int64_t chunkPCM = totalPCM / chunkN;
-
-	mDuration = (float)totalPCM / (float)info->rate;
-
-	ogg_int64_t fileStart = 0, fileEnd = -1;
-	ogg_int64_t pcmStart = 0, pcmEnd = -1;
-
-	//load all the needed chunks
-	for (;;) {
-		pcmEnd = std::min(totalPCM, pcmStart + chunkPCM);
-
-		ov_pcm_seek_page(&file, pcmEnd);
-		fileEnd = ov_raw_tell(&file);
-
-		if (fileStart == fileEnd) { //check if EOF
-			break;
-		}
-
-		if (pcmEnd == pcmStart) { //buffer is too small, let's assume that there is just one page
-			pcmEnd = totalPCM;
-		}
-
-		ogg_int64_t byteSize = (pcmEnd - pcmStart) * wordSize * info->channels;
-		mChunks.emplace_back(make_unique<Chunk>(self, fileStart, byteSize));
-
-		pcmStart = pcmEnd;
-		fileStart = fileEnd;
-	}
-
-	ov_clear(&file);
-
-	if (not isStreaming()) {
-		mChunks[0]->get();    //get() it to avoid that it is unloaded by the sources, and load synchronously
-	}
-
-	return true;
-}
-
-bool SoundBuffer::_loadOggFromFile() {
-	mFile = Platform::singleton().getFile(filePath);
-	mSource = *mFile;
-
-	_loadOgg(mSource.unwrap());
-
-	return isLoaded();
-}
-
 SoundBuffer::Chunk& SoundBuffer::getChunk(int n, bool loadAsync /*= false */) {
 	DEBUG_ASSERT(n >= 0 and n < (int)mChunks.size(), "The requested chunk is out of bounds");
 
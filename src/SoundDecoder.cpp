@@ -0,0 +1,244 @@
+#include <ogg/ogg.h>
+#include <vorbis/codec.h>
+#include <vorbis/vorbisfile.h>
+
+#include "SoundDecoder.h"
+#include "Stream.h"
+#include "Timer.h"
+
+using namespace Dojo;
+
+//STATIC CALLBACKS
+size_t _vorbisRead(void* out, size_t size, size_t count, void* userdata) {
+	Stream* source = (Stream*)userdata;
+
+	return (size_t)source->read((uint8_t*)out, size * count);
+}
+
+int _vorbisSeek(void* userdata, ogg_int64_t offset, int whence) {
+	Stream* source = (Stream*)userdata;
+
+	return source->seek(offset, whence);
+}
+
+int _vorbisClose(void* userdata) {
+	Stream* source = (Stream*)userdata;
+
+	source->close();
+	return 0;
+}
+
+auto _vorbisTell(void* userdata) {
+	return (long)((Stream*)userdata)->getCurrentPosition(); /*safe*/
+}
+
+
+#define OGG_ENDIAN 0
+
+//store the callbacks
+ov_callbacks VORBIS_CALLBACKS = {
+	_vorbisRead,
+	_vorbisSeek,
+	_vorbisClose,
+	_vorbisTell
+};
+
+namespace {
+	const int WordSize = 2;
+
+	bool openOgg(Stream& source, OggVorbis_File& file) {
+		if (not source.open(Stream::Access::Read)) {
+			return false;
+		}
+
+		if (ov_open_callbacks(&source, &file, nullptr, 0, VORBIS_CALLBACKS) != 0) {
+			//a failed open doesn't close the source
+			source.close();
+			return false;
+		}
+		return true;
+	}
+}
+
+bool SoundDecoder::readLayout(Stream& source, int64_t maxSingleSize, int64_t spanSize, std::vector<Span>& out, float& duration) {
+	DEBUG_ASSERT(spanSize > 0, "Invalid span size");
+
+	OggVorbis_File file;
+	if (not openOgg(source, file)) {
+		return false;
+	}
+
+	auto info = ov_info(&file, -1);
+	int64_t frameSize = WordSize * info->channels;
+
+	ogg_int64_t totalPCM = ov_pcm_total(&file, -1);
+	duration = (float)totalPCM / (float)info->rate;
+
+	ogg_int64_t totalSize = totalPCM * frameSize;
+	ogg_int64_t spanCount = totalSize <= maxSingleSize ? 1 : (totalSize + spanSize - 1) / spanSize;
+	ogg_int64_t spanPCM = (totalPCM + spanCount - 1) / spanCount;
+
+	ogg_int64_t fileStart = 0, fileEnd = -1;
+	ogg_int64_t pcmStart = 0, pcmEnd = -1;
+
+	//spans have to start on a page boundary to be decoded on their own
+	for (;;) {
+		pcmEnd = std::min(totalPCM, pcmStart + spanPCM);
+
+		ov_pcm_seek_page(&file, pcmEnd);
+		fileEnd = ov_raw_tell(&file);
+
+		if (fileStart == fileEnd) { //check if EOF
+			break;
+		}
+
+		if (pcmEnd == pcmStart) { //buffer is too small, let's assume that there is just one page
+			pcmEnd = totalPCM;
+		}
+
+		int64_t byteSize = (pcmEnd - pcmStart) * frameSize;
+		if (byteSize <= 0) {
+			break;
+		}
+
+		out.push_back({ fileStart, byteSize });
+
+		pcmStart = pcmEnd;
+		fileStart = fileEnd;
+	}
+
+	ov_clear(&file);
+
+	return not out.empty();
+}
+
+SoundDecoder::SoundDecoder(int64_t cacheSize) :
+	mCacheSize(cacheSize) {
+	DEBUG_ASSERT(cacheSize >= 0, "Invalid cache size");
+}
+
+SoundDecoder::PCMPtr SoundDecoder::_decode(Stream& source, const Span& span) {
+	OggVorbis_File file;
+	if (not openOgg(source, file)) {
+		return nullptr;
+	}
+
+	auto info = ov_info(&file, -1);
+
+	auto pcm = make_shared<PCM>();
+	pcm->channels = info->channels;
+	pcm->rate = info->rate;
+	pcm->samples.resize((size_t)span.size);
+
+	//seek to the start of the file segment
+	bool corrupt = ov_raw_seek(&file, span.startPosition) != 0;
+	DEBUG_ASSERT(not corrupt, "Cannot seek into file");
+
+	int64_t totalRead = 0;
+	while (not corrupt and totalRead < span.size) {
+		int section = -1;
+		auto read = ov_read(&file, pcm->samples.data() + totalRead, (int)std::min<int64_t>(span.size - totalRead, INT_MAX), OGG_ENDIAN, WordSize, 1, &section);
+
+		if (read == OV_HOLE or read == OV_EBADLINK or read == OV_EINVAL) {
+			corrupt = true;
+		}
+		else if (read == 0) {
+			break;
+		}
+		else {
+			totalRead += read;
+		}
+	}
+
+	ov_clear(&file);
+
+	DEBUG_ASSERT(not corrupt, "an ogg vorbis stream was corrupt and could not be read");
+	DEBUG_ASSERT(totalRead > 0, "no data was read from the stream");
+
+	if (corrupt or totalRead == 0) {
+		return nullptr;
+	}
+
+	pcm->samples.resize((size_t)totalRead);
+	return pcm;
+}
+
+SoundDecoder::PCMPtr SoundDecoder::decode(Stream& source, utf::string_view key, const Span& span) {
+	std::string cacheKey(key.data(), key.byte_size());
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto elem = mCache.find(cacheKey);
+		if (elem != mCache.end()) {
+			mUses.splice(mUses.begin(), mUses, elem->second.use);
+			++mStats.hits;
+			return elem->second.pcm;
+		}
+
+		++mStats.misses;
+	}
+
+	//decode without holding the lock, so that other threads can decode at the same time
+	Timer timer;
+	auto pcm = _decode(source, span);
+	if (not pcm) {
+		return nullptr;
+	}
+
+	auto size = (int64_t)pcm->samples.size();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats.decodedBytes += size;
+	mStats.decodeTime += (float)timer.getElapsedTime();
+
+	//another thread might have decoded the same span meanwhile
+	if (size <= mCacheSize and mCache.find(cacheKey) == mCache.end()) {
+		mUses.push_front(cacheKey);
+		mCache.emplace(std::move(cacheKey), CacheEntry{ pcm, mUses.begin() });
+		mCachedBytes += size;
+
+		_trim();
+	}
+
+	return pcm;
+}
+
+void SoundDecoder::_trim() {
+	while (mCachedBytes > mCacheSize and not mUses.empty()) {
+		auto elem = mCache.find(mUses.back());
+		mCachedBytes -= (int64_t)elem->second.pcm->samples.size();
+		mCache.erase(elem);
+		mUses.pop_back();
+	}
+}
+
+void SoundDecoder::setCacheSize(int64_t bytes) {
+	DEBUG_ASSERT(bytes >= 0, "Invalid cache size");
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCacheSize = bytes;
+	_trim();
+}
+
+int64_t SoundDecoder::getCacheSize() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCacheSize;
+}
+
+int64_t SoundDecoder::getCachedBytes() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCachedBytes;
+}
+
+void SoundDecoder::clear() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCache.clear();
+	mUses.clear();
+	mCachedBytes = 0;
+}
+
+SoundDecoder::Stats SoundDecoder::getStats() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
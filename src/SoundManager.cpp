@@ -22,6 +22,10 @@ SoundManager::SoundManager() :
 	musicVolume(1),
 	masterVolume(1),
 	currentFadeTime(0) {
+	auto& config = Platform::singleton().getUserConfiguration();
+	mDecoder = make_unique<SoundDecoder>(config.getInt("sound_cache_MB", DefaultDecodedCacheSize) * 1024ll * 1024);
+	setStreamReadAhead(config.getInt("sound_read_ahead", DefaultStreamReadAhead));
+
 	alGetError();
 
 	// Initialization
@@ -157,6 +161,7 @@ void SoundManager::update(float dt) {
 		current->_update(dt);
 
 		if (current->_isWaitingForDelete()) {
+			mFinishedUnderruns += current->getUnderrunCount();
 			current->_reset();
 
 			idleSoundPool.emplace_back(std::move(current));
@@ -215,6 +220,12 @@ void SoundManager::update(float dt) {
 	}
 }
 
+void SoundManager::setStreamReadAhead(int chunks) {
+	DEBUG_ASSERT(chunks >= 1, "Streams need to read at least one chunk ahead");
+
+	mStreamReadAhead = chunks;
+}
+
 void SoundManager::resumeMusic() {
 	//resume music, but only if the user didn't enable itunes meanwhile!
 	if (musicTrack.is_some() and not Platform::singleton().isSystemSoundInUse()) {
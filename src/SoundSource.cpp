@@ -19,9 +19,11 @@ void SoundSource::_reset() {
 	position = Vector::Zero;
 	positionChanged = true;
 	buffer = {};
-	mFrontChunk = {};
-	mBackChunk = {};
-	mCurrentChunkID = 0;
+	mChunks.clear();
+	mQueuedChunks = 0;
+	mNextChunkID = 0;
+	mUnderruns = 0;
+	mStarved = false;
 
 	//set default parameters
 	baseVolume = 1.0f;
@@ -66,12 +68,13 @@ void SoundSource::play(float volume) {
 			//set global parameters
 			alSourcef(source, AL_REFERENCE_DISTANCE, 1.0f);
 
-			auto chunkNumber = b.getChunkNumber();
+			auto& first = b.getChunk(0);
+			mChunks.push_back(&first);
+			mNextChunkID = 1;
 
-			mFrontChunk = b.getChunk(0);
-			ALuint alBuffer = mFrontChunk.unwrap().getOpenALBuffer();
+			ALuint alBuffer = first.getOpenALBuffer();
 
-			if (chunkNumber == 1) { //non-streaming
+			if (not b.isStreaming()) {
 				alSourcei(source, AL_BUFFER, alBuffer);
 				CHECK_AL_ERROR;
 			}
@@ -80,8 +83,8 @@ void SoundSource::play(float volume) {
 				mQueuedChunks = 1;
 				CHECK_AL_ERROR;
 
-				//start loading in the back buffer
-				mBackChunk = b.getChunk(++mCurrentChunkID, true);
+				//start loading the next chunks
+				_fillQueue();
 			}
 		}
 		else {
@@ -121,9 +124,49 @@ void SoundSource::rewind() {
 		state = SS_INITIALISING;
 
 		alSourceRewind(source);
+
+		//play() starts again from the first chunk
+		alSourcei(source, AL_BUFFER, AL_NONE);
+		_releaseChunks();
 	}
 }
 
+void SoundSource::_fillQueue() {
+	auto& b = buffer.unwrap();
+	auto chunkNumber = b.getChunkNumber();
+	auto depth = 1 + (size_t)Platform::singleton().getSoundManager().getStreamReadAhead();
+
+	//start loading the next chunks in the background, loop if the source is looping, else stop at the end
+	while (mChunks.size() < depth) {
+		if (mNextChunkID >= chunkNumber) {
+			if (not looping) {
+				break;
+			}
+			mNextChunkID = 0;
+		}
+
+		mChunks.push_back(&b.getChunk((int)mNextChunkID++, true));
+	}
+
+	//queue the chunks that finished loading, in order
+	while (mQueuedChunks < mChunks.size() and mChunks[mQueuedChunks]->isLoaded()) {
+		ALuint alBuffer = mChunks[mQueuedChunks]->getOpenALBuffer();
+		alSourceQueueBuffers(source, 1, &alBuffer);
+		++mQueuedChunks;
+		CHECK_AL_ERROR;
+	}
+}
+
+void SoundSource::_releaseChunks() {
+	for (auto&& chunk : mChunks) {
+		chunk->release();
+	}
+
+	mChunks.clear();
+	mQueuedChunks = 0;
+	mNextChunkID = 0;
+}
+
 
 void SoundSource::_update(float dt) {
 	//it can be moving, update pos
@@ -140,60 +183,45 @@ void SoundSource::_update(float dt) {
 		CHECK_AL_ERROR;
 	}
 
-	//if streaming, check if buffers have been used and replenish the queue
-	if (isStreaming() and mBackChunk.is_some()) {
-		//check if the backbuffer has finished loading and add it to the queue
-		if (mQueuedChunks == 1 and mBackChunk.unwrap().isLoaded()) {
-			ALuint b = mBackChunk.unwrap().getOpenALBuffer();
-			alSourceQueueBuffers(source, 1, &b);
-			++mQueuedChunks;
-			CHECK_AL_ERROR;
-		}
-
-		//check if the front buffer stopped streaming, move and pull a new backbuffer
+	//if streaming, release the chunks that were played and replenish the queue
+	if (isStreaming() and not mChunks.empty()) {
 		ALint processed;
 		alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
 
-		if (processed) {
-			//pop the old buffer
+		for (; processed > 0 and mQueuedChunks > 0; --processed) {
 			ALuint b;
 			alSourceUnqueueBuffers(source, 1, &b);
 			--mQueuedChunks;
 			CHECK_AL_ERROR;
 
-			mFrontChunk.unwrap().release();
-			mFrontChunk = mBackChunk;
+			mChunks.front()->release();
+			mChunks.pop_front();
+		}
 
-			//find the new buffer ID, loop if the source is looping, else go OOB and stop
-			++mCurrentChunkID;
+		_fillQueue();
+	}
 
-			if (looping and mCurrentChunkID >= buffer.unwrap().getChunkNumber()) {
-				mCurrentChunkID = mCurrentChunkID % buffer.unwrap().getChunkNumber();
-			}
+	alGetSourcei(source, AL_SOURCE_STATE, &playState);
 
-			if (mCurrentChunkID < buffer.unwrap().getChunkNumber()) { //not exhausted? start loading a new backbuffer
-				mBackChunk = buffer.unwrap().getChunk(mCurrentChunkID, true);
-			}
+	//a stream that stopped with chunks left to play ran out of loaded data, restart it as soon as there is some
+	if (state == SS_PLAYING and playState == AL_STOPPED and isStreaming() and not mChunks.empty()) {
+		if (not mStarved) {
+			++mUnderruns;
+			mStarved = true;
+		}
 
-			else {
-				mBackChunk = {};
-			}
+		if (mQueuedChunks > 0) {
+			alSourcePlay(source);
+			mStarved = false;
 		}
+		return;
 	}
 
-	alGetSourcei(source, AL_SOURCE_STATE, &playState);
-
 	if (autoRemove and state == SS_PLAYING and playState == AL_STOPPED) {
 		alSourcei(source, AL_BUFFER, AL_NONE); //clear the buffer for source reusing - this ALSO works for queued buffers
 
 		//release all the used chunks
-		if (auto chunk = mFrontChunk.to_ref()) {
-			chunk.get().release();
-		}
-
-		if (auto chunk = mBackChunk.to_ref()) {
-			chunk.get().release();
-		}
+		_releaseChunks();
 
 		state = SS_FINISHED;
 	}
@@ -221,6 +249,8 @@ void SoundSource::stop() {
 		alSourceStop(source);
 
 		alSourcei(source, AL_BUFFER, AL_NONE);
+
+		_releaseChunks();
 	}
 }
 
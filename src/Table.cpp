@@ -1,6 +1,7 @@
 #include "Table.h"
 #include "Platform.h"
 #include "FileStream.h"
+#include "MappedFile.h"
 #include "Base64.h"
 
 using namespace Dojo;
@@ -11,15 +12,13 @@ const Table::Data Table::Data::Empty{};
 Table Table::loadFromFile(utf::string_view path) {
 	DEBUG_ASSERT( path.not_empty(), "Tried to load a Table from an empty path string" );
 
-	auto file = Platform::singleton().getFile(path);
+	MappedFile file(path);
 
 	Table dest;
 
-	if (file->open(Stream::Access::Read)) {
-		//read the contents directly in a string
-		std::string buf((size_t)file->getSize(), 0);
-
-		file->readToFill(buf);
+	if (file.isOpen()) {
+		//the reader needs to own its string, so this is the only copy of the content
+		std::string buf((const char*)file.data(), file.size());
 
 		StringReader reader(utf::string(std::move(buf)));
 		dest.deserialize(reader);
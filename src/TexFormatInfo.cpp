@@ -2,19 +2,79 @@
 
 #include <glad/glad.h>
 
+//compressed format enums might be missing from the GL headers depending on the extensions they were generated with
+#ifndef GL_COMPRESSED_RGB8_ETC2
+	#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+	#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+	#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_8x8_KHR
+	#define GL_COMPRESSED_RGBA_ASTC_8x8_KHR 0x93B7
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+	#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+	#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+	#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_SRGB8_ETC2
+	#define GL_COMPRESSED_SRGB8_ETC2 0x9275
+#endif
+#ifndef GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC
+	#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC 0x9279
+#endif
+#ifndef GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR
+	#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR 0x93D0
+#endif
+#ifndef GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR
+	#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR 0x93D7
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+	#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+	#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+	#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
 namespace Dojo {
 	const Dojo::TexFormatInfo& TexFormatInfo::getFor(PixelFormat format) {
 		static const TexFormatInfo GLFormat[] = {
-			{ 4, GL_RGBA8, GL_UNSIGNED_BYTE,					4, GL_RGBA, GL_UNSIGNED_BYTE, true },
-			{ 3, GL_RGB8, GL_UNSIGNED_BYTE,					3, GL_RGB, GL_UNSIGNED_BYTE, false },
-			{ 2, GL_RGB8, GL_UNSIGNED_SHORT_5_6_5,		    3, GL_RGB, GL_UNSIGNED_BYTE, false },
-			{ 4, GL_RGBA8, GL_UNSIGNED_INT_2_10_10_10_REV,	4, GL_RGBA, GL_UNSIGNED_BYTE,  true },
-			{ 4, GL_SRGB8_ALPHA8, GL_UNSIGNED_BYTE,			4, GL_RGBA, GL_UNSIGNED_BYTE, true },
-			{ 3, GL_SRGB8, GL_UNSIGNED_BYTE,				3, GL_RGB, GL_UNSIGNED_BYTE, false },
-			{ 8, GL_RGBA16F, GL_HALF_FLOAT,					16, GL_RGBA, GL_FLOAT, false },
-			{ 1, GL_R8, GL_UNSIGNED_BYTE,					1, GL_RED, GL_UNSIGNED_BYTE, false },
-			{ 2, GL_RG8, GL_UNSIGNED_BYTE,					2, GL_RG, GL_UNSIGNED_BYTE, false },
-			{ 1, GL_R8, GL_UNSIGNED_BYTE,					1, GL_ALPHA, GL_UNSIGNED_BYTE, true },
+			{ 4, GL_RGBA8, GL_UNSIGNED_BYTE,					4, GL_RGBA, GL_UNSIGNED_BYTE, true,		1, 1, 0 },
+			{ 3, GL_RGB8, GL_UNSIGNED_BYTE,					3, GL_RGB, GL_UNSIGNED_BYTE, false,		1, 1, 0 },
+			{ 2, GL_RGB8, GL_UNSIGNED_SHORT_5_6_5,		    3, GL_RGB, GL_UNSIGNED_BYTE, false,		1, 1, 0 },
+			{ 4, GL_RGBA8, GL_UNSIGNED_INT_2_10_10_10_REV,	4, GL_RGBA, GL_UNSIGNED_BYTE,  true,	1, 1, 0 },
+			{ 4, GL_SRGB8_ALPHA8, GL_UNSIGNED_BYTE,			4, GL_RGBA, GL_UNSIGNED_BYTE, true,		1, 1, 0 },
+			{ 3, GL_SRGB8, GL_UNSIGNED_BYTE,				3, GL_RGB, GL_UNSIGNED_BYTE, false,		1, 1, 0 },
+			{ 8, GL_RGBA16F, GL_HALF_FLOAT,					16, GL_RGBA, GL_FLOAT, false,			1, 1, 0 },
+			{ 1, GL_R8, GL_UNSIGNED_BYTE,					1, GL_RED, GL_UNSIGNED_BYTE, false,		1, 1, 0 },
+			{ 2, GL_RG8, GL_UNSIGNED_BYTE,					2, GL_RG, GL_UNSIGNED_BYTE, false,		1, 1, 0 },
+			{ 1, GL_R8, GL_UNSIGNED_BYTE,					1, GL_ALPHA, GL_UNSIGNED_BYTE, true,	1, 1, 0 },
+
+			{ 0, GL_COMPRESSED_RGB8_ETC2, 0,					0, 0, 0, false,		4, 4, 8 },
+			{ 0, GL_COMPRESSED_RGBA8_ETC2_EAC, 0,				0, 0, 0, true,		4, 4, 16 },
+			{ 0, GL_COMPRESSED_RGBA_ASTC_4x4_KHR, 0,			0, 0, 0, true,		4, 4, 16 },
+			{ 0, GL_COMPRESSED_RGBA_ASTC_8x8_KHR, 0,			0, 0, 0, true,		8, 8, 16 },
+			{ 0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 0,			0, 0, 0, false,		4, 4, 8 },
+			{ 0, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0,			0, 0, 0, true,		4, 4, 16 },
+			{ 0, GL_COMPRESSED_RGBA_BPTC_UNORM, 0,				0, 0, 0, true,		4, 4, 16 },
+
+			{ 0, GL_COMPRESSED_SRGB8_ETC2, 0,					0, 0, 0, false,		4, 4, 8 },
+			{ 0, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 0,		0, 0, 0, true,		4, 4, 16 },
+			{ 0, GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR, 0,	0, 0, 0, true,		4, 4, 16 },
+			{ 0, GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR, 0,	0, 0, 0, true,		8, 8, 16 },
+			{ 0, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 0,			0, 0, 0, false,		4, 4, 8 },
+			{ 0, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 0,		0, 0, 0, true,		4, 4, 16 },
+			{ 0, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 0,		0, 0, 0, true,		4, 4, 16 },
 			{ 0, 0, 0, 0, 0 },
 		};
 
@@ -22,4 +82,3 @@ namespace Dojo {
 	}
 
 }
-
@@ -4,6 +4,11 @@
 #include "ResourceGroup.h"
 #include "Mesh.h"
 #include "TexFormatInfo.h"
+#include "TextureContainer.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "Path.h"
+#include "Renderer.h"
 
 #include <glad/glad.h>
 
@@ -32,11 +37,14 @@ Texture::~Texture() {
 }
 
 void Texture::bind(uint32_t index) {
+	//atlas tiles always use the current handle of their parent, as streaming can replace it
+	auto handle = parentAtlas.is_some() ? parentAtlas.unwrap().glhandle : glhandle;
+
 	//create the gl texture if still not created!
-	DEBUG_ASSERT(glhandle, "This texture wasn't created yet");
+	DEBUG_ASSERT(handle, "This texture wasn't created yet");
 
 	glActiveTexture(GL_TEXTURE0 + index);
-	glBindTexture(GL_TEXTURE_2D, glhandle);
+	glBindTexture(GL_TEXTURE_2D, handle);
 }
 
 void Texture::enableAnisotropicFiltering(float level) {
@@ -50,6 +58,7 @@ void Texture::disableAnisotropicFiltering() {
 }
 
 void Texture::enableBilinearFiltering() {
+	mBilinear = true;
 	bind(0);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -57,12 +66,14 @@ void Texture::enableBilinearFiltering() {
 }
 
 void Texture::disableBilinearFiltering() {
+	mBilinear = false;
 	bind(0);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 }
 
 void Texture::enableTiling() {
+	mTiling = true;
 	bind(0);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -70,15 +81,45 @@ void Texture::enableTiling() {
 }
 
 void Texture::disableTiling() {
+	mTiling = false;
 	bind(0);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 }
 
+void Texture::_applySamplingState() {
+	mBilinear ? enableBilinearFiltering() : disableBilinearFiltering();
+	mTiling ? enableTiling() : disableTiling();
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mMipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+}
+
+static void _getStorageSize(uint32_t width, uint32_t height, uint32_t& destWidth, uint32_t& destHeight) {
+	//if the platforms supports NPOT, or the dimensions are already POT, direct copy
+	if ((glm::isPowerOfTwo(width) and glm::isPowerOfTwo(height)) or Platform::singleton().isNPOTEnabled()) {
+		destWidth = width;
+		destHeight = height;
+	}
+	else {
+		destWidth = glm::ceilPowerOfTwo(width);
+		destHeight = glm::ceilPowerOfTwo(height);
+	}
+}
+
+static bool _hasTransparency(const uint8_t* rgba, uint32_t width, uint32_t height) {
+	auto end = rgba + (width * height * 4);
+	for (auto alpha = rgba + 3; alpha < end; alpha += 4) {
+		if (*alpha < 250) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void Dojo::Texture::_addAsAttachment(uint32_t index, uint32_t width, uint32_t height, uint8_t miplevel) {
 	DEBUG_ASSERT(width == getWidth() and height == getHeight(), "Cannot add texture as attachment");
-	DEBUG_ASSERT(miplevel == 0, "Mipmaps aren't supported anymore :(");
+	DEBUG_ASSERT(miplevel < mMipLevels, "This mip level wasn't allocated");
 
 	bind(0);
 
@@ -93,59 +134,63 @@ void Dojo::Texture::_addAsAttachment(uint32_t index, uint32_t width, uint32_t he
 
 }
 
-bool Dojo::Texture::_createStorage(uint32_t w, uint32_t h, PixelFormat formatID) {
+bool Dojo::Texture::_createStorage(uint32_t w, uint32_t h, PixelFormat formatID, uint32_t levels) {
 	width = w;
 	height = h;
 
 	DEBUG_ASSERT(width > 0, "Width must be more than 0");
 	DEBUG_ASSERT(height > 0, "Height must be more than 0");
+	DEBUG_ASSERT(levels > 0, "A texture needs at least one level");
 
 	auto& formatInfo = TexFormatInfo::getFor(formatID);
 	auto& oldFormat = TexFormatInfo::getFor(internalFormat);
 
 	DEBUG_ASSERT(formatInfo.isGPUFormat(), "This format can't be loaded on the GPU!");
 
-	if (not glhandle) {
-		glGenTextures(1, &glhandle);
-	}
-	glBindTexture(GL_TEXTURE_2D, glhandle);
-
-	//TODO add back manually generated mipmaps
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-
 	uint32_t destWidth, destHeight;
-
-	//if the platforms supports NPOT, or the dimensions are already POT, direct copy
-	if (isPowerOfTwo() or Platform::singleton().isNPOTEnabled()) {
-		destWidth = width;
-		destHeight = height;
-	}
-	else {
-		destWidth = glm::ceilPowerOfTwo(width);
-		destHeight = glm::ceilPowerOfTwo(height);
-	}
+	_getStorageSize(width, height, destWidth, destHeight);
 
 	//check if the texture has to be recreated (changed dimensions)
-	if (destWidth != internalWidth or destHeight != internalHeight or oldFormat.internalFormat != formatInfo.internalFormat) {
+	if (destWidth != internalWidth or destHeight != internalHeight or oldFormat.internalFormat != formatInfo.internalFormat or levels != mMipLevels) {
+		//storage is immutable, so a texture that already has some needs a new handle
+		if (glhandle and internalWidth > 0) {
+			glDeleteTextures(1, &glhandle);
+			glhandle = 0;
+		}
+
 		internalWidth = destWidth;
 		internalHeight = destHeight;
 		internalFormat = formatID;
+		mMipLevels = levels;
 
 		auto internalSize = internalWidth * internalHeight * formatInfo.sourcePixelSize;
 		DEBUG_ASSERT(internalSize % 4 == 0, "OpenGL implementations choke on non-4-aligned buffers");
 
+		if (not glhandle) {
+			glGenTextures(1, &glhandle);
+		}
+		glBindTexture(GL_TEXTURE_2D, glhandle);
+
 		glTexStorage2D(
 			GL_TEXTURE_2D,
-			1, //TODO multiple levels?
+			mMipLevels,
 			formatInfo.internalFormat,
 			internalWidth,
 			internalHeight
 		);
 
-
+		//count the VRAM used by all the levels
+		size = 0;
+		for (uint32_t i = 0; i < mMipLevels; ++i) {
+			size += formatInfo.getByteSizeFor(MipGenerator::getLevelSize(internalWidth, i), MipGenerator::getLevelSize(internalHeight, i));
+		}
+	}
+	else {
+		glBindTexture(GL_TEXTURE_2D, glhandle);
 	}
 
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mMipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+
 	UVSize.x = (float)width / (float)internalWidth;
 	UVSize.y = (float)height / (float)internalHeight;
 
@@ -187,7 +232,7 @@ const uint8_t* convertToGPUFormat(const uint8_t* imageData, uint32_t width, uint
 	}
 }
 
-bool Texture::loadFromMemory(const uint8_t* imageData, uint32_t width, uint32_t height, PixelFormat format) {
+bool Texture::loadFromMemory(const uint8_t* imageData, uint32_t width, uint32_t height, PixelFormat format, bool generateMipmaps) {
 	DEBUG_ASSERT(imageData, "null image data");
 	DEBUG_ASSERT(width > 0 and height > 0, "Invalid dimensions");
 
@@ -195,29 +240,219 @@ bool Texture::loadFromMemory(const uint8_t* imageData, uint32_t width, uint32_t
 	std::vector<uint8_t> conversionBuffer;
 	imageData = convertToGPUFormat(imageData, width, height, format, conversionBuffer);
 
-	_createStorage(width, height, format);
+	_createStorage(width, height, format, generateMipmaps ? MipGenerator::getLevelCount(width, height) : 1);
 
 	auto& formatDesc = TexFormatInfo::getFor(format);
 
-	mTransparency = false;
-	if (formatDesc.hasAlpha) {
-		auto end = imageData + (width * height * 4);
-		for (auto alpha = imageData + 3; alpha < end; alpha += 4) {
-			if (*alpha < 250) {
-				mTransparency = true;
-				break;
-			}
+	mTransparency = formatDesc.hasAlpha and _hasTransparency(imageData, width, height);
+
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, formatDesc.sourceFormat, formatDesc.sourceElementType, imageData);
+
+	//generate the rest of the chain from the previous level
+	std::vector<uint8_t> level, nextLevel;
+	auto levelData = imageData;
+	for (uint32_t i = 1; i < mMipLevels; ++i) {
+		auto levelWidth = MipGenerator::getLevelSize(width, i);
+		auto levelHeight = MipGenerator::getLevelSize(height, i);
+
+		nextLevel.resize(levelWidth * levelHeight * 4);
+		MipGenerator::downsampleRGBA8(levelData, MipGenerator::getLevelSize(width, i - 1), MipGenerator::getLevelSize(height, i - 1), nextLevel.data());
+
+		glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, levelWidth, levelHeight, formatDesc.sourceFormat, formatDesc.sourceElementType, nextLevel.data());
+
+		std::swap(level, nextLevel);
+		levelData = level.data();
+	}
+
+	return loaded = true;
+}
+
+bool Texture::loadFromContainer(vec_view<uint8_t> containerData) {
+	TextureContainer container;
+	if (not container.parse(containerData)) {
+		return loaded = false;
+	}
+
+	//the blocks are uploaded as they are, so the GPU must be able to decode them
+	if (not Platform::singleton().getRenderer().supportsFormat(container.getFormat())) {
+		DEBUG_MESSAGE("Cannot load a texture container: the GPU doesn't support its compressed format");
+		return loaded = false;
+	}
+
+	auto& levels = container.getLevels();
+	_createStorage(container.getWidth(), container.getHeight(), container.getFormat(), (uint32_t)levels.size());
+
+	auto& formatDesc = TexFormatInfo::getFor(internalFormat);
+
+	for (uint32_t i = 0; i < levels.size(); ++i) {
+		auto& level = levels[i];
+		if (formatDesc.isCompressed()) {
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.width, level.height, formatDesc.internalFormat, (GLsizei)level.data.byte_size(), level.data.data());
+		}
+		else {
+			glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.width, level.height, formatDesc.sourceFormat, formatDesc.sourceElementType, level.data.data());
 		}
 	}
 
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, formatDesc.sourceFormat, formatDesc.sourceElementType, imageData);
+	mTransparency = container.hasTransparency();
 
 	return loaded = true;
 }
 
+void Texture::_setupSampling() {
+	if (creator.is_some() and creator.unwrap().disableBilinear) {
+		disableBilinearFiltering();
+	}
+	else {
+		enableBilinearFiltering();
+	}
+
+	enableTiling();
+}
+
+bool Texture::_readLevels(utf::string_view path, const FirstLevelSelector& firstLevelFor, LevelData& out) {
+	out.levels.clear();
+
+	if (Path::getFileExtension(path) == TextureContainer::Extension) {
+		MappedFile file(path);
+
+		TextureContainer container;
+		if (not container.parse(file.getContent())) {
+			return false;
+		}
+
+		if (not Platform::singleton().getRenderer().supportsFormat(container.getFormat())) {
+			DEBUG_MESSAGE("Cannot stream a texture container: the GPU doesn't support its compressed format");
+			return false;
+		}
+
+		auto& levels = container.getLevels();
+		out.width = container.getWidth();
+		out.height = container.getHeight();
+		out.format = container.getFormat();
+		out.transparency = container.hasTransparency();
+		out.levelCount = (uint32_t)levels.size();
+		out.firstLevel = std::min(firstLevelFor(out.width, out.height, out.levelCount), out.levelCount - 1);
+
+		for (auto i = out.firstLevel; i < out.levelCount; ++i) {
+			auto& data = levels[i].data;
+			out.levels.emplace_back(data.data(), data.data() + data.size());
+		}
+		return true;
+	}
+
+	int pixelSize;
+	std::vector<uint8_t> imageData;
+	auto format = Platform::singleton().loadImageFile(imageData, path, out.width, out.height, pixelSize);
+
+	if (format == PixelFormat::Unknown) {
+		return false;
+	}
+
+	std::vector<uint8_t> conversionBuffer;
+	auto rgba = convertToGPUFormat(imageData.data(), out.width, out.height, format, conversionBuffer);
+
+	out.format = format;
+	out.transparency = TexFormatInfo::getFor(format).hasAlpha and _hasTransparency(rgba, out.width, out.height);
+	out.levelCount = MipGenerator::getLevelCount(out.width, out.height);
+	out.firstLevel = std::min(firstLevelFor(out.width, out.height, out.levelCount), out.levelCount - 1);
+
+	//walk down the whole chain, keeping only the levels that were asked for
+	std::vector<uint8_t> level(rgba, rgba + out.width * out.height * 4), nextLevel;
+	for (uint32_t i = 0; i < out.levelCount; ++i) {
+		if (i > 0) {
+			nextLevel.resize(MipGenerator::getLevelSize(out.width, i) * MipGenerator::getLevelSize(out.height, i) * 4);
+			MipGenerator::downsampleRGBA8(level.data(), MipGenerator::getLevelSize(out.width, i - 1), MipGenerator::getLevelSize(out.height, i - 1), nextLevel.data());
+			std::swap(level, nextLevel);
+		}
+
+		if (i >= out.firstLevel) {
+			out.levels.emplace_back(level);
+		}
+	}
+	return true;
+}
+
+void Texture::_setupStreamed(const LevelData& data, TextureStreamer::Entry& entry) {
+	width = data.width;
+	height = data.height;
+	internalFormat = data.format;
+	mMipLevels = data.levelCount;
+	mTransparency = data.transparency;
+	mStreamingEntry = entry;
+
+	_getStorageSize(width, height, internalWidth, internalHeight);
+
+	UVSize.x = (float)width / (float)internalWidth;
+	UVSize.y = (float)height / (float)internalHeight;
+}
+
+void Texture::_uploadLevels(uint32_t firstLevel, const std::vector<std::vector<uint8_t>>& levels) {
+	DEBUG_ASSERT(firstLevel + levels.size() == mMipLevels, "The levels must go from firstLevel to the end of the chain");
+
+	auto& formatDesc = TexFormatInfo::getFor(internalFormat);
+
+	//the old storage is immutable and has the wrong size, replace it
+	if (glhandle) {
+		glDeleteTextures(1, &glhandle);
+	}
+	glGenTextures(1, &glhandle);
+	glBindTexture(GL_TEXTURE_2D, glhandle);
+
+	glTexStorage2D(
+		GL_TEXTURE_2D,
+		(GLsizei)levels.size(),
+		formatDesc.internalFormat,
+		MipGenerator::getLevelSize(internalWidth, firstLevel),
+		MipGenerator::getLevelSize(internalHeight, firstLevel)
+	);
+
+	size = 0;
+	for (uint32_t i = 0; i < levels.size(); ++i) {
+		auto level = firstLevel + i;
+		auto levelWidth = MipGenerator::getLevelSize(width, level);
+		auto levelHeight = MipGenerator::getLevelSize(height, level);
+		auto& data = levels[i];
+
+		if (formatDesc.isCompressed()) {
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, levelWidth, levelHeight, formatDesc.internalFormat, (GLsizei)data.size(), data.data());
+		}
+		else {
+			glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, levelWidth, levelHeight, formatDesc.sourceFormat, formatDesc.sourceElementType, data.data());
+		}
+
+		size += formatDesc.getByteSizeFor(MipGenerator::getLevelSize(internalWidth, level), MipGenerator::getLevelSize(internalHeight, level));
+	}
+
+	mResidentLevel = firstLevel;
+
+	_applySamplingState();
+	loaded = true;
+}
+
 bool Texture::loadFromFile(utf::string_view path) {
 	DEBUG_ASSERT(not isLoaded(), "The Texture is already loaded");
 
+	if (creator.is_some() and creator.unwrap().streamTextures) {
+		mBilinear = not creator.unwrap().disableBilinear;
+		mTiling = true;
+
+		Platform::singleton().getRenderer().getTextureStreamer().load(self);
+
+		DEBUG_ASSERT_INFO(loaded, "Cannot load a streamed texture", "path = " + path);
+		return loaded;
+	}
+
+	if (Path::getFileExtension(path) == TextureContainer::Extension) {
+		MappedFile file(path);
+		loadFromContainer(file.getContent());
+
+		DEBUG_ASSERT_INFO(loaded, "Cannot load a texture container", "path = " + path);
+
+		_setupSampling();
+		return loaded;
+	}
+
 	if (not glhandle) {
 		glGenTextures(1, &glhandle);
 	}
@@ -228,16 +463,10 @@ bool Texture::loadFromFile(utf::string_view path) {
 
 	DEBUG_ASSERT_INFO(format != PixelFormat::Unknown, "Cannot load an image file", "path = " + path);
 
-	if (creator.is_some() and creator.unwrap().disableBilinear) {
-		disableBilinearFiltering();
-	}
-	else {
-		enableBilinearFiltering();
-	}
-
-	enableTiling();
+	_setupSampling();
 
-	loadFromMemory(imageData.data(), width, height, format);
+	bool mipmaps = creator.is_none() or not creator.unwrap().disableMipmaps;
+	loadFromMemory(imageData.data(), width, height, format, mipmaps);
 
 	return loaded;
 }
@@ -258,27 +487,46 @@ bool Texture::_setupAtlas() {
 	glhandle = atlas.glhandle;
 
 	//find uv coordinates
-	UVOffset.x = (float)mAtlasOriginX / (float)internalWidth;
-	UVOffset.y = (float)mAtlasOriginY / (float)internalHeight;
+	UVOffset.x = (float)mAtlasTile.x / (float)internalWidth;
+	UVOffset.y = (float)mAtlasTile.y / (float)internalHeight;
 
-	//find uv size
-	UVSize.x = (float)width / (float)internalWidth;
-	UVSize.y = (float)height / (float)internalHeight;
+	//find uv size of the stored rect
+	UVSize.x = (float)(mAtlasTile.rotated ? mAtlasTile.height : mAtlasTile.width) / (float)internalWidth;
+	UVSize.y = (float)(mAtlasTile.rotated ? mAtlasTile.width : mAtlasTile.height) / (float)internalHeight;
 
 	return (loaded = true);
 }
 
 bool Texture::loadFromAtlas(Texture& tex, int x, int y, int sx, int sy) {
+	AtlasTile tile;
+	tile.x = x;
+	tile.y = y;
+	tile.width = sx;
+	tile.height = sy;
+
+	return loadFromAtlas(tex, tile);
+}
+
+bool Texture::loadFromAtlas(Texture& tex, const AtlasTile& tile) {
 	DEBUG_ASSERT(not isLoaded(), "The Texture is already loaded");
+	DEBUG_ASSERT(tile.width > 0 and tile.height > 0, "Invalid tile size");
 
 	parentAtlas = tex;
 	mTransparency = tex.mTransparency;
 
-	width = sx;
-	height = sy;
+	mAtlasTile = tile;
+	if (mAtlasTile.originalWidth == 0 or mAtlasTile.originalHeight == 0) {
+		mAtlasTile.originalWidth = tile.width;
+		mAtlasTile.originalHeight = tile.height;
+		mAtlasTile.trimX = mAtlasTile.trimY = 0;
+	}
+
+	//trimmed tiles keep the size of the original image
+	width = mAtlasTile.originalWidth;
+	height = mAtlasTile.originalHeight;
 
-	mAtlasOriginX = x;
-	mAtlasOriginY = y;
+	//invalidate the OBB
+	OBB.reset();
 
 	//actual lazy loading is in _setupAtlas
 
@@ -291,12 +539,13 @@ bool Texture::onLoad() {
 	//invalidate the OBB
 	OBB.reset();
 
-	if (isReloadable()) {
-		return loadFromFile(filePath);
-	}
-	else if (parentAtlas.is_some()) {
+	//textures packed in an auto atlas have both a path and a parent
+	if (parentAtlas.is_some()) {
 		return _setupAtlas();
 	}
+	else if (isReloadable()) {
+		return loadFromFile(filePath);
+	}
 	else {
 		return false;
 	}
@@ -310,13 +559,20 @@ void Texture::onUnload(bool soft) {
 			OBB->onUnload();
 		}
 
+		if (mStreamingEntry.is_some()) {
+			Platform::singleton().getRenderer().getTextureStreamer().remove(self);
+		}
+
 		if (parentAtlas.is_none()) { //don't unload parent texture!
 			DEBUG_ASSERT(glhandle, "Tried to unload a texture but the texture handle was invalid");
 			glDeleteTextures(1, &glhandle);
 
 			internalWidth = internalHeight = 0;
 			internalFormat = PixelFormat::Unknown;
+			mMipLevels = 1;
+			mResidentLevel = 0;
 			glhandle = 0;
+			size = 0;
 			parentAtlas = {};
 			mTransparency = false;
 		}
@@ -334,23 +590,38 @@ void Texture::_rebuildOptimalBillboard() {
 		OBB->setVertexFields({ VertexField::Position2D, VertexField::UV0 });
 	}
 
+	//the area of the quad covered by the image and the stored rect of each corner, in image space (v down)
+	float left = -0.5f, bottom = -0.5f, right = 0.5f, top = 0.5f;
+	if (parentAtlas.is_some()) {
+		left += (float)mAtlasTile.trimX / mAtlasTile.originalWidth;
+		right = left + (float)mAtlasTile.width / mAtlasTile.originalWidth;
+		top -= (float)mAtlasTile.trimY / mAtlasTile.originalHeight;
+		bottom = top - (float)mAtlasTile.height / mAtlasTile.originalHeight;
+	}
+
+	//rotated tiles are stored turned clockwise, so image u goes down and image v goes left
+	auto uv = [&](float u, float v) {
+		if (mAtlasTile.rotated) {
+			OBB->uv(UVOffset.x + (1.f - v) * UVSize.x, UVOffset.y + u * UVSize.y);
+		}
+		else {
+			OBB->uv(UVOffset.x + u * UVSize.x, UVOffset.y + v * UVSize.y);
+		}
+	};
+
 	OBB->begin(4);
 
-	OBB->vertex({ -0.5, -0.5 });
-	OBB->uv(UVOffset.x,
-		UVOffset.y + UVSize.y);
+	OBB->vertex({ left, bottom });
+	uv(0, 1);
 
-	OBB->vertex({ 0.5, -0.5 });
-	OBB->uv(UVOffset.x + UVSize.x,
-		UVOffset.y + UVSize.y);
+	OBB->vertex({ right, bottom });
+	uv(1, 1);
 
-	OBB->vertex({ -0.5, 0.5 });
-	OBB->uv(UVOffset.x,
-		UVOffset.y);
+	OBB->vertex({ left, top });
+	uv(0, 0);
 
-	OBB->vertex({ 0.5, 0.5 });
-	OBB->uv(UVOffset.x + UVSize.x,
-		UVOffset.y);
+	OBB->vertex({ right, top });
+	uv(1, 0);
 
 	OBB->end();
 }
@@ -0,0 +1,72 @@
+#include "TextureContainer.h"
+
+#include "TexFormatInfo.h"
+#include "MipGenerator.h"
+
+using namespace Dojo;
+
+const utf::string_view TextureContainer::Extension = "dtex";
+
+bool TextureContainer::parse(vec_view<uint8_t> data) {
+	mLevels.clear();
+
+	if (data.byte_size() < sizeof(Header)) {
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, data.data(), sizeof(Header));
+
+	if (memcmp(header.magic, "DTEX", 4) != 0 or header.version != Version) {
+		return false;
+	}
+
+	if (header.format >= (uint32_t)enum_cast(PixelFormat::Unknown) or header.width == 0 or header.height == 0) {
+		return false;
+	}
+
+	if (header.levelCount == 0 or header.levelCount > MipGenerator::getLevelCount(header.width, header.height)) {
+		return false;
+	}
+
+	auto levelTableEnd = sizeof(Header) + header.levelCount * sizeof(LevelEntry);
+	if (data.byte_size() < levelTableEnd) {
+		return false;
+	}
+
+	mFormat = (PixelFormat)header.format;
+	mWidth = header.width;
+	mHeight = header.height;
+	mTransparent = (header.flags & FLAG_TRANSPARENT) != 0;
+
+	auto& formatInfo = TexFormatInfo::getFor(mFormat);
+
+	for (uint32_t i = 0; i < header.levelCount; ++i) {
+		LevelEntry entry;
+		memcpy(&entry, data.data() + sizeof(Header) + i * sizeof(LevelEntry), sizeof(LevelEntry));
+
+		Level level;
+		level.width = MipGenerator::getLevelSize(mWidth, i);
+		level.height = MipGenerator::getLevelSize(mHeight, i);
+
+		//the size is compared with the space left after the offset, as adding them could overflow
+		auto fileSize = (uint64_t)data.byte_size();
+		if (entry.byteOffset < levelTableEnd or entry.byteOffset > fileSize or entry.byteSize > fileSize - entry.byteOffset) {
+			return false;
+		}
+
+		//uncompressed levels are stored in the source layout that glTexSubImage2D reads
+		auto expectedSize = formatInfo.isCompressed() ?
+			formatInfo.getByteSizeFor(level.width, level.height) :
+			level.width * level.height * formatInfo.sourcePixelSize;
+
+		if (entry.byteSize != expectedSize) {
+			return false;
+		}
+
+		level.data = data.slice((size_t)entry.byteOffset, (size_t)(entry.byteOffset + entry.byteSize));
+		mLevels.emplace_back(level);
+	}
+
+	return true;
+}
@@ -0,0 +1,225 @@
+#include "TextureStreamer.h"
+
+#include "Texture.h"
+#include "TexFormatInfo.h"
+#include "MipGenerator.h"
+#include "Platform.h"
+#include "WorkerPool.h"
+
+using namespace Dojo;
+
+TextureStreamer::TextureStreamer(int64_t budget) :
+	mBudget(budget) {
+
+}
+
+TextureStreamer::~TextureStreamer() {
+	for (auto&& entry : mEntries) {
+		entry->texture._clearStreamingEntry();
+	}
+}
+
+optional_ref<TextureStreamer::Entry> TextureStreamer::_getEntry(Texture& texture) {
+	//tiles are streamed together with their atlas
+	if (auto atlas = texture.getParentAtlas().to_ref()) {
+		return atlas.get()._getStreamingEntry();
+	}
+	return texture._getStreamingEntry();
+}
+
+bool TextureStreamer::load(Texture& texture) {
+	DEBUG_ASSERT(texture._getStreamingEntry().is_none(), "This texture is already streamed");
+
+	auto selectBaseLevel = [](uint32_t width, uint32_t height, uint32_t levelCount) {
+		uint32_t level = 0;
+		while (level + 1 < levelCount and std::max(MipGenerator::getLevelSize(width, level), MipGenerator::getLevelSize(height, level)) > DefaultBaseLevelSize) {
+			++level;
+		}
+		return level;
+	};
+
+	Texture::LevelData data;
+	if (not Texture::_readLevels(texture.getFilePath(), selectBaseLevel, data)) {
+		return false;
+	}
+
+	auto entry = make_shared<Entry>(texture);
+	entry->levelCount = data.levelCount;
+	entry->baseLevel = entry->residentLevel = entry->requestedLevel = data.firstLevel;
+
+	texture._setupStreamed(data, *entry);
+
+	entry->baseLevels = std::move(data.levels);
+	_upload(*entry, entry->baseLevel, entry->baseLevels);
+
+	mEntries.emplace_back(std::move(entry));
+	return texture.isLoaded();
+}
+
+void TextureStreamer::remove(Texture& texture) {
+	auto entry = texture._getStreamingEntry().to_raw_ptr();
+	if (not entry) {
+		return;
+	}
+
+	auto elem = std::find_if(mEntries.begin(), mEntries.end(), [&](const std::shared_ptr<Entry>& e) {
+		return e.get() == entry;
+	});
+	DEBUG_ASSERT(elem != mEntries.end(), "This texture isn't managed by this streamer");
+
+	//a load in flight will find its entry expired and drop its result
+	if (entry->loading) {
+		--mLoadsInFlight;
+	}
+
+	mResidentBytes -= texture.getByteSize();
+	texture._clearStreamingEntry();
+
+	*elem = std::move(mEntries.back());
+	mEntries.pop_back();
+}
+
+void TextureStreamer::notifyVisible(Texture& texture, const Vector& screenPixels) {
+	texture._notifyScreenSize(screenPixels);
+
+	if (auto entry = _getEntry(texture).to_ref()) {
+		auto& e = entry.get();
+
+		//how many texels of this texture end up in a single pixel
+		auto ratio = std::min(
+			texture.getWidth() / std::max(screenPixels.x, 1.f),
+			texture.getHeight() / std::max(screenPixels.y, 1.f)
+		);
+
+		auto level = ratio > 1 ? std::min((uint32_t)std::log2(ratio), e.baseLevel) : 0;
+
+		if (e.lastSeenFrame != mFrame) {
+			e.lastSeenFrame = mFrame;
+			e.requestedLevel = level;
+		}
+		else {
+			e.requestedLevel = std::min(e.requestedLevel, level);
+		}
+	}
+}
+
+void TextureStreamer::notifyVisible(Texture& texture) {
+	if (auto entry = _getEntry(texture).to_ref()) {
+		entry.get().lastSeenFrame = mFrame;
+		entry.get().requestedLevel = 0;
+	}
+}
+
+int64_t TextureStreamer::_getByteSizeFor(const Entry& entry, uint32_t level) const {
+	auto& texture = entry.texture;
+	auto& formatInfo = TexFormatInfo::getFor(texture.getFormat());
+
+	int64_t bytes = 0;
+	for (auto i = level; i < entry.levelCount; ++i) {
+		bytes += formatInfo.getByteSizeFor(
+			MipGenerator::getLevelSize(texture.getInternalWidth(), i),
+			MipGenerator::getLevelSize(texture.getInternalHeight(), i)
+		);
+	}
+	return bytes;
+}
+
+void TextureStreamer::_upload(Entry& entry, uint32_t firstLevel, const std::vector<std::vector<uint8_t>>& levels) {
+	mResidentBytes -= entry.texture.getByteSize();
+
+	entry.texture._uploadLevels(firstLevel, levels);
+	entry.residentLevel = firstLevel;
+
+	mResidentBytes += entry.texture.getByteSize();
+}
+
+bool TextureStreamer::_makeRoomFor(const Entry& entry, int64_t bytes) {
+	if (mBudget <= 0) {
+		return true;
+	}
+
+	auto needed = mResidentBytes - entry.texture.getByteSize() + bytes;
+	while (needed > mBudget) {
+		//find the least recently seen texture that has something to drop, skipping the ones seen in the last frame
+		Entry* lru = nullptr;
+		for (auto&& other : mEntries) {
+			if (other.get() != &entry and other->residentLevel < other->baseLevel and other->lastSeenFrame + 1 < mFrame) {
+				if (not lru or other->lastSeenFrame < lru->lastSeenFrame) {
+					lru = other.get();
+				}
+			}
+		}
+
+		if (not lru) {
+			return false;
+		}
+
+		auto before = lru->texture.getByteSize();
+		_upload(*lru, lru->baseLevel, lru->baseLevels);
+		needed -= before - lru->texture.getByteSize();
+
+		++mEvictionCount;
+	}
+	return true;
+}
+
+void TextureStreamer::_request(const std::shared_ptr<Entry>& entry, uint32_t level) {
+	entry->loading = true;
+	++mLoadsInFlight;
+
+	auto path = entry->texture.getFilePath().copy();
+	auto result = make_shared<Texture::LevelData>();
+	std::weak_ptr<Entry> weakEntry = entry;
+
+	Platform::singleton().getBackgroundPool().queue(
+		[path, level, result] {
+			Texture::_readLevels(path, [level](uint32_t, uint32_t, uint32_t) {
+				return level;
+			}, *result);
+		},
+		[this, weakEntry, result] {
+			//uploading is the expensive part, it waits for a frame that has room for it
+			Platform::singleton().getScheduler().schedule(MainThreadScheduler::Priority::Background, "TextureStreamer upload", [this, weakEntry, result] {
+				//the texture was unloaded in the meantime
+				auto entry = weakEntry.lock();
+				if (not entry) {
+					return;
+				}
+
+				entry->loading = false;
+				--mLoadsInFlight;
+
+				if (result->levels.empty()) {
+					return;
+				}
+
+				//use the biggest level that fits in the budget; the result contains all the smaller ones too
+				auto first = result->firstLevel;
+				while (first < entry->residentLevel and not _makeRoomFor(*entry, _getByteSizeFor(*entry, first))) {
+					++first;
+				}
+
+				if (first < entry->residentLevel) {
+					std::vector<std::vector<uint8_t>> levels(
+						std::make_move_iterator(result->levels.begin() + (first - result->firstLevel)),
+						std::make_move_iterator(result->levels.end())
+					);
+					_upload(*entry, first, levels);
+				}
+			});
+		});
+}
+
+void TextureStreamer::update() {
+	for (auto&& entry : mEntries) {
+		if (mLoadsInFlight >= MaxLoadsInFlight) {
+			break;
+		}
+
+		if (entry->lastSeenFrame == mFrame and not entry->loading and entry->requestedLevel < entry->residentLevel) {
+			_request(entry, entry->requestedLevel);
+		}
+	}
+
+	++mFrame;
+}
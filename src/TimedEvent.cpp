@@ -8,68 +8,39 @@ namespace Dojo {
 	public:
 		static EventManager instance;
 
-		void registerEvent(TimedEventImpl& event) {
-			mEvents.emplace(&event);
-		}
-
-		void registerSimpleTask(TimePoint t, AsyncTask task) {
-			mSimpleTasks.emplace(t, std::move(task));
-		}
-
-		void removeEvent(TimedEventImpl& event) {
-			auto elem = mEvents.find(&event);
-			DEBUG_ASSERT(elem != mEvents.end(), "Cannot remove an event that wasn't registered");
-			mEvents.erase(elem);
-		}
-
-		void runTimedEvents(TimePoint now);
-
-	private:
-		SmallSet<TimedEventImpl*> mEvents;
-		std::multimap<TimePoint, AsyncTask> mSimpleTasks;
+		TimingWheel wheel;
 	};
 
 	EventManager EventManager::instance;
 
 	class TimedEventImpl {
 	public:
-		Duration mInterval;
-		TimePoint mNextTime;
-
-		AsyncJob::StatusPtr mStatus;
-		AsyncCallback mCallback;
-		AsyncTask mTask;
 		WorkerPool& mTargetPool;
+		TimingWheel::Handle mHandle;
 
 		TimedEventImpl(Duration interval,
 			AsyncTask task,
 			AsyncCallback callback,
 			WorkerPool& targetPool) :
-			mInterval(interval),
-			mTargetPool(targetPool),
-			mTask(std::move(task)),
-			mCallback(std::move(callback)) {
-
-			EventManager::instance.registerEvent(self);
+			mTargetPool(targetPool) {
+
+			//the first run happens right away, then every interval after it
+			mHandle = EventManager::instance.wheel.schedule(
+				std::chrono::high_resolution_clock::now(),
+				std::move(task),
+				interval,
+				std::move(callback),
+				&targetPool
+			);
 		}
 
 		~TimedEventImpl() {
-			EventManager::instance.removeEvent(self);
+			auto& wheel = EventManager::instance.wheel;
+			AsyncJob::StatusPtr status = wheel.getStatus(mHandle);
+			wheel.cancel(mHandle);
 
 			//stall until the task is done
-			while (mStatus != AsyncJob::Status::NotRunning and mTargetPool.runOneCallback());
-		}
-
-		bool isReady(TimePoint now) {
-			return mStatus == AsyncJob::Status::NotRunning and now >= mNextTime;
-		}
-
-		void run() {
-			DEBUG_ASSERT(mStatus == AsyncJob::Status::NotRunning, "Cannot run now");
-
-			mStatus = mTargetPool.queue(mTask, mCallback);
-
-			mNextTime = std::chrono::high_resolution_clock::now() + mInterval;
+			while (status != AsyncJob::Status::NotRunning and mTargetPool.runOneCallback());
 		}
 	};
 
@@ -86,6 +57,8 @@ namespace Dojo {
 	}
 
 	void TimedEvent::start(std::chrono::high_resolution_clock::duration duration, AsyncTask task, AsyncCallback callback /* =  */, optional_ref<WorkerPool> targetPool /* = */) {
+		DEBUG_ASSERT(duration > Duration::zero(), "A TimedEvent needs a positive interval");
+
 		mImpl = make_unique<TimedEventImpl>(
 			duration,
 			std::move(task),
@@ -94,28 +67,29 @@ namespace Dojo {
 			);
 	}
 
+	void TimedEvent::stop() {
+		mImpl = {};
+	}
+
 	void TimedEvent::runTimedEvents(TimePoint now) {
-		EventManager::instance.runTimedEvents(now);
+		EventManager::instance.wheel.advance(now);
 	}
 
-	void TimedEvent::delay(TimePoint t, AsyncTask task) {
-		EventManager::instance.registerSimpleTask(t, std::move(task));
+	TimedEvent::Handle TimedEvent::delay(TimePoint t, AsyncTask task) {
+		return EventManager::instance.wheel.schedule(t, std::move(task));
 	}
 
-	void EventManager::runTimedEvents(TimePoint now) {
-		//run all the events ready to run
-		for (auto&& event : mEvents) {
-			if (event->isReady(now)) {
-				event->run();
-			}
-		}
+	TimedEvent::Handle TimedEvent::delay(TimePoint t, AsyncTask task, AsyncCallback callback, WorkerPool& targetPool) {
+		return EventManager::instance.wheel.schedule(t, std::move(task), Duration::zero(), std::move(callback), &targetPool);
+	}
 
-		if (mSimpleTasks.size()) {
-			auto top = mSimpleTasks.begin();
-			if (now >= top->first) {
-				top->second();
-				mSimpleTasks.erase(top);
-			}
-		}
+	bool TimedEvent::cancel(Handle handle) {
+		return EventManager::instance.wheel.cancel(handle);
+	}
+
+#ifndef PUBLISH
+	const TimingWheel::Stats& TimedEvent::getStats() {
+		return EventManager::instance.wheel.getStats();
 	}
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,284 @@
+#include "TimingWheel.h"
+
+#include "WorkerPool.h"
+
+using namespace Dojo;
+
+TimingWheel::TimingWheel(Duration resolution, TimePoint start) :
+	mResolution(resolution),
+	mStart(start),
+	mSlots(LevelCount * SlotCount, Nil) {
+	DEBUG_ASSERT(resolution > Duration::zero(), "Invalid resolution");
+}
+
+uint64_t TimingWheel::_getTick(TimePoint t) const {
+	if (t <= mStart) {
+		return 0;
+	}
+
+	//round up, a task should never run before its deadline
+	return static_cast<uint64_t>((t - mStart + mResolution - Duration(1)) / mResolution);
+}
+
+uint32_t TimingWheel::_allocNode() {
+	if (mFreeList != Nil) {
+		auto idx = mFreeList;
+		mFreeList = mNodes[idx].next;
+		return idx;
+	}
+
+	mNodes.emplace_back();
+	return static_cast<uint32_t>(mNodes.size() - 1);
+}
+
+void TimingWheel::_freeNode(uint32_t idx) {
+	auto& node = mNodes[idx];
+	node.task = {};
+	node.callback = {};
+	node.status = {};
+	node.slot = Nil;
+
+	//invalidates all the handles to this node
+	++node.generation;
+
+	node.next = mFreeList;
+	mFreeList = idx;
+}
+
+void TimingWheel::_link(uint32_t idx) {
+	auto& node = mNodes[idx];
+	auto delta = node.tick - mCurrentTick;
+
+	//find the finest level that reaches the tick; the last level also takes all the ticks that are even further away
+	uint32_t level = 0;
+	while (level + 1 < LevelCount and delta >= (1ull << (SlotBits * (level + 1)))) {
+		++level;
+	}
+
+	auto slot = level * SlotCount + static_cast<uint32_t>((node.tick >> (SlotBits * level)) & (SlotCount - 1));
+
+	node.slot = slot;
+	node.prev = Nil;
+	node.next = mSlots[slot];
+	if (node.next != Nil) {
+		mNodes[node.next].prev = idx;
+	}
+	mSlots[slot] = idx;
+}
+
+void TimingWheel::_unlink(uint32_t idx) {
+	auto& node = mNodes[idx];
+	if (node.prev != Nil) {
+		mNodes[node.prev].next = node.next;
+	}
+	else {
+		mSlots[node.slot] = node.next;
+	}
+
+	if (node.next != Nil) {
+		mNodes[node.next].prev = node.prev;
+	}
+
+	node.slot = node.prev = node.next = Nil;
+}
+
+TimingWheel::Handle TimingWheel::schedule(TimePoint deadline, AsyncTask task, Duration period, AsyncCallback callback, WorkerPool* targetPool) {
+	DEBUG_ASSERT(task, "Cannot schedule an empty task");
+	DEBUG_ASSERT(period >= Duration::zero(), "Invalid period");
+
+	auto idx = _allocNode();
+	auto& node = mNodes[idx];
+	node.deadline = deadline;
+	node.tick = std::max(_getTick(deadline), mCurrentTick + 1);
+	node.period = period;
+	node.task = std::move(task);
+	node.callback = std::move(callback);
+	node.pool = targetPool;
+
+	_link(idx);
+	++mScheduledCount;
+
+#ifndef PUBLISH
+	mStats.peakScheduledCount = std::max(mStats.peakScheduledCount, mScheduledCount);
+#endif
+
+	return{ idx, node.generation };
+}
+
+bool TimingWheel::isScheduled(Handle handle) const {
+	return handle.index < mNodes.size() and mNodes[handle.index].generation == handle.generation;
+}
+
+AsyncJob::StatusPtr TimingWheel::getStatus(Handle handle) const {
+	return isScheduled(handle) ? mNodes[handle.index].status : AsyncJob::StatusPtr();
+}
+
+bool TimingWheel::cancel(Handle handle) {
+	if (not isScheduled(handle)) {
+		return false;
+	}
+
+	_unlink(handle.index);
+	_freeNode(handle.index);
+	--mScheduledCount;
+	return true;
+}
+
+void TimingWheel::_cascade(uint32_t level) {
+	auto slot = level * SlotCount + static_cast<uint32_t>((mCurrentTick >> (SlotBits * level)) & (SlotCount - 1));
+
+	//detach the whole slot first, as its nodes could be linked in it again if they are very far away
+	auto idx = mSlots[slot];
+	mSlots[slot] = Nil;
+	while (idx != Nil) {
+		auto next = mNodes[idx].next;
+		_link(idx);
+		idx = next;
+	}
+}
+
+void TimingWheel::_expireSlot(uint32_t slot) {
+	auto idx = mSlots[slot];
+	mSlots[slot] = Nil;
+	while (idx != Nil) {
+		auto& node = mNodes[idx];
+		DEBUG_ASSERT(node.tick == mCurrentTick, "The node was in the wrong slot");
+
+		auto next = node.next;
+		node.slot = node.prev = node.next = Nil;
+		mExpired.push_back(idx);
+		--mScheduledCount;
+
+		idx = next;
+	}
+}
+
+void TimingWheel::advance(TimePoint now) {
+#ifndef PUBLISH
+	auto startTime = std::chrono::high_resolution_clock::now();
+#endif
+
+	auto target = now > mStart ? static_cast<uint64_t>((now - mStart) / mResolution) : 0;
+
+	while (mCurrentTick < target) {
+		//nothing to expire, skip all the ticks at once
+		if (mScheduledCount == 0) {
+			mCurrentTick = target;
+			break;
+		}
+
+		++mCurrentTick;
+
+		//cascade the coarsest level whose slot has just started first, so that its nodes can fall through all the levels below
+		uint32_t top = 0;
+		while (top + 1 < LevelCount and (mCurrentTick & ((1ull << (SlotBits * (top + 1))) - 1)) == 0) {
+			++top;
+		}
+		for (auto level = top; level > 0; --level) {
+			_cascade(level);
+		}
+
+		_expireSlot(static_cast<uint32_t>(mCurrentTick & (SlotCount - 1)));
+	}
+
+#ifndef PUBLISH
+	mStats.advanceTime += durationToSeconds(std::chrono::high_resolution_clock::now() - startTime);
+	mStats.expiredCount += mExpired.size();
+	++mStats.advanceCount;
+#endif
+
+	if (mExpired.size()) {
+		_dispatchExpired(now);
+	}
+}
+
+void TimingWheel::_dispatchExpired(TimePoint now) {
+	struct Batch {
+		WorkerPool* pool;
+		std::vector<AsyncTask> tasks;
+		std::vector<AsyncCallback> callbacks;
+		std::vector<Handle> periodic;
+	};
+
+	std::vector<Batch> batches;
+	std::vector<std::pair<AsyncTask, AsyncCallback>> inlineTasks;
+
+	for (auto&& idx : mExpired) {
+		auto& node = mNodes[idx];
+		Handle handle = { idx, node.generation };
+		bool periodic = node.period > Duration::zero();
+
+		//a periodic task that is still running skips this period
+		if (not periodic or node.status == AsyncJob::Status::NotRunning) {
+			auto task = periodic ? node.task : std::move(node.task);
+			auto callback = periodic ? node.callback : std::move(node.callback);
+
+			if (node.pool) {
+				auto batch = std::find_if(batches.begin(), batches.end(), [&](const Batch& b) {
+					return b.pool == node.pool;
+				});
+				if (batch == batches.end()) {
+					batches.push_back({ node.pool });
+					batch = batches.end() - 1;
+				}
+
+				batch->tasks.emplace_back(std::move(task));
+				if (callback) {
+					batch->callbacks.emplace_back(std::move(callback));
+				}
+				if (periodic) {
+					batch->periodic.push_back(handle);
+				}
+			}
+			else {
+				inlineTasks.emplace_back(std::move(task), std::move(callback));
+			}
+		}
+
+		if (periodic) {
+			//count from the deadline, not from now, so that the period doesn't drift; skip the periods that were missed entirely
+			node.deadline += node.period;
+			if (node.deadline <= now) {
+				node.deadline += node.period * ((now - node.deadline) / node.period + 1);
+			}
+			node.tick = std::max(_getTick(node.deadline), mCurrentTick + 1);
+			_link(idx);
+			++mScheduledCount;
+		}
+		else {
+			_freeNode(idx);
+		}
+	}
+	mExpired.clear();
+
+	for (auto&& batch : batches) {
+		AsyncCallback callback;
+		if (batch.callbacks.size()) {
+			callback = [callbacks = std::move(batch.callbacks)]{
+				for (auto&& c : callbacks) {
+					c();
+				}
+			};
+		}
+
+		auto status = batch.pool->queue([tasks = std::move(batch.tasks)]{
+			for (auto&& t : tasks) {
+				t();
+			}
+		}, std::move(callback));
+
+		for (auto&& handle : batch.periodic) {
+			if (isScheduled(handle)) {
+				mNodes[handle.index].status = status;
+			}
+		}
+	}
+
+	//these can schedule or cancel other tasks, so they run last
+	for (auto&& task : inlineTasks) {
+		task.first();
+		if (task.second) {
+			task.second();
+		}
+	}
+}
@@ -31,14 +31,13 @@ void WorkerPool::sync() {
 }
 
 AsyncJob::StatusPtr WorkerPool::queue(AsyncTask task, AsyncCallback callback /* = */ ) {
-	//round robin between the workers
+	//round robin between the workers; the counter is atomic so that pools with many producers can share it
 	//TODO use a sp-mc queue?
 	auto job = AsyncJob{ std::move(task), std::move(callback) };
 	AsyncJob::StatusPtr ptr = job.mStatus;
 
-	mWorkers[mNextWorker]->queueJob(std::move(job));
-
-	mNextWorker = (mNextWorker + 1) % mWorkers.size();
+	auto worker = mNextWorker.fetch_add(1, std::memory_order_relaxed) % mWorkers.size();
+	mWorkers[worker]->queueJob(std::move(job));
 
 	return ptr;
 }
@@ -61,3 +60,13 @@ bool WorkerPool::runOneCallback() {
 
 	return false;
 }
+
+#ifndef PUBLISH
+WorkerPool::Stats WorkerPool::getStats() const {
+	Stats stats;
+	for (auto&& w : mWorkers) {
+		w->_addStats(stats);
+	}
+	return stats;
+}
+#endif
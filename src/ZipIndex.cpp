@@ -0,0 +1,219 @@
+#include "ZipIndex.h"
+
+using namespace Dojo;
+
+namespace {
+	const uint32_t LocalHeaderSignature = 0x04034b50;
+	const uint32_t CentralHeaderSignature = 0x02014b50;
+	const uint32_t EndOfDirectorySignature = 0x06054b50;
+	const uint32_t Zip64EndOfDirectorySignature = 0x06064b50;
+	const uint32_t Zip64LocatorSignature = 0x07064b50;
+
+	const size_t LocalHeaderSize = 30;
+	const size_t CentralHeaderSize = 46;
+	const size_t EndOfDirectorySize = 22;
+	const size_t Zip64EndOfDirectorySize = 56;
+	const size_t Zip64LocatorSize = 20;
+	const size_t MaxCommentSize = 0xffff;
+
+	const uint16_t Zip64ExtraField = 0x0001;
+	const uint16_t EncryptedFlag = 1 << 0;
+
+	//zip fields are little endian and unaligned
+	uint16_t read16(const uint8_t* p) {
+		return (uint16_t)(p[0] | (p[1] << 8));
+	}
+
+	uint32_t read32(const uint8_t* p) {
+		return (uint32_t)read16(p) | ((uint32_t)read16(p + 2) << 16);
+	}
+
+	uint64_t read64(const uint8_t* p) {
+		return (uint64_t)read32(p) | ((uint64_t)read32(p + 4) << 32);
+	}
+
+	std::string normalize(utf::string_view path) {
+		auto begin = path.data();
+		auto end = begin + path.byte_size();
+
+		//the paths in the archive are relative to its root
+		while (begin != end and (*begin == '/' or (*begin == '.' and begin + 1 != end and begin[1] == '/'))) {
+			begin += *begin == '/' ? 1 : 2;
+		}
+		while (begin != end and end[-1] == '/') {
+			--end;
+		}
+
+		return{ begin, end };
+	}
+}
+
+ZipIndex::ZipIndex(utf::string_view archivePath) :
+	mArchive(archivePath, MappedFile::AccessHint::Random) {
+
+	mValid = mArchive.isOpen() and _parse();
+	DEBUG_ASSERT_INFO(mValid, "Cannot read the zip archive", archivePath.copy());
+}
+
+bool ZipIndex::_parse() {
+	auto data = mArchive.data();
+	auto size = mArchive.size();
+
+	if (size < EndOfDirectorySize) {
+		return false;
+	}
+
+	//the end of central directory record is followed only by the comment, look for it from the end
+	const uint8_t* eocd = nullptr;
+	auto lowest = size - EndOfDirectorySize - std::min(size - EndOfDirectorySize, MaxCommentSize);
+	for (auto offset = size - EndOfDirectorySize + 1; offset-- > lowest;) {
+		if (read32(data + offset) == EndOfDirectorySignature) {
+			eocd = data + offset;
+			break;
+		}
+	}
+
+	if (not eocd) {
+		return false;
+	}
+
+	uint64_t entryCount = read16(eocd + 10);
+	uint64_t directorySize = read32(eocd + 12);
+	uint64_t directoryOffset = read32(eocd + 16);
+
+	if (read16(eocd + 4) != 0 or read16(eocd + 6) != 0) {
+		return false; //multi-disk archive
+	}
+
+	//zip64 archives mark the fields that didn't fit, the real ones are in the zip64 record
+	if (entryCount == 0xffff or directorySize == 0xffffffff or directoryOffset == 0xffffffff) {
+		auto eocdOffset = (size_t)(eocd - data);
+		if (eocdOffset < Zip64LocatorSize or read32(eocd - Zip64LocatorSize) != Zip64LocatorSignature) {
+			return false;
+		}
+
+		auto recordOffset = read64(eocd - Zip64LocatorSize + 8);
+		if (recordOffset + Zip64EndOfDirectorySize > size or read32(data + recordOffset) != Zip64EndOfDirectorySignature) {
+			return false;
+		}
+
+		auto record = data + recordOffset;
+		entryCount = read64(record + 32);
+		directorySize = read64(record + 40);
+		directoryOffset = read64(record + 48);
+	}
+
+	if (directoryOffset + directorySize > size) {
+		return false;
+	}
+
+	mArchive.prefetch((size_t)directoryOffset, (size_t)directorySize);
+
+	mEntries.reserve((size_t)entryCount);
+	mEntryByPath.reserve((size_t)entryCount);
+	mPaths.reserve((size_t)entryCount);
+
+	auto p = data + directoryOffset;
+	auto end = p + directorySize;
+	for (uint64_t i = 0; i < entryCount; ++i) {
+		if (p + CentralHeaderSize > end or read32(p) != CentralHeaderSignature) {
+			return false;
+		}
+
+		Entry entry;
+		entry.encrypted = (read16(p + 8) & EncryptedFlag) != 0;
+		entry.method = read16(p + 10);
+		entry.crc = read32(p + 16);
+		entry.compressedSize = read32(p + 20);
+		entry.size = read32(p + 24);
+		entry.headerOffset = read32(p + 42);
+
+		auto nameLength = read16(p + 28);
+		auto extraLength = read16(p + 30);
+		auto commentLength = read16(p + 32);
+
+		auto name = p + CentralHeaderSize;
+		auto extra = name + nameLength;
+		auto next = extra + extraLength + commentLength;
+		if (next > end) {
+			return false;
+		}
+
+		//the zip64 extra field contains, in order, only the fields that are saturated in the header
+		for (auto field = extra; field + 4 <= extra + extraLength;) {
+			auto id = read16(field);
+			auto fieldSize = read16(field + 2);
+			auto value = field + 4;
+			auto valueEnd = value + fieldSize;
+
+			if (id == Zip64ExtraField) {
+				for (auto member : { &entry.size, &entry.compressedSize, &entry.headerOffset }) {
+					if (*member == 0xffffffff and value + 8 <= valueEnd) {
+						*member = read64(value);
+						value += 8;
+					}
+				}
+			}
+
+			field = valueEnd;
+		}
+
+		//folders are only implied by the paths of the files
+		if (nameLength > 0 and name[nameLength - 1] != '/') {
+			_add({ (const char*)name, nameLength }, entry);
+		}
+
+		p = next;
+	}
+
+	return true;
+}
+
+void ZipIndex::_add(std::string path, const Entry& entry) {
+	auto idx = (uint32_t)mEntries.size();
+	mEntries.push_back(entry);
+
+	auto separator = path.find_last_of('/');
+	auto folder = separator == std::string::npos ? std::string() : path.substr(0, separator);
+	mEntriesByFolder[folder].push_back(idx);
+
+	mEntryByPath.emplace(path, idx);
+	mPaths.emplace_back(std::move(path));
+}
+
+optional_ref<const ZipIndex::Entry> ZipIndex::find(utf::string_view path) const {
+	auto elem = mEntryByPath.find(normalize(path));
+	if (elem == mEntryByPath.end()) {
+		return{};
+	}
+	return mEntries[elem->second];
+}
+
+vec_view<uint8_t> ZipIndex::getData(const Entry& entry) const {
+	auto data = mArchive.data();
+	auto size = mArchive.size();
+
+	//the local header can have a different extra field than the central one, so its length has to be read here
+	if (entry.headerOffset + LocalHeaderSize > size or read32(data + entry.headerOffset) != LocalHeaderSignature) {
+		return{};
+	}
+
+	auto header = data + entry.headerOffset;
+	auto start = entry.headerOffset + LocalHeaderSize + read16(header + 26) + read16(header + 28);
+	if (start + entry.compressedSize > size) {
+		return{};
+	}
+
+	return{ data + start, data + start + entry.compressedSize };
+}
+
+void ZipIndex::getFiles(utf::string_view folder, std::vector<utf::string>& out) const {
+	auto elem = mEntriesByFolder.find(normalize(folder));
+	if (elem == mEntriesByFolder.end()) {
+		return;
+	}
+
+	for (auto&& idx : elem->second) {
+		out.emplace_back(mPaths[idx].data());
+	}
+}
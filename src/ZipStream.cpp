@@ -0,0 +1,207 @@
+#include "ZipStream.h"
+
+using namespace Dojo;
+
+ZipStream::ZipStream(utf::string_view path, std::shared_ptr<const ZipIndex> archive, utf::string_view internalPath) :
+	FileStream(path),
+	mArchive(std::move(archive)),
+	mInternalPath(internalPath.copy()) {
+	DEBUG_ASSERT(mArchive, "Invalid archive");
+}
+
+ZipStream::~ZipStream() {
+	if (isOpen()) {
+		close();
+	}
+}
+
+Stream::Access ZipStream::getAccess() {
+	return mAccess;
+}
+
+bool ZipStream::open(Access accessType) {
+	DEBUG_ASSERT(not isOpen(), "The file was already open");
+
+	if (accessType != Access::Read or not mArchive->isValid()) {
+		return false;
+	}
+
+	mEntry = mArchive->find(mInternalPath);
+	if (mEntry.is_none()) {
+		return false;
+	}
+
+	auto& entry = mEntry.unwrap();
+	if (entry.encrypted) {
+		DEBUG_MESSAGE("Encrypted zip entries are not supported: " + mPath);
+		return false;
+	}
+
+	mData = mArchive->getData(entry);
+	if (mData.size() != entry.compressedSize) {
+		return false;
+	}
+
+	if (entry.method == (uint16_t)ZipIndex::Method::Deflated) {
+		mInflate = {};
+		//negative window bits, the entries contain raw deflate data without the zlib header
+		if (inflateInit2(&mInflate, -MAX_WBITS) != Z_OK) {
+			return false;
+		}
+		mInflating = true;
+
+		if (not _restartInflate()) {
+			close();
+			return false;
+		}
+	}
+	else if (entry.method != (uint16_t)ZipIndex::Method::Stored or entry.size != entry.compressedSize) {
+		DEBUG_MESSAGE("Unsupported zip compression method in " + mPath);
+		return false;
+	}
+
+	mArchive->getArchive().prefetch(mData.data() - mArchive->getArchive().data(), mData.size());
+
+	mPosition = 0;
+	mAccess = Access::Read;
+	return true;
+}
+
+void ZipStream::close() {
+	if (mInflating) {
+		inflateEnd(&mInflate);
+		mInflating = false;
+	}
+
+	mEntry = {};
+	mData = {};
+	mPosition = 0;
+	mAccess = Access::BadFile;
+}
+
+int64_t ZipStream::getSize() {
+	DEBUG_ASSERT(isReadable(), "The file must be readable to get its size");
+
+	return (int64_t)mEntry.unwrap().size;
+}
+
+int64_t ZipStream::getCurrentPosition() {
+	DEBUG_ASSERT(isOpen(), "The file must be open");
+
+	return mPosition;
+}
+
+bool ZipStream::isStored() const {
+	return mAccess != Access::BadFile and not mInflating;
+}
+
+vec_view<uint8_t> ZipStream::getContentInPlace(std::shared_ptr<const void>& owner) {
+	DEBUG_ASSERT(isOpen(), "The file must be open");
+
+	if (not isStored()) {
+		return{};
+	}
+
+	owner = mArchive;
+	return mData;
+}
+
+bool ZipStream::_restartInflate() {
+	if (inflateReset(&mInflate) != Z_OK) {
+		return false;
+	}
+
+	//zlib doesn't write to the input
+	mInflate.next_in = const_cast<Bytef*>(mData.data());
+	mInflate.avail_in = (uInt)std::min<size_t>(mData.size(), UINT32_MAX);
+	mPosition = 0;
+	return true;
+}
+
+int64_t ZipStream::_inflate(uint8_t* buf, int64_t number) {
+	int64_t total = 0;
+	while (total < number) {
+		//the sizes are 32 bit in zlib, refill the input in chunks for huge entries
+		if (mInflate.avail_in == 0) {
+			auto consumed = (size_t)(mInflate.next_in - mData.data());
+			mInflate.avail_in = (uInt)std::min<size_t>(mData.size() - consumed, UINT32_MAX);
+		}
+
+		auto chunk = (uInt)std::min<int64_t>(number - total, UINT32_MAX);
+		mInflate.next_out = buf + total;
+		mInflate.avail_out = chunk;
+
+		auto res = inflate(&mInflate, Z_NO_FLUSH);
+		total += chunk - mInflate.avail_out;
+
+		if (res == Z_STREAM_END) {
+			break;
+		}
+		else if (res != Z_OK) {
+			DEBUG_ASSERT_INFO(res == Z_BUF_ERROR, "Corrupt zip entry", mPath);
+			break;
+		}
+	}
+
+	mPosition += total;
+	return total;
+}
+
+int64_t ZipStream::read(uint8_t* buf, int64_t number) {
+	DEBUG_ASSERT(isReadable(), "The file must be open and readable");
+	DEBUG_ASSERT(number >= 0, "Invalid read size");
+
+	if (mInflating) {
+		return _inflate(buf, number);
+	}
+
+	number = std::min(number, (int64_t)mData.size() - mPosition);
+	memcpy(buf, mData.data() + mPosition, (size_t)number);
+	mPosition += number;
+	return number;
+}
+
+int ZipStream::seek(int64_t offset, int64_t fromWhere /*= SEEK_SET*/) {
+	DEBUG_ASSERT(isOpen(), "The file must be open");
+
+	int64_t target;
+	switch (fromWhere) {
+	case SEEK_SET:
+		target = offset;
+		break;
+	case SEEK_CUR:
+		target = mPosition + offset;
+		break;
+	case SEEK_END:
+		target = getSize() + offset;
+		break;
+	default:
+		FAIL("Invalid seek origin");
+	}
+
+	if (target < 0 or target > getSize()) {
+		return -1;
+	}
+
+	if (not mInflating) {
+		mPosition = target;
+		return 0;
+	}
+
+	//deflate data can't be entered in the middle, so decompress everything before the target
+	if (target < mPosition and not _restartInflate()) {
+		return -1;
+	}
+
+	uint8_t skipped[4096];
+	while (mPosition < target) {
+		if (_inflate(skipped, std::min<int64_t>(target - mPosition, sizeof(skipped))) == 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+std::unique_ptr<Stream> ZipStream::copy() const {
+	return make_unique<ZipStream>(mPath, mArchive, mInternalPath);
+}
@@ -9,6 +9,7 @@
 #include "InputSystem.h"
 #include "WorkerPool.h"
 #include "Path.h"
+#include "MappedFile.h"
 #include "Keyboard.h"
 
 #include "dojo_win_header.h"
@@ -934,10 +935,10 @@ PixelFormat Win32Platform::loadImageFile(std::vector<uint8_t>& imageData, utf::s
 		return PixelFormat::Unknown;
 	}
 
-	auto buf = loadFileContent(path);
+	MappedFile file(path);
 
-	// attach the binary data to a memory stream
-	FIMEMORY* hmem = FreeImage_OpenMemory(buf.data(), static_cast<DWORD>(buf.size()));
+	// attach the mapped file to a memory stream, FreeImage only reads from it
+	FIMEMORY* hmem = FreeImage_OpenMemory(const_cast<uint8_t*>(file.data()), static_cast<DWORD>(file.size()));
 
 	// load an image from the memory stream
 	dib = FreeImage_LoadFromMemory(fif, hmem, 0);